@@ -0,0 +1,190 @@
+/*
+ * deferred_log.h
+ * Deferred binary logging backend for the LOG_* macros
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <atomic>
+#include <type_traits>
+
+#include "libbase/misc_types.h"
+
+#ifndef LIBBASE_DEFERRED_LOG_SLOTS
+#define LIBBASE_DEFERRED_LOG_SLOTS 64
+#endif
+
+namespace libbase
+{
+
+/**
+ * Instead of formatting the message in place, a log call only stores the
+ * address of its format string (which doubles as the ID) and the raw arguments
+ * to a RAM ring. The records are later serialized by Drain() in the
+ * background, and expanded back to text on the host with the firmware ELF
+ * (see tools/deferred_log_decode.py)
+ *
+ * Write() is lock-free and safe to be called from any context, including ISRs
+ * preempting each other. Drain(), Peek() and Consume() must only be called
+ * from one context.
+ * Enabled for C++ code by defining LIBBASE_DEFERRED_LOG, C code always uses
+ * printf
+ *
+ * A serialized record is:<br>
+ * kSync, 32-bit LE format string address, 1 byte size (bit 7 set if the
+ * arguments are truncated), arguments<br>
+ * where integers of up to 32 bits, pointers, and floating point numbers (as
+ * float) take 4 LE bytes, 64-bit integers take 8 LE bytes, and strings are
+ * copied as 1 byte length + content. A record with a null format string
+ * carries the 32-bit # records dropped since the last report
+ */
+class DeferredLog
+{
+public:
+	static constexpr Byte kSync = 0xA7;
+	static constexpr size_t kSlotCount = LIBBASE_DEFERRED_LOG_SLOTS;
+	static_assert(!(kSlotCount & (kSlotCount - 1)),
+			"LIBBASE_DEFERRED_LOG_SLOTS must be a power of 2");
+
+	template<typename... Args>
+	static void Write(const char *fmt, const Args&... args)
+	{
+		uint32_t index;
+		Slot *slot = Claim(&index);
+		if (!slot)
+		{
+			return;
+		}
+		slot->fmt = fmt;
+		slot->size = 0;
+		PutArgs(slot, args...);
+		// Make the content visible before the sequence number
+		slot->seq.store(index + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Serialize as many complete records as possible to @a out, and remove
+	 * them
+	 *
+	 * @param out
+	 * @param size Size of @a out, should be at least GetMaxRecordSize()
+	 * @return # bytes written
+	 */
+	static size_t Drain(Byte *out, const size_t size)
+	{
+		const size_t product = Peek(out, size);
+		Consume();
+		return product;
+	}
+
+	/**
+	 * Same as Drain(), but the records are kept (and returned again by the
+	 * next Peek()) until Consume() is called, e.g., once they are sent
+	 *
+	 * @param out
+	 * @param size Size of @a out, should be at least GetMaxRecordSize()
+	 * @return # bytes written
+	 */
+	static size_t Peek(Byte *out, const size_t size);
+	/**
+	 * Remove the records returned by the last Peek()
+	 */
+	static void Consume();
+
+	static constexpr size_t GetMaxRecordSize()
+	{
+		return 6 + sizeof(Slot::data);
+	}
+
+private:
+	struct Slot
+	{
+		/// Index + 1 once the record is published
+		std::atomic<uint32_t> seq;
+		const char *fmt;
+		uint8_t size;
+		Byte data[23];
+	};
+
+	/**
+	 * Claim the next free slot
+	 *
+	 * @param out_index
+	 * @return The slot, or nullptr if the ring is full
+	 */
+	static Slot* Claim(uint32_t *out_index);
+
+	static void PutBytes(Slot *slot, const void *data, const size_t size)
+	{
+		if (slot->size + size > sizeof(slot->data))
+		{
+			slot->size |= 0x80;
+			return;
+		}
+		else if (slot->size & 0x80)
+		{
+			return;
+		}
+		memcpy(slot->data + slot->size, data, size);
+		slot->size += size;
+	}
+
+	static void PutArgs(Slot*)
+	{}
+
+	template<typename T, typename... Rest>
+	static void PutArgs(Slot *slot, const T &arg, const Rest&... rest)
+	{
+		PutArg(slot, arg);
+		PutArgs(slot, rest...);
+	}
+
+	template<typename T>
+	static typename std::enable_if<(std::is_integral<T>::value
+			|| std::is_enum<T>::value) && sizeof(T) <= 4>::type
+			PutArg(Slot *slot, const T &arg)
+	{
+		const uint32_t word = static_cast<uint32_t>(arg);
+		PutBytes(slot, &word, 4);
+	}
+
+	template<typename T>
+	static typename std::enable_if<std::is_integral<T>::value
+			&& sizeof(T) == 8>::type PutArg(Slot *slot, const T &arg)
+	{
+		const uint64_t dword = static_cast<uint64_t>(arg);
+		PutBytes(slot, &dword, 8);
+	}
+
+	static void PutArg(Slot *slot, const double arg)
+	{
+		const float f = arg;
+		PutBytes(slot, &f, 4);
+	}
+
+	static void PutArg(Slot *slot, const char *arg);
+
+	static void PutArg(Slot *slot, char *arg)
+	{
+		PutArg(slot, static_cast<const char*>(arg));
+	}
+
+	template<typename T>
+	static void PutArg(Slot *slot, T *arg)
+	{
+		const uint32_t word = reinterpret_cast<uintptr_t>(arg);
+		PutBytes(slot, &word, 4);
+	}
+
+	static Slot m_slots[kSlotCount];
+};
+
+}
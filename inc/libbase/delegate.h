@@ -0,0 +1,318 @@
+/*
+ * delegate.h
+ * Non-allocating callable wrapper for ISR callbacks
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace libbase
+{
+
+template<typename Signature, size_t kCapacity = 4 * sizeof(void*)>
+class Delegate;
+
+/**
+ * A drop-in replacement of std::function for driver callbacks. The callable
+ * is always stored in place, so assigning a lambda or a std::bind expression
+ * never touches the heap -- an oversized callable is rejected at compile time
+ * instead. Calling goes through a single function pointer
+ *
+ * For member functions, prefer Bind<T, &T::Method>(obj) over std::bind: the
+ * method is resolved at compile time and only the object pointer is stored,
+ * so the call is direct instead of going through a member function pointer
+ *
+ * @tparam kCapacity Max size of the stored callable. The default one fits a
+ * std::bind of a member function with the object pointer and a placeholder
+ */
+template<typename R, typename... Args, size_t kCapacity>
+class Delegate<R(Args...), kCapacity>
+{
+public:
+	Delegate()
+			: m_invoker(nullptr),
+			  m_manager(nullptr)
+	{}
+
+	Delegate(std::nullptr_t)
+			: Delegate()
+	{}
+
+	// Like std::function, the result is simply discarded if R is void
+	template<typename F, typename = typename std::enable_if<
+			!std::is_same<typename std::decay<F>::type, Delegate>::value
+			&& (std::is_convertible<decltype(std::declval<
+					typename std::decay<F>::type&>()(std::declval<Args>()...)),
+					R>::value || std::is_void<R>::value)>::type>
+	Delegate(F &&f)
+			: Delegate()
+	{
+		Assign(std::forward<F>(f));
+	}
+
+	Delegate(const Delegate &rhs)
+			: Delegate()
+	{
+		CopyFrom(rhs);
+	}
+
+	Delegate(Delegate &&rhs)
+			: Delegate()
+	{
+		MoveFrom(&rhs);
+	}
+
+	~Delegate()
+	{
+		Reset();
+	}
+
+	Delegate& operator=(const Delegate &rhs)
+	{
+		if (this != &rhs)
+		{
+			Reset();
+			CopyFrom(rhs);
+		}
+		return *this;
+	}
+
+	Delegate& operator=(Delegate &&rhs)
+	{
+		if (this != &rhs)
+		{
+			Reset();
+			MoveFrom(&rhs);
+		}
+		return *this;
+	}
+
+	Delegate& operator=(std::nullptr_t)
+	{
+		Reset();
+		return *this;
+	}
+
+	template<typename F>
+	Delegate& operator=(F &&f)
+	{
+		return *this = Delegate(std::forward<F>(f));
+	}
+
+	/**
+	 * Create a delegate calling @a obj->kMethod(args...)
+	 *
+	 * @param obj
+	 * @return
+	 */
+	template<typename T, R (T::*kMethod)(Args...)>
+	static Delegate Bind(T *obj)
+	{
+		Delegate product;
+		new (&product.m_storage) T*(obj);
+		product.m_invoker = &InvokeMethod<T, kMethod>;
+		return product;
+	}
+
+	template<typename T, R (T::*kMethod)(Args...) const>
+	static Delegate Bind(const T *obj)
+	{
+		Delegate product;
+		new (&product.m_storage) const T*(obj);
+		product.m_invoker = &InvokeConstMethod<T, kMethod>;
+		return product;
+	}
+
+	/**
+	 * Create a delegate calling kFunc(args...)
+	 *
+	 * @return
+	 */
+	template<R (*kFunc)(Args...)>
+	static Delegate Bind()
+	{
+		Delegate product;
+		product.m_invoker = &InvokeFunc<kFunc>;
+		return product;
+	}
+
+	R operator()(Args... args) const
+	{
+		return m_invoker(&m_storage, std::forward<Args>(args)...);
+	}
+
+	explicit operator bool() const
+	{
+		return (m_invoker != nullptr);
+	}
+
+	bool operator==(std::nullptr_t) const
+	{
+		return (m_invoker == nullptr);
+	}
+
+	bool operator!=(std::nullptr_t) const
+	{
+		return (m_invoker != nullptr);
+	}
+
+	void Reset()
+	{
+		if (m_manager)
+		{
+			m_manager(Op::kDestroy, &m_storage, nullptr);
+		}
+		m_invoker = nullptr;
+		m_manager = nullptr;
+	}
+
+private:
+	typedef typename std::aligned_storage<kCapacity>::type Storage;
+	typedef R (*Invoker)(void *storage, Args... args);
+
+	enum struct Op
+	{
+		kCopy,
+		kMove,
+		kDestroy,
+	};
+
+	/**
+	 * Copy/move/destroy the stored callable. Left null if the callable is
+	 * trivial (function pointers and the Bind() variants), in which case
+	 * the storage is simply copied
+	 */
+	typedef void (*Manager)(const Op op, void *storage, void *src);
+
+	template<typename F>
+	static R Invoke(void *storage, Args... args)
+	{
+		return static_cast<R>((*static_cast<F*>(storage))(
+				std::forward<Args>(args)...));
+	}
+
+	template<typename T, R (T::*kMethod)(Args...)>
+	static R InvokeMethod(void *storage, Args... args)
+	{
+		return ((*static_cast<T**>(storage))->*kMethod)(
+				std::forward<Args>(args)...);
+	}
+
+	template<typename T, R (T::*kMethod)(Args...) const>
+	static R InvokeConstMethod(void *storage, Args... args)
+	{
+		return ((*static_cast<const T**>(storage))->*kMethod)(
+				std::forward<Args>(args)...);
+	}
+
+	template<R (*kFunc)(Args...)>
+	static R InvokeFunc(void*, Args... args)
+	{
+		return kFunc(std::forward<Args>(args)...);
+	}
+
+	template<typename F>
+	static void Manage(const Op op, void *storage, void *src)
+	{
+		switch (op)
+		{
+		case Op::kCopy:
+			new (storage) F(*static_cast<const F*>(src));
+			break;
+
+		case Op::kMove:
+			new (storage) F(std::move(*static_cast<F*>(src)));
+			static_cast<F*>(src)->~F();
+			break;
+
+		case Op::kDestroy:
+			static_cast<F*>(storage)->~F();
+			break;
+		}
+	}
+
+	template<typename F>
+	static bool IsNull(const F&)
+	{
+		return false;
+	}
+
+	template<typename F>
+	static bool IsNull(F *const &f)
+	{
+		return (f == nullptr);
+	}
+
+	template<typename Signature>
+	static bool IsNull(const std::function<Signature> &f)
+	{
+		return !f;
+	}
+
+	template<typename F>
+	void Assign(F &&f)
+	{
+		typedef typename std::decay<F>::type Functor;
+		static_assert(sizeof(Functor) <= kCapacity,
+				"Callable too large for Delegate, capture less or raise kCapacity");
+		static_assert(std::alignment_of<Functor>::value
+				<= std::alignment_of<Storage>::value,
+				"Callable over-aligned for Delegate");
+
+		if (IsNull(f))
+		{
+			return;
+		}
+		new (&m_storage) Functor(std::forward<F>(f));
+		m_invoker = &Invoke<Functor>;
+		m_manager = std::is_pointer<Functor>::value ? nullptr
+				: &Manage<Functor>;
+	}
+
+	void CopyFrom(const Delegate &rhs)
+	{
+		if (rhs.m_manager)
+		{
+			rhs.m_manager(Op::kCopy, &m_storage, &rhs.m_storage);
+		}
+		else
+		{
+			memcpy(&m_storage, &rhs.m_storage, sizeof(Storage));
+		}
+		m_invoker = rhs.m_invoker;
+		m_manager = rhs.m_manager;
+	}
+
+	void MoveFrom(Delegate *rhs)
+	{
+		if (rhs->m_manager)
+		{
+			rhs->m_manager(Op::kMove, &m_storage, &rhs->m_storage);
+		}
+		else
+		{
+			memcpy(&m_storage, &rhs->m_storage, sizeof(Storage));
+		}
+		m_invoker = rhs->m_invoker;
+		m_manager = rhs->m_manager;
+		rhs->m_invoker = nullptr;
+		rhs->m_manager = nullptr;
+	}
+
+	mutable Storage m_storage;
+	Invoker m_invoker;
+	Manager m_manager;
+};
+
+}
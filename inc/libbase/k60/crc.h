@@ -12,12 +12,21 @@
 #include <cstdint>
 
 #include "libbase/k60/misc_utils.h"
+#include "libbase/misc_types.h"
 
 namespace libbase
 {
 namespace k60
 {
 
+class Dma;
+
+/**
+ * The CRC peripheral. The default config computes the CRC-32/ISO-HDLC, while
+ * CRC-16/CCITT-FALSE could be computed with polynomial = 0x1021,
+ * seed = 0xFFFF, is_32_bit = false, is_reflect = false and is_xor_out = false.
+ * The same results could be computed in software with libutil::CrcUtils
+ */
 class Crc
 {
 public:
@@ -25,6 +34,20 @@ public:
 	{
 		uint32_t polynomial = 0x04C11DB7;
 		uint32_t seed = 0xFFFFFFFF;
+		/// 32-bit CRC, otherwise 16-bit
+		bool is_32_bit = true;
+		/// Reflect (LSB first) both the input bytes and the result
+		bool is_reflect = true;
+		/// Invert the result
+		bool is_xor_out = true;
+
+		/**
+		 * (Optional) If value != -1, bulk PushData() calls of at least
+		 * dma_threshold bytes will be fed to the CRC by this DMA channel
+		 * instead of the CPU. The call still blocks until DMA has finished
+		 */
+		uint8_t dma_channel = static_cast<uint8_t>(-1);
+		uint16_t dma_threshold = 256;
 	};
 
 	explicit Crc(const Config &config);
@@ -48,13 +71,44 @@ public:
 
 	void PushData(const uint32_t data);
 	void PushData(const Byte data);
+	/**
+	 * Push @a size bytes in @a data, in memory order. The word aligned part is
+	 * fed with 32-bit writes (or by DMA if enabled), which is several times
+	 * faster than pushing byte by byte
+	 *
+	 * @param data
+	 * @param size
+	 */
+	void PushData(const Byte *data, const size_t size);
+
+	/**
+	 * Compute the CRC of @a data in one go, starting from the configured seed
+	 *
+	 * @param data
+	 * @param size
+	 * @return
+	 */
+	uint32_t Compute(const Byte *data, const size_t size)
+	{
+		NewInstance();
+		PushData(data, size);
+		return GetCrc();
+	}
 
 	uint32_t GetCrc() const;
 
 private:
 	void Uninit();
 
+	void PushWords(const uint32_t *data, const size_t count);
+	void PushWordsDma(const uint32_t *data, const size_t count);
+
 	uint32_t m_seed;
+	bool m_is_32_bit;
+	bool m_is_reflect;
+
+	Dma *m_dma;
+	uint16_t m_dma_threshold;
 
 	bool m_is_init;
 };
@@ -13,6 +13,7 @@
 
 #include <functional>
 
+#include "libbase/delegate.h"
 #include "libbase/k60/dma_mux.h"
 #include "libbase/k60/misc_utils.h"
 
@@ -28,8 +29,8 @@ namespace k60
 class Dma
 {
 public:
-	typedef std::function<void(Dma *dma)> OnCompleteListener;
-	typedef std::function<void(Dma *dma)> OnErrorListener;
+	typedef Delegate<void(Dma *dma)> OnCompleteListener;
+	typedef Delegate<void(Dma *dma)> OnErrorListener;
 
 	struct Config
 	{
@@ -122,6 +123,65 @@ public:
 		bool is_disable_request = true;
 	};
 
+	/**
+	 * Transfer Control Descriptor, laid out exactly as the one in hardware such
+	 * that the DMA engine could load it from memory by itself when doing
+	 * scatter/gather. A TCD in memory MUST be 32-byte aligned
+	 */
+	struct Tcd
+	{
+		uint32_t saddr;
+		uint16_t soff;
+		uint16_t attr;
+		uint32_t nbytes;
+		uint32_t slast;
+		uint32_t daddr;
+		uint16_t doff;
+		uint16_t citer;
+		uint32_t dlast_sga;
+		uint16_t csr;
+		uint16_t biter;
+	};
+
+	/**
+	 * Fill @a out_tcd according to @a config, as if it's passed to the
+	 * constructor
+	 *
+	 * @param config
+	 * @param out_tcd
+	 */
+	static void MakeTcd(const Config &config, Tcd *out_tcd);
+	/**
+	 * Link @a tcd to @a next such that the DMA engine would load @a next and
+	 * continue right after finishing @a tcd, without any CPU intervention. The
+	 * major loop interrupt and request disabling of @a tcd are turned off, so
+	 * only the last TCD in a chain would end the transfer
+	 *
+	 * @param tcd
+	 * @param next Must be 32-byte aligned and stay alive during the transfer
+	 */
+	static void LinkTcd(Tcd *tcd, const Tcd *next);
+	/**
+	 * Set the source address and major iteration count of @a tcd
+	 *
+	 * @param tcd
+	 * @param src_addr
+	 * @param major_count
+	 */
+	static void SetTcdSrc(Tcd *tcd, const void *src_addr,
+			const uint16_t major_count);
+	/**
+	 * Set the destination address, offset and major iteration count of
+	 * @a tcd
+	 *
+	 * @param tcd
+	 * @param dst_addr
+	 * @param dst_offset See NodeConfig::offset
+	 * @param major_count
+	 */
+	static void SetTcdDst(Tcd *tcd, void *dst_addr, const int16_t dst_offset,
+			const uint16_t major_count);
+
 	Dma(const Config &config, const Uint channel);
 	explicit Dma(nullptr_t);
 	Dma()
@@ -146,6 +206,26 @@ public:
 	 * @return true if successful, false otherwise
 	 */
 	bool Reinit(const Config &config);
+	/**
+	 * Reinit the DMA channel with @a tcd, which may be the head of a
+	 * scatter/gather chain. The ISRs won't be modified. Effective only when
+	 * IsActive() returns false
+	 *
+	 * @param tcd
+	 * @return true if successful, false otherwise
+	 * @see LinkTcd()
+	 */
+	bool Reinit(const Tcd &tcd);
+
+	/**
+	 * Change the destination address of the channel, typically done in the
+	 * complete ISR to redirect the next transfer into a different buffer.
+	 * Effective only when IsActive() returns false
+	 *
+	 * @param addr
+	 * @return true if successful, false otherwise
+	 */
+	bool SetDstAddr(void *addr);
 
 	void Start();
 	/**
@@ -157,6 +237,14 @@ public:
 	bool IsDone() const;
 	bool IsActive() const;
 
+	/**
+	 * Return the current major iteration count, i.e., the # major iterations
+	 * left before the major loop completes
+	 *
+	 * @return
+	 */
+	uint16_t GetCurrentMajorCount() const;
+
 	Uint GetChannel() const
 	{
 		return m_channel;
@@ -164,10 +252,10 @@ public:
 
 private:
 	void Init(const Config &config);
-	void InitTcdAttrReg(const Config &config);
-	void InitTcdNbytesReg(const Config &config);
-	void InitTcdIterReg(const Config &config);
-	void InitTcdCsrReg(const Config &config);
+	void InitTcd(const Tcd &tcd);
+	static uint16_t GetTcdAttrReg(const Config &config);
+	static uint32_t GetTcdNbytesReg(const Config &config);
+	static uint16_t GetTcdCsrReg(const Config &config);
 
 	void InitEeiReg(const Config &config);
 
@@ -1,6 +1,7 @@
 /*
  * dwt.h
- * Data Watchpoint and Trace, currently only supports utilizing CYCCNT to delay
+ * Data Watchpoint and Trace, utilizing CYCCNT to delay and to measure
+ * time spans
  *
  * Author: Ming Tsang
  * Copyright (c) 2014-2015 HKUST SmartCar Team
@@ -20,6 +21,12 @@ class Dwt
 {
 public:
 	static void DelayUs(const uint16_t us);
+
+	/**
+	 * Enable the free running CYCCNT, without resetting its value, such that
+	 * it could be shared by multiple users measuring time spans
+	 */
+	static void EnableCycleCounter();
 };
 
 }
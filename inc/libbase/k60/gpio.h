@@ -14,6 +14,7 @@
 #include <bitset>
 #include <functional>
 
+#include "libbase/delegate.h"
 #include "libbase/k60/dma.h"
 #include "libbase/k60/pin.h"
 
@@ -27,7 +28,11 @@ class Gpo;
 class Gpi
 {
 public:
-	typedef std::function<void(Gpi *gpi)> OnGpiEventListener;
+	/*
+	 * Larger than the default capacity to fit the typical libsc listener, a
+	 * lambda capturing a std::function and an ID
+	 */
+	typedef Delegate<void(Gpi *gpi), 6 * sizeof(void*)> OnGpiEventListener;
 
 	struct Config
 	{
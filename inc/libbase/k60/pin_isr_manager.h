@@ -9,14 +9,25 @@
 
 #pragma once
 
+#include <cstdint>
+
 #include <bitset>
 #include <functional>
 
+#include "libbase/delegate.h"
 #include "libbase/k60/gpio.h"
 #include "libbase/k60/misc_utils.h"
 #include "libbase/k60/pin.h"
 #include "libbase/k60/pinout.h"
 
+/**
+ * If set to 1, the port handlers record their dispatch latency with the DWT
+ * cycle counter, see PinIsrManager::GetDispatchStats()
+ */
+#ifndef LIBBASE_PIN_ISR_PROFILE
+#define LIBBASE_PIN_ISR_PROFILE 0
+#endif
+
 namespace libbase
 {
 namespace k60
@@ -25,24 +36,39 @@ namespace k60
 class PinIsrManager
 {
 public:
-	typedef std::function<void(const Pin::Name pin)> OnPinIrqListener;
+	typedef Delegate<void(const Pin::Name pin)> OnPinIrqListener;
+
+	struct DispatchStats
+	{
+		uint32_t irq_count = 0;
+		/// Core cycles from entering the port handler to calling the listener
+		uint32_t last_latency_cycles = 0;
+		uint32_t max_latency_cycles = 0;
+		/// Core cycles spent in the whole port handler, listeners included
+		uint32_t max_handler_cycles = 0;
+	};
 
 	static void SetPinIsr(libbase::k60::Pin *pin, const OnPinIrqListener &isr)
 	{
 		GetInstance()->SetPinIsr_(pin, isr);
 	}
 
-private:
-	struct PinData
-	{
-		Pin *pin = nullptr;
-		OnPinIrqListener isr = nullptr;
-	};
+	/**
+	 * Return the dispatch statistics of @a port. Only available when
+	 * LIBBASE_PIN_ISR_PROFILE is set, otherwise all zeros are returned
+	 *
+	 * @param port
+	 * @return
+	 */
+	static DispatchStats GetDispatchStats(const Uint port);
+	static void ResetDispatchStats(const Uint port);
 
+private:
 	PinIsrManager();
 	~PinIsrManager();
 
 	void InitPort(const Uint port);
+	void UninitPort(const Uint port);
 
 	static PinIsrManager* GetInstance();
 
@@ -51,8 +77,14 @@ private:
 	template<Uint port>
 	static __ISR void PortIrqHandler();
 
-	PinData* m_pin_data[PINOUT::GetPortCount()];
+	/// Listeners indexed by the pin number, allocated when a port is first used
+	OnPinIrqListener* m_isrs[PINOUT::GetPortCount()];
+	/// Pins with a listener set, the only ones looked at by the handlers
+	uint32_t m_isr_masks[PINOUT::GetPortCount()];
 	bool m_is_enable[PINOUT::GetPortCount()];
+#if LIBBASE_PIN_ISR_PROFILE
+	DispatchStats m_stats[PINOUT::GetPortCount()];
+#endif
 
 	static PinIsrManager *m_instance;
 };
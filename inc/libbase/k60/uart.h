@@ -30,6 +30,7 @@ class Uart
 public:
 	typedef std::function<void(Uart *uart)> OnRxFullListener;
 	typedef std::function<void(Uart *uart)> OnTxEmptyListener;
+	typedef std::function<void(Uart *uart)> OnRxIdleListener;
 
 	enum struct Name
 	{
@@ -96,6 +97,16 @@ public:
 		uint8_t tx_irq_threshold = 0;
 		/// To treat tx_irq_threshold as a percentage of Tx buffer size
 		bool is_tx_irq_threshold_percentage = false;
+
+		/**
+		 * Triggered when the line turns idle after receiving some data. Mostly
+		 * useful to flush partially filled buffers when Rx is served by DMA.
+		 * TakeRxIdleBytes() must be called at some point afterwards
+		 *
+		 * @see SetEnableRxIdleIrq()
+		 * @see TakeRxIdleBytes()
+		 */
+		OnRxIdleListener rx_idle_isr;
 	};
 
 	explicit Uart(const Config &config);
@@ -162,6 +173,25 @@ public:
 	 */
 	void SetEnableRxIrq(const bool flag);
 	void SetEnableTxIrq(const bool flag);
+	/**
+	 * Enable idle line interrupt, disabled by default
+	 *
+	 * @param flag
+	 * @see Config::rx_idle_isr
+	 */
+	void SetEnableRxIdleIrq(const bool flag);
+
+	/**
+	 * Copy out the bytes left in the FIFO when the idle line flag was cleared,
+	 * which were read out behind the DMA's back. Rx requests are paused while
+	 * there are such bytes, and resumed here, so they come right after what
+	 * the DMA has written so far. Note down the DMA position and call this
+	 * with interrupts masked
+	 *
+	 * @param out_bytes Must hold at least GetRxFifoSize() * 2 bytes
+	 * @return # bytes copied
+	 */
+	size_t TakeRxIdleBytes(Byte *out_bytes);
 
 	/**
 	 * Config this Uart up to be ready to serve Tx as DMA destination, and set
@@ -177,6 +207,20 @@ public:
 	 * @param config
 	 */
 	void ConfigTxAsDmaDst(Dma::Config *config);
+	/**
+	 * Config this Uart up to be ready to serve Rx as DMA source, and set
+	 * @a config accordingly. The following options are also set besides mux_src
+	 * and src:<br>
+	 * Dma::Config::minor_bytes = 1
+	 *
+	 * Rx IRQ will be disabled after invoking this method. Enabling it with
+	 * SetEnableRxIrq() would then trigger DMA requests instead of interrupts
+	 *
+	 * @note To use DMA, Config::rx_isr must NOT be set for this Uart. Otherwise,
+	 * the operation will fail and no changes would be made to @a config
+	 * @param config
+	 */
+	void ConfigRxAsDmaSrc(Dma::Config *config);
 
 private:
 	bool InitModule(const Pin::Name rx_pin, const Pin::Name tx_pin);
@@ -196,11 +240,18 @@ private:
 	std::unique_ptr<Byte[]> m_rx_buf;
 	OnRxFullListener m_rx_isr;
 	OnTxEmptyListener m_tx_isr;
+	OnRxIdleListener m_rx_idle_isr;
 
 	bool m_is_fifo;
 	uint8_t m_rx_fifo_size;
 	uint8_t m_tx_fifo_size;
 
+	/// Bytes read out on idle line, pending TakeRxIdleBytes()
+	std::unique_ptr<Byte[]> m_rx_idle_buf;
+	size_t m_rx_idle_size;
+	/// Whether Rx requests are paused until TakeRxIdleBytes()
+	bool m_is_rx_idle_paused;
+
 	Pin m_rx;
 	Pin m_tx;
 
@@ -14,6 +14,7 @@
 #include <bitset>
 #include <functional>
 
+#include "libbase/delegate.h"
 #include "libbase/kl26/pin.h"
 
 namespace libbase
@@ -26,7 +27,11 @@ class Gpo;
 class Gpi
 {
 public:
-	typedef std::function<void(Gpi *gpi)> OnGpiEventListener;
+	/*
+	 * Larger than the default capacity to fit the typical libsc listener, a
+	 * lambda capturing a std::function and an ID
+	 */
+	typedef Delegate<void(Gpi *gpi), 6 * sizeof(void*)> OnGpiEventListener;
 
 	struct Config
 	{
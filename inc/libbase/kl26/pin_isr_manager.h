@@ -10,9 +10,12 @@
 
 #pragma once
 
+#include <cstdint>
+
 #include <bitset>
 #include <functional>
 
+#include "libbase/delegate.h"
 #include "libbase/kl26/gpio.h"
 #include "libbase/kl26/misc_utils.h"
 #include "libbase/kl26/pin.h"
@@ -26,7 +29,7 @@ namespace kl26
 class PinIsrManager
 {
 public:
-	typedef std::function<void(const Pin::Name pin)> OnPinIrqListener;
+	typedef Delegate<void(const Pin::Name pin)> OnPinIrqListener;
 
 	static void SetPinIsr(libbase::kl26::Pin *pin, const OnPinIrqListener &isr)
 	{
@@ -34,16 +37,11 @@ public:
 	}
 
 private:
-	struct PinData
-	{
-		Pin *pin = nullptr;
-		OnPinIrqListener isr = nullptr;
-	};
-
 	PinIsrManager();
 	~PinIsrManager();
 
 	void InitPort(const Uint port);
+	void UninitPort(const Uint port);
 
 	static PinIsrManager* GetInstance();
 
@@ -51,8 +49,12 @@ private:
 
 	template<Uint port>
 	static __ISR void PortIrqHandler();
+	static void DispatchPort(const Uint port);
 
-	PinData* m_pin_data[PINOUT::GetPortCount()];
+	/// Listeners indexed by the pin number, allocated when a port is first used
+	OnPinIrqListener* m_isrs[PINOUT::GetPortCount()];
+	/// Pins with a listener set, the only ones looked at by the handlers
+	uint32_t m_isr_masks[PINOUT::GetPortCount()];
 	bool m_is_enable[PINOUT::GetPortCount()];
 
 	static PinIsrManager *m_instance;
@@ -13,6 +13,7 @@
 
 #include <functional>
 
+#include "libbase/delegate.h"
 #include "libbase/kl26/misc_utils.h"
 
 namespace libbase
@@ -23,7 +24,7 @@ namespace kl26
 class Pit
 {
 public:
-	typedef std::function<void(Pit *pit)> OnPitTriggerListener;
+	typedef Delegate<void(Pit *pit)> OnPitTriggerListener;
 
 	struct Config
 	{
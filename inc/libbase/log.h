@@ -10,6 +10,39 @@
 
 #include <stdio.h>
 
+#if defined(__cplusplus) && defined(LIBBASE_DEFERRED_LOG)
+/*
+ * Records are stored in RAM and sent later, see libbase::DeferredLog. The
+ * address of the format string literal serves as its ID
+ */
+#include "libbase/deferred_log.h"
+
+#define LIBBASE_LOG_DEFER(level, fmt, ...) \
+		libbase::DeferredLog::Write(level " " fmt, ##__VA_ARGS__)
+
+#define LOG_E(fmt, ...) LIBBASE_LOG_DEFER("E", fmt, ##__VA_ARGS__)
+#define LOG_W(fmt, ...) LIBBASE_LOG_DEFER("W", fmt, ##__VA_ARGS__)
+#define LOG_I(fmt, ...) LIBBASE_LOG_DEFER("I", fmt, ##__VA_ARGS__)
+#ifdef DEBUG
+	#define LOG_D(fmt, ...) LIBBASE_LOG_DEFER("D", fmt, ##__VA_ARGS__)
+	#define LOG_V(fmt, ...) LIBBASE_LOG_DEFER("V", fmt, ##__VA_ARGS__)
+#else
+	#define LOG_D(fmt, ...)
+	#define LOG_V(fmt, ...)
+#endif /* DEBUG */
+
+#define LOG_EL(literal) LIBBASE_LOG_DEFER("E", literal)
+#define LOG_WL(literal) LIBBASE_LOG_DEFER("W", literal)
+#define LOG_IL(literal) LIBBASE_LOG_DEFER("I", literal)
+#ifdef DEBUG
+	#define LOG_DL(literal) LIBBASE_LOG_DEFER("D", literal)
+	#define LOG_VL(literal) LIBBASE_LOG_DEFER("V", literal)
+#else
+	#define LOG_DL(literal)
+	#define LOG_VL(literal)
+#endif /* DEBUG */
+
+#else
 #define LOG_E(fmt, ...) printf("E " fmt "\n", ##__VA_ARGS__)
 #define LOG_W(fmt, ...) printf("W " fmt "\n", ##__VA_ARGS__)
 #define LOG_I(fmt, ...) printf("I " fmt "\n", ##__VA_ARGS__)
@@ -31,3 +64,5 @@
 	#define LOG_DL(literal)
 	#define LOG_VL(literal)
 #endif /* DEBUG */
+
+#endif
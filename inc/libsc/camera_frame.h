@@ -0,0 +1,49 @@
+/*
+ * camera_frame.h
+ * Descriptor of a captured camera frame
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libbase/misc_types.h"
+
+namespace libsc
+{
+
+/**
+ * A frame handed out by a camera driver, along with when it was captured and
+ * how many frames have been lost so far. Shared by all camera drivers
+ */
+struct CameraFrame
+{
+	/// Image data, in the format of the respective driver
+	const Byte *buffer = nullptr;
+	size_t size = 0;
+	/**
+	 * Sequence # of the frame, starting from 1. 0 means no frame has been
+	 * captured yet. Compare with the previous one to tell whether it's the
+	 * same frame, or how many have been skipped
+	 */
+	uint32_t seq = 0;
+	/// System::TimeUs() at the VSYNC starting the frame
+	uint64_t timestamp_us = 0;
+	/**
+	 * Total # frames captured but replaced by newer ones before reaching the
+	 * consumer
+	 */
+	uint32_t dropped_count = 0;
+	/**
+	 * Total # frames not captured at all, because the hardware was still busy
+	 * with the previous one or no buffer was available
+	 */
+	uint32_t overrun_count = 0;
+};
+
+}
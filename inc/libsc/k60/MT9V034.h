@@ -18,12 +18,17 @@
 #include "libbase/helper.h"
 #include LIBBASE_H(soft_sccb_master)
 
+#include "libsc/camera_frame.h"
+#include "libutil/row_band_plan.h"
+
 namespace libsc {
 namespace k60 {
 
 class MT9V034 {
 public:
 	struct Config {
+		static constexpr Uint kMaxRowRanges = 4;
+
 		enum binning {
 			k1, k2, k4
 		};
@@ -64,6 +69,15 @@ public:
 		bool AEC = true;
 		//Auto Gain Control Enable
 		bool AGC = true;
+		//Rows to capture, in rows of the binned image. Rows outside all the
+		//ranges are never written to RAM, and those above the first or below
+		//the last range are not even read out from the sensor. The whole
+		//frame is captured if row_range_count is 0
+		libutil::RowBandPlan::Range row_ranges[kMaxRowRanges];
+		uint8_t row_range_count = 0;
+		//Capture only every n-th row in row_ranges. Each gap between two kept
+		//rows costs an extra DMA TCD (32 bytes)
+		uint8_t row_stride = 1;
 	};
 
 	explicit MT9V034(const Config &config);
@@ -93,10 +107,18 @@ public:
 	 * will be dropped until UnlockBuffer() is called (i.e., the buffer is
 	 * guaranteed to stay unchanged)
 	 *
-	 * @return Reference to the image buffer, 1 pixel/byte
+	 * @return Reference to the image buffer, 1 pixel/byte, GetW() * GetH()
+	 * @see GetRowPlan()
 	 */
 	const Byte* LockBuffer();
 	void UnlockBuffer();
+	/**
+	 * Same as LockBuffer(), but return the frame along with its metadata
+	 *
+	 * @return
+	 * @see LockBuffer()
+	 */
+	CameraFrame LockFrame();
 
 	Uint GetW() const {
 		return m_w;
@@ -106,10 +128,26 @@ public:
 		return m_h;
 	}
 
+	/**
+	 * Return the plan of the captured rows, e.g., to map a row in the buffer
+	 * back to the binned frame with RowBandPlan::GetSourceRow()
+	 *
+	 * @return
+	 */
+	const libutil::RowBandPlan& GetRowPlan() const {
+		return m_row_plan;
+	}
+
 private:
 	void RegSet(uint8_t reg_addr, uint16_t value);
 
 	void InitDma();
+	/**
+	 * Point the DMA to @a buf for the next frame
+	 *
+	 * @param buf
+	 */
+	void SetDmaDst(Byte *buf);
 
 	void OnLine(libbase::k60::Gpi *gpi);
 	void OnVsync(libbase::k60::Gpi *gpi);
@@ -121,12 +159,24 @@ private:
 	libbase::k60::Gpi m_vsync;
 	libbase::k60::Dma *m_dma;
 	libbase::k60::Dma::Config m_dma_config;
+	/// Scatter/gather chain, one TCD per band, or nullptr if not needed
+	libbase::k60::Dma::Tcd *m_tcds;
+	std::unique_ptr<Byte[]> m_tcd_mem;
+	/// Sink of the discarded bands
+	Byte m_scratch;
 
 	Uint m_w;
+	libutil::RowBandPlan m_row_plan;
 	Uint m_h;
 	Uint m_buf_size;
 	std::unique_ptr<Byte[]> m_front_buf;
 	std::unique_ptr<Byte[]> m_back_buf;
+	/// Metadata of the frames in m_front_buf and m_back_buf
+	CameraFrame m_frames[2];
+	uint64_t m_vsync_time;
+	uint32_t m_seq;
+	volatile uint32_t m_dropped_count;
+	volatile uint32_t m_overrun_count;
 
 	bool m_is_shoot;
 	bool m_is_lock_buffer;
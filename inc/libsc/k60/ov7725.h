@@ -17,7 +17,9 @@
 #include "libbase/k60/gpio.h"
 #include "libbase/k60/gpio_array.h"
 
+#include "libsc/camera_frame.h"
 #include "libsc/k60/ov7725_configurator.h"
+#include "libutil/triple_buffer.h"
 
 namespace libsc
 {
@@ -65,14 +67,24 @@ public:
 		return m_is_available;
 	}
 	/**
-	 * Lock and return the buffer. When the buffer is locked, new incoming frame
-	 * will be dropped until UnlockBuffer() is called (i.e., the buffer is
-	 * guaranteed to stay unchanged)
+	 * Lock and return the latest complete frame. The buffer is guaranteed to
+	 * stay unchanged until the next LockBuffer() call, while new frames keep
+	 * being captured into the other buffers
 	 *
 	 * @return Reference to the image buffer, 8 pixel/byte
 	 */
 	const Byte* LockBuffer();
+	/**
+	 * Kept for compatibility, capturing is never blocked by a locked buffer
+	 */
 	void UnlockBuffer();
+	/**
+	 * Same as LockBuffer(), but return the frame along with its metadata
+	 *
+	 * @return
+	 * @see LockBuffer()
+	 */
+	CameraFrame LockFrame();
 
 	void ChangeSecialDigitalEffect(uint8_t brightness, uint8_t contrast) {
 		m_config.ChangeSecialDigitalEffect(brightness, contrast);
@@ -99,6 +111,11 @@ private:
 	void OnVsync(libbase::k60::Gpi *gpi);
 	void OnDmaComplete(libbase::k60::Dma *dma);
 
+	Byte* GetBuffer(const uint8_t index)
+	{
+		return m_bufs.get() + index * m_buf_size;
+	}
+
 	libsc::k60::Ov7725Configurator m_config;
 	libbase::k60::GpiArray m_data_array;
 	libbase::k60::Gpi m_clock;
@@ -108,11 +125,17 @@ private:
 	Uint m_w;
 	Uint m_h;
 	Uint m_buf_size;
-	std::unique_ptr<Byte[]> m_front_buf;
-	std::unique_ptr<Byte[]> m_back_buf;
+	/// Three frame buffers, rotated by m_rotation
+	std::unique_ptr<Byte[]> m_bufs;
+	libutil::TripleBuffer m_rotation;
+	/// Metadata of the frames in m_bufs
+	CameraFrame m_frames[3];
+	uint64_t m_vsync_time;
+	uint32_t m_seq;
+	volatile uint32_t m_dropped_count;
+	volatile uint32_t m_overrun_count;
 
 	bool m_is_shoot;
-	bool m_is_lock_buffer;
 	volatile bool m_is_available;
 	volatile bool m_is_dma_start;
 };
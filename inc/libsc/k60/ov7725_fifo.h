@@ -15,6 +15,7 @@
 #include "libbase/k60/gpio.h"
 #include "libbase/misc_types.h"
 
+#include "libsc/camera_frame.h"
 #include "libsc/k60/al422b.h"
 #include "libsc/k60/ov7725.h"
 #include "libsc/k60/ov7725_configurator.h"
@@ -58,6 +59,15 @@ public:
 		return m_fifo.GetData();
 	}
 
+	/**
+	 * Return the raw data along with its metadata. Only meaningful after
+	 * ReadStep() returns true
+	 *
+	 * @return
+	 * @see GetData()
+	 */
+	CameraFrame GetFrame() const;
+
 	/**
 	 * Return the transformed data, as a RGB565 array
 	 *
@@ -94,6 +104,10 @@ private:
 	Uint m_h;
 
 	volatile State m_write_state;
+
+	volatile uint64_t m_vsync_time;
+	volatile uint32_t m_seq;
+	uint32_t m_overrun_count;
 };
 
 }
@@ -17,10 +17,13 @@
 #include <string>
 #include <vector>
 
+#include "libbase/delegate.h"
 #include "libbase/k60/dma.h"
 #include "libbase/k60/misc_utils.h"
 #include "libbase/k60/uart.h"
 
+#include "libutil/byte_ring_buffer.h"
+
 namespace libsc
 {
 namespace k60
@@ -29,9 +32,41 @@ namespace k60
 class UartDevice
 {
 public:
-	typedef std::function<bool(const Byte *data, const size_t size)>
+	typedef libbase::Delegate<bool(const Byte *data, const size_t size)>
 			OnReceiveListener;
 
+	/**
+	 * What to do when a Send* call would exceed the Tx budget
+	 */
+	enum struct TxOverflowPolicy
+	{
+		/// Reject the new data
+		kDropNewest,
+		/// Drop the oldest queued data that is not being sent yet to make room
+		kDropOldest,
+		/**
+		 * Replace the queued data of the same channel that is not being sent
+		 * yet, i.e., only the latest data of a channel will be kept. Data
+		 * without a channel, or those that can't be coalesced, are rejected
+		 */
+		kCoalesce,
+	};
+
+	struct TxStats
+	{
+		/// # bytes accepted by Send*
+		uint32_t queued_bytes = 0;
+		/// # bytes sent out
+		uint32_t sent_bytes = 0;
+		/// # bytes rejected or removed from the queue due to overflow
+		uint32_t dropped_bytes = 0;
+		/// Max # bytes waiting in the queue at the same time
+		uint32_t high_water_bytes = 0;
+	};
+
+	/// Channel of the data sent without specifying one
+	static constexpr uint8_t kNoChannel = static_cast<uint8_t>(-1);
+
 	struct Config
 	{
 		uint8_t id;
@@ -54,11 +89,52 @@ public:
 		 * size in bytes will vary
 		 */
 		uint8_t tx_buf_size = 14;
+		/**
+		 * Max # bytes allowed to queue up for Tx, 0 for no limit. When a Send*
+		 * call would exceed this budget, tx_overflow_policy will apply
+		 */
+		uint32_t tx_buf_bytes = 0;
+		/**
+		 * Policy when tx_buf_bytes, or tx_buf_size, is exceeded. Ignored if
+		 * the Tx ring is used, in which case it's always
+		 * TxOverflowPolicy::kDropNewest
+		 */
+		TxOverflowPolicy tx_overflow_policy = TxOverflowPolicy::kDropNewest;
+		/**
+		 * If non-zero, Tx will be backed by a byte ring of this many bytes
+		 * instead, and tx_buf_size and tx_buf_bytes are ignored. Send* calls
+		 * then copy into the ring without touching the heap, and data could
+		 * also be written in place with ReserveTx()/CommitTx(). Sending from
+		 * ISRs is fine, but fails while the interrupted code is between
+		 * ReserveTx() and CommitTx()
+		 */
+		uint16_t tx_ring_size = 0;
 		/**
 		 * (Experimental) If value != -1, DMA will be enabled for this UART's Tx,
 		 * using the DMA channel specified here
 		 */
 		uint8_t tx_dma_channel = static_cast<uint8_t>(-1);
+		/**
+		 * Max # of queued Send* calls to be sent in one go with DMA, by
+		 * linking them up as a scatter/gather chain. The DMA engine would then
+		 * walk the chain without any CPU intervention in between. Set to 1 to
+		 * disable chaining. Has no effect if DMA is not used
+		 */
+		uint8_t tx_dma_chain_length = 8;
+
+		/**
+		 * (Experimental) If value != -1, DMA will be enabled for this UART's Rx,
+		 * using the DMA channel specified here. Received bytes are then written
+		 * to a double buffer by DMA and delivered in spans, either when one
+		 * half is filled, or when the line turns idle. rx_irq_threshold is
+		 * ignored in this mode
+		 */
+		uint8_t rx_dma_channel = static_cast<uint8_t>(-1);
+		/**
+		 * Size of each half of the Rx DMA double buffer, at most 0x3FFF. Has
+		 * no effect if DMA is not used
+		 */
+		uint16_t rx_dma_buf_size = 64;
 
 		/**
 		 * The listener for Rx events. Return true if the listener has consumed
@@ -115,6 +191,17 @@ public:
 	 * @return true if successful, false otherwise (say, tx buffer is full)
 	 */
 	bool SendBuffer(std::vector<Byte> &&buf);
+	/**
+	 * Send a buffer through UART, tagged with @a channel. A copy will be
+	 * queued. The channel is used to coalesce data with
+	 * TxOverflowPolicy::kCoalesce, and ignored otherwise
+	 *
+	 * @param buf
+	 * @param len
+	 * @param channel
+	 * @return true if successful, false otherwise (say, tx buffer is full)
+	 */
+	bool SendBuffer(const Byte *buf, const size_t len, const uint8_t channel);
 
 	/**
 	 * Send a string literal through UART. MUST ONLY be used with string
@@ -124,6 +211,58 @@ public:
 	 * @return true if successful, false otherwise (say, tx buffer is full)
 	 */
 	bool SendStrLiteral(const char *str);
+	/**
+	 * Send a buffer through UART without copying it. @a buf must stay intact
+	 * until IsTxIdle() returns true
+	 *
+	 * @param buf
+	 * @param len
+	 * @return true if successful, false otherwise (say, tx buffer is full)
+	 */
+	bool SendBufferNoCopy(const Byte *buf, const size_t len);
+	/**
+	 * Return whether everything queued has been sent, i.e., the buffers
+	 * passed to SendBufferNoCopy() could be reused
+	 *
+	 * @return
+	 */
+	bool IsTxIdle() const
+	{
+		return m_is_tx_idle;
+	}
+
+	/**
+	 * Reserve @a size contiguous bytes in the Tx ring to be written in place,
+	 * the data will only be sent after CommitTx(). Only available when
+	 * Config::tx_ring_size is set
+	 *
+	 * Only one reservation could be open at a time. Until it's committed, any
+	 * other Send* call or ReserveTx() on this device, say, from an ISR, fails
+	 * and is counted as dropped. Keep the region short-lived
+	 *
+	 * @param size
+	 * @return Pointer to the reserved region, or nullptr if there isn't enough
+	 * space, another reservation is open or the Tx ring is not in use
+	 */
+	Byte* ReserveTx(const size_t size);
+	/**
+	 * Queue the first @a size bytes written to the region returned by the last
+	 * ReserveTx()
+	 *
+	 * @param size
+	 */
+	void CommitTx(const size_t size);
+	/**
+	 * Return whether Tx is backed by the byte ring, i.e., ReserveTx() is
+	 * available
+	 *
+	 * @return
+	 * @see Config::tx_ring_size
+	 */
+	bool IsTxRingEnabled() const
+	{
+		return (bool)m_tx_ring;
+	}
 
 	bool SendStr(const std::string &str)
 	{
@@ -143,6 +282,18 @@ public:
 
 	void SetRxIsr(const OnReceiveListener &l);
 
+	/**
+	 * Return a snapshot of the Tx statistics
+	 *
+	 * @return
+	 */
+	TxStats GetTxStats() const;
+	/**
+	 * Reset the Tx statistics. The high-water mark will be reset to the # bytes
+	 * currently queued
+	 */
+	void ResetTxStats();
+
 protected:
 	/**
 	 * Use to initialize the UartDevice in possibly a polymorphic way, notice
@@ -165,6 +316,7 @@ protected:
 private:
 	struct RxBuffer;
 	class TxBuffer;
+	struct TxBlock;
 
 	inline void EnableRx();
 	inline void DisableRx();
@@ -172,20 +324,93 @@ private:
 	inline void DisableTx();
 	inline bool IsUseDma();
 
+	bool PushTxRing(const Byte *data, const size_t size);
+	/**
+	 * Queue @a block, applying the budget and overflow policy
+	 *
+	 * @param block
+	 * @return true if queued, false if dropped
+	 */
+	bool PushTxBlock(TxBlock &&block);
+	inline bool IsTxFit(const size_t size) const;
+	/**
+	 * Drop the oldest blocks that are not being sent until @a size more bytes
+	 * could fit
+	 *
+	 * @param size
+	 */
+	void DropOldestTx(const size_t size);
+	/**
+	 * Replace a queued block of the same channel with @a block
+	 *
+	 * @param block
+	 * @return true if replaced, false if no suitable block is found
+	 */
+	bool CoalesceTx(TxBlock *block);
+	inline bool IsTxBlockPending(const size_t offset);
+	inline void OnTxQueued(const size_t size);
+	inline void OnTxSent(const size_t size);
 	void NextTxDma();
 
+	/**
+	 * Pass @a data to the Rx listener, or push it to the internal buffer if
+	 * it's not consumed
+	 *
+	 * @param data
+	 * @param size
+	 */
+	void DeliverRx(const Byte *data, const size_t size);
+	void PushRxBuffer(const Byte *data, const size_t size);
+	/**
+	 * Deliver everything written by Rx DMA since the last flush, followed by
+	 * the bytes the UART read out on idle line
+	 */
+	void FlushRxDma();
+
 	void OnTxEmpty(libbase::k60::Uart *uart);
 	void OnTxDmaComplete(libbase::k60::Dma *dma);
 	void OnRxFull(libbase::k60::Uart *uart);
+	void OnRxDmaComplete(libbase::k60::Dma *dma);
+	void OnRxIdle(libbase::k60::Uart *uart);
 
 	std::unique_ptr<volatile RxBuffer> m_rx_buf;
 	OnReceiveListener m_rx_isr;
 
+	libbase::k60::Dma *m_rx_dma;
+	/// Circular buffer written by Rx DMA, consisting of two halves
+	std::unique_ptr<Byte[]> m_rx_dma_buf;
+	size_t m_rx_dma_buf_size;
+	/// Position in m_rx_dma_buf up to where the data has been delivered
+	size_t m_rx_dma_pos;
+	/// Bytes taken from Uart::TakeRxIdleBytes() in FlushRxDma()
+	std::unique_ptr<Byte[]> m_rx_idle_buf;
+	/// Whether FlushRxDma() is running, guarded by IrqLock
+	bool m_is_rx_flushing;
+	/// Whether a nested FlushRxDma() asked for another round
+	bool m_is_rx_flush_pending;
+
 	std::unique_ptr<TxBuffer> m_tx_buf;
+	std::unique_ptr<libutil::ByteRingBuffer> m_tx_ring;
 	volatile bool m_is_tx_idle;
+	/// Whether a ReserveTx() is pending CommitTx(), guarded by IrqLock
+	bool m_is_tx_reserved;
+	uint32_t m_tx_budget;
+	TxOverflowPolicy m_tx_policy;
+	/// # bytes queued but not yet sent
+	volatile uint32_t m_tx_pending_bytes;
+	TxStats m_tx_stats;
 
 	std::unique_ptr<libbase::k60::Dma::Config> m_dma_config;
 	libbase::k60::Dma *m_dma;
+	/// Size of the ring region being transferred by DMA
+	size_t m_tx_dma_size;
+	std::unique_ptr<Byte[]> m_tx_tcd_mem;
+	/// Scatter/gather chain, pointing to 32-byte aligned memory in m_tx_tcd_mem
+	libbase::k60::Dma::Tcd *m_tx_tcds;
+	libbase::k60::Dma::Tcd m_tx_tcd_template;
+	uint8_t m_tx_tcd_count;
+	/// # blocks being transferred by the current chain
+	uint8_t m_tx_dma_block_count;
 
 	libbase::k60::Uart m_uart;
 };
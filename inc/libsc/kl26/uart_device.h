@@ -17,6 +17,7 @@
 #include <string>
 #include <vector>
 
+#include "libbase/delegate.h"
 #include "libbase/helper.h"
 #include "libbase/misc_types.h"
 #include LIBBASE_H(uart)
@@ -29,7 +30,7 @@ namespace kl26
 class UartDevice
 {
 public:
-	typedef std::function<bool(const Byte)> OnReceiveListener;
+	typedef libbase::Delegate<bool(const Byte)> OnReceiveListener;
 
 	struct Config
 	{
@@ -108,6 +109,25 @@ public:
 	 * @return true if successful, false otherwise (say, tx buffer is full)
 	 */
 	bool SendStrLiteral(const char *str);
+	/**
+	 * Send a buffer through UART without copying it. @a buf must stay intact
+	 * until IsTxIdle() returns true
+	 *
+	 * @param buf
+	 * @param len
+	 * @return true if successful, false otherwise (say, tx buffer is full)
+	 */
+	bool SendBufferNoCopy(const Byte *buf, const size_t len);
+	/**
+	 * Return whether everything queued has been sent, i.e., the buffers
+	 * passed to SendBufferNoCopy() could be reused
+	 *
+	 * @return
+	 */
+	bool IsTxIdle() const
+	{
+		return m_is_tx_idle;
+	}
 
 	bool SendStr(const std::string &str)
 	{
@@ -21,7 +21,7 @@
 #include "libsc/config.h"
 #include "libsc/lcd.h"
 #include "libsc/next/st7735r_cmd.h"
-#include "libutil/fixed_circular_buffer.h"
+#include "libutil/spsc_ring_buffer.h"
 
 namespace libsc
 {
@@ -46,11 +46,13 @@ public:
 		 * The size of the Tx buffer. Old data will be poped when the buffer
 		 * overflows. Notice that this size is not in bytes, but rather the
 		 * number of Send* calls. Depending on the use case, the actualy buffer
-		 * size in bytes will vary
+		 * size in bytes will vary. Capped at kMaxTxBufSize
 		 */
 		uint8_t tx_buf_size = 14;
 	};
 
+	static constexpr size_t kMaxTxBufSize = 16;
+
 	explicit St7735r(const Config &config);
 
 	~St7735r() override{}
@@ -84,6 +86,24 @@ public:
 
 	void SetInvertColor(const bool flag);
 
+	/**
+	 * Delete the commands already sent by the ISR. This is done on every Fill*
+	 * call anyway, call it in the main loop if the screen may stay untouched
+	 * for a while, otherwise the last few commands (e.g., a full screen
+	 * FillPixel() copy of ~40KB) are kept until the next draw
+	 */
+	void Update();
+
+	/**
+	 * Return whether all the pending commands have been sent
+	 *
+	 * @return
+	 */
+	bool IsTxIdle() const
+	{
+		return m_is_tx_idle;
+	}
+
 	static constexpr Uint GetW()
 	{
 		return kW;
@@ -113,7 +133,20 @@ private:
 	void SetSendCmd(const bool flag);
 	inline void Send(const bool is_cmd, const uint8_t data);
 
-	libutil::FixedCircularBuffer<std::unique_ptr<St7735rCmd>> m_tx_buf;
+	bool PushCmd(std::unique_ptr<St7735rCmd> &&cmd);
+
+	/// Filled in the main loop, drained in the SPI ISR
+	libutil::SpscRingBuffer<std::unique_ptr<St7735rCmd>, kMaxTxBufSize>
+			m_tx_buf;
+	/**
+	 * Finished commands handed back by the SPI ISR, such that they are
+	 * deleted in the main loop instead, as the heap is not reentrant. It's
+	 * emptied on every PushCmd() and Update(), and the ISR could only move in what's in
+	 * m_tx_buf (plus one racing with the emptying) in the meantime
+	 */
+	libutil::SpscRingBuffer<std::unique_ptr<St7735rCmd>, kMaxTxBufSize * 2>
+			m_tx_done_buf;
+	size_t m_tx_buf_size;
 	volatile bool m_is_tx_idle;
 	Uint m_buf_start;
 	Uint m_data_it;
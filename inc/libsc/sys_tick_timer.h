@@ -41,6 +41,18 @@ public:
 	}
 #endif
 
+#if MK60DZ10 || MK60D10 || MK60F15
+	/**
+	 * Return the # core cycles elapsed since construction, by extending the
+	 * 32-bit DWT cycle counter to 64-bit. The counter wraps around every
+	 * ~20 s, way longer than the tick period, so every wrap is caught in the
+	 * tick ISR
+	 *
+	 * @return
+	 */
+	uint64_t TimeCycles();
+#endif
+
 private:
 	void OnTick(LIBBASE_MODULE(SysTick)*);
 
@@ -51,6 +63,14 @@ private:
 #else
 	volatile TimerInt m_125us;
 #endif
+
+#if MK60DZ10 || MK60D10 || MK60F15
+	uint32_t m_cycle_base;
+	/// CYCCNT as seen in the last tick
+	volatile uint32_t m_cycle_prev;
+	/// # times CYCCNT has wrapped around since construction
+	volatile uint32_t m_cycle_wrap;
+#endif
 };
 
 }
@@ -35,6 +35,24 @@ public:
 #ifdef USE_TIME_IN_125US
 	static Timer::TimerInt TimeIn125us();
 #endif
+	/**
+	 * Return the time elapsed, in us, since Init(). The 64-bit value won't
+	 * wrap around in practice, so the difference of two timestamps is always
+	 * valid. On K60 the value is derived from the DWT cycle counter, on KL26
+	 * it only has ms resolution
+	 *
+	 * @return
+	 * @see TimeCycles()
+	 */
+	static uint64_t TimeUs();
+	/**
+	 * Return the # core clock cycles elapsed since Init(). Cheaper than
+	 * TimeUs() as no division is involved, useful to measure short spans. On
+	 * KL26 it only has ms resolution
+	 *
+	 * @return
+	 */
+	static uint64_t TimeCycles();
 
 private:
 	struct Impl;
@@ -0,0 +1,136 @@
+/*
+ * binary_image.h
+ * Bit-parallel kernels for 1bpp images
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libbase/misc_types.h"
+
+namespace libutil
+{
+
+/**
+ * Image processing on 1bpp frames (e.g., those from Ov7725::LockBuffer()),
+ * working on 32 pixels at a time instead of unpacking them one by one. A row
+ * is (w + 7) / 8 bytes, MSB being the leftmost pixel, the same as
+ * CameraCodec::Format::kBinary. Rows need not be word aligned. Pixels
+ * outside the image are taken as clear (0), and the padding bits at the end
+ * of a row are always written as 0
+ *
+ * It has no hardware dependency and could be compiled on the host side as
+ * well
+ */
+class BinaryImage
+{
+public:
+	/**
+	 * A horizontal run of set pixels, [begin, end)
+	 */
+	struct Run
+	{
+		uint16_t begin;
+		uint16_t end;
+	};
+
+	static size_t GetRowBytes(const Uint w)
+	{
+		return (w + 7) / 8;
+	}
+
+	/**
+	 * Extract the runs of set pixels in @a row, from left to right
+	 *
+	 * @param row
+	 * @param w
+	 * @param out_runs
+	 * @param max_runs Size of @a out_runs, extra runs are ignored
+	 * @return # runs written to @a out_runs
+	 */
+	static size_t GetRuns(const Byte *row, const Uint w, Run *out_runs,
+			const size_t max_runs);
+
+	/**
+	 * Return the first pixel at or to the right of @a from that equals
+	 * @a value, e.g., the right edge of a track when scanning from the middle
+	 *
+	 * @param row
+	 * @param w
+	 * @param from
+	 * @param value
+	 * @return Position of the pixel, or -1 if not found
+	 */
+	static int FindNext(const Byte *row, const Uint w, const Uint from,
+			const bool value);
+	/**
+	 * Return the first pixel at or to the left of @a from that equals
+	 * @a value, e.g., the left edge of a track when scanning from the middle
+	 *
+	 * @param row
+	 * @param w
+	 * @param from Clamped to w - 1
+	 * @param value
+	 * @return Position of the pixel, or -1 if not found
+	 */
+	static int FindPrev(const Byte *row, const Uint w, const Uint from,
+			const bool value);
+
+	/**
+	 * Erode/dilate @a src with a 3x1 (horizontal) or 1x3 (vertical)
+	 * structuring element, i.e., a pixel is kept set only if both of its
+	 * neighbors are also set (erosion), or becomes set if either neighbor is
+	 * set (dilation). Call repeatedly for larger elements, a 3x3 square is
+	 * simply a horizontal pass followed by a vertical one
+	 *
+	 * @param src
+	 * @param w
+	 * @param h
+	 * @param dst Must not overlap with @a src
+	 */
+	static void ErodeH(const Byte *src, const Uint w, const Uint h, Byte *dst);
+	static void ErodeV(const Byte *src, const Uint w, const Uint h, Byte *dst);
+	static void DilateH(const Byte *src, const Uint w, const Uint h,
+			Byte *dst);
+	static void DilateV(const Byte *src, const Uint w, const Uint h,
+			Byte *dst);
+
+	/**
+	 * Return the # set pixels in @a row
+	 *
+	 * @param row
+	 * @param w
+	 * @return
+	 */
+	static Uint CountRow(const Byte *row, const Uint w);
+	/**
+	 * Count the set pixels in each row
+	 *
+	 * @param data
+	 * @param w
+	 * @param h
+	 * @param out_counts h elements
+	 */
+	static void CountRows(const Byte *data, const Uint w, const Uint h,
+			uint16_t *out_counts);
+	/**
+	 * Count the set pixels in each column. 32 columns are summed in parallel
+	 * with bit-sliced counters, so the cost per row is about that of an
+	 * addition per 32 pixels
+	 *
+	 * @param data
+	 * @param w
+	 * @param h
+	 * @param out_counts w elements
+	 */
+	static void ProjectColumns(const Byte *data, const Uint w, const Uint h,
+			uint16_t *out_counts);
+};
+
+}
@@ -0,0 +1,101 @@
+/*
+ * byte_ring_buffer.h
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+
+#include "libbase/misc_types.h"
+
+namespace libutil
+{
+
+/**
+ * A fixed size byte buffer that always hands out contiguous regions, such that
+ * the producer could write data in place and the consumer (say, a DMA channel)
+ * could read them in place. The buffer is safe to be shared by exactly one
+ * producer and one consumer running in different contexts (e.g., the main loop
+ * and an ISR)
+ *
+ * When a reservation doesn't fit in the tail of the buffer, it will be
+ * wrapped to the beginning and the unused tail will be skipped by the consumer
+ */
+class ByteRingBuffer
+{
+public:
+	explicit ByteRingBuffer(const size_t capacity);
+
+	/**
+	 * Reserve @a size contiguous bytes for writing. The region is not visible
+	 * to the consumer until Commit() is called. A new reservation will replace
+	 * the previous uncommitted one
+	 *
+	 * @param size
+	 * @return Pointer to the reserved region, or nullptr if there isn't enough
+	 * contiguous space
+	 */
+	Byte* Reserve(const size_t size);
+	/**
+	 * Publish the first @a size bytes of the last reservation to the consumer
+	 *
+	 * @param size Must not be larger than the reserved size
+	 */
+	void Commit(const size_t size);
+
+	/**
+	 * Return the next contiguous region ready to be read. The region stays
+	 * valid until Consume() is called
+	 *
+	 * @param out_size Size of the returned region, 0 if the buffer is empty
+	 * @return Pointer to the region, or nullptr if the buffer is empty
+	 */
+	const Byte* GetReadable(size_t *out_size);
+	/**
+	 * Release the first @a size bytes of the region returned by GetReadable()
+	 *
+	 * @param size
+	 */
+	void Consume(const size_t size);
+
+	/**
+	 * Return the # bytes committed but not yet consumed. The value is only a
+	 * snapshot if called while the other party is active
+	 *
+	 * @return
+	 */
+	size_t GetSize() const;
+
+	size_t GetCapacity() const
+	{
+		return m_capacity;
+	}
+
+	bool IsEmpty() const
+	{
+		return (m_read == m_write);
+	}
+
+private:
+	const size_t m_capacity;
+	std::unique_ptr<Byte[]> m_data;
+
+	/// Owned by the consumer
+	volatile size_t m_read;
+	/// Owned by the producer
+	volatile size_t m_write;
+	/// End of valid data in the tail when m_write has wrapped around
+	volatile size_t m_watermark;
+
+	size_t m_reserve_beg;
+	size_t m_reserve_size;
+};
+
+}
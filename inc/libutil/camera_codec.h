@@ -0,0 +1,218 @@
+/*
+ * camera_codec.h
+ * Lossless camera frame compression, with per-row run-length or
+ * XOR-with-previous-frame encoding. It has no hardware dependency and could be
+ * compiled on the host side as well
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <vector>
+
+#include "libbase/misc_types.h"
+
+namespace libutil
+{
+
+/**
+ * Encoded frame layout (varint = LEB128):
+ * <pre>
+ * varint sequence number
+ * varint width
+ * varint height
+ * byte flags, bit 0: 8-bit grayscale (1bpp otherwise), bit 1: key frame
+ * for each row:
+ *   byte mode, RowMode
+ *   kRaw: the row as is
+ *   kRle: the row encoded with PackBits
+ *   kXorRle: the row XOR the same row of the previous frame, encoded with
+ *   PackBits
+ * </pre>
+ * A 1bpp row is (width + 7) / 8 bytes, MSB being the leftmost pixel, while a
+ * grayscale row is width bytes. Key frames never contain kXorRle rows
+ */
+class CameraCodec
+{
+public:
+	enum struct Format
+	{
+		/// 1 bit per pixel, as produced by Ov7725
+		kBinary = 0,
+		/// 8-bit grayscale, as produced by MT9V034
+		kGray8,
+	};
+
+	enum struct RowMode
+	{
+		kRaw = 0,
+		kRle,
+		kXorRle,
+	};
+
+	class Encoder
+	{
+	public:
+		struct Config
+		{
+			uint16_t width;
+			uint16_t height;
+			Format format = Format::kBinary;
+			/**
+			 * A key frame is sent every this many frames, 0 to only send the
+			 * first one as key frame. XOR encoding is only available between
+			 * key frames
+			 */
+			uint16_t key_frame_interval = 30;
+			bool is_xor = true;
+		};
+
+		explicit Encoder(const Config &config);
+
+		/**
+		 * Encode @a frame, which must be of the size specified in Config
+		 *
+		 * @param frame
+		 * @param out_size Size of the encoded data
+		 * @return Encoded data, valid until the next call
+		 */
+		const Byte* Encode(const Byte *frame, size_t *out_size);
+
+		/**
+		 * Make the next frame a key frame, e.g., when the receiver reports a
+		 * lost frame
+		 */
+		void RequestKeyFrame()
+		{
+			m_is_key_requested = true;
+		}
+
+		uint32_t GetSeq() const
+		{
+			return m_seq;
+		}
+
+		size_t GetMaxEncodedSize() const;
+
+	private:
+		const uint16_t m_width;
+		const uint16_t m_height;
+		const Format m_format;
+		const uint16_t m_key_frame_interval;
+		const bool m_is_xor;
+		const size_t m_stride;
+
+		std::unique_ptr<Byte[]> m_out;
+		std::unique_ptr<Byte[]> m_prev;
+		std::unique_ptr<Byte[]> m_row;
+		std::unique_ptr<Byte[]> m_tmp;
+
+		uint32_t m_seq;
+		bool m_is_key_requested;
+	};
+
+	class Decoder
+	{
+	public:
+		Decoder();
+
+		/**
+		 * Decode a frame. The decoded frame is kept internally and also serves
+		 * as the reference for the next one
+		 *
+		 * @param data
+		 * @param size
+		 * @return true if successful. False if the data is malformed, or it
+		 * references a previous frame that is missing, in which case a key
+		 * frame is needed to recover
+		 */
+		bool Decode(const Byte *data, const size_t size);
+
+		const Byte* GetFrame() const
+		{
+			return m_frame.data();
+		}
+
+		uint16_t GetWidth() const
+		{
+			return m_width;
+		}
+
+		uint16_t GetHeight() const
+		{
+			return m_height;
+		}
+
+		Format GetFormat() const
+		{
+			return m_format;
+		}
+
+		uint32_t GetSeq() const
+		{
+			return m_seq;
+		}
+
+		/**
+		 * Return the # frames missing, judging from the sequence numbers. A
+		 * backward jump, or a forward one larger than kMaxSeqGap, is taken
+		 * as a restart of the stream and not counted
+		 *
+		 * @return
+		 */
+		uint32_t GetDroppedCount() const
+		{
+			return m_dropped_count;
+		}
+
+	private:
+		/// Larger gaps in the sequence numbers are not counted as drops
+		static constexpr uint32_t kMaxSeqGap = 0xFFFF;
+
+		std::vector<Byte> m_frame;
+		std::vector<Byte> m_row;
+		uint16_t m_width;
+		uint16_t m_height;
+		Format m_format;
+		uint32_t m_seq;
+		bool m_is_valid;
+		uint32_t m_dropped_count;
+	};
+
+	/**
+	 * Encode @a data with PackBits
+	 *
+	 * @param data
+	 * @param size
+	 * @param out
+	 * @param out_limit Max # bytes to write to @a out
+	 * @return # bytes written, or 0 if it doesn't fit in @a out_limit
+	 */
+	static size_t PackBits(const Byte *data, const size_t size, Byte *out,
+			const size_t out_limit);
+	/**
+	 * Decode PackBits data until @a out_size bytes are produced
+	 *
+	 * @param data
+	 * @param size
+	 * @param out
+	 * @param out_size
+	 * @return # bytes consumed from @a data, or 0 if malformed
+	 */
+	static size_t UnpackBits(const Byte *data, const size_t size, Byte *out,
+			const size_t out_size);
+
+	static size_t GetStride(const uint16_t width, const Format format)
+	{
+		return (format == Format::kBinary) ? (width + 7) / 8 : width;
+	}
+};
+
+}
@@ -0,0 +1,61 @@
+/*
+ * crc_utils.h
+ * Table driven software CRC
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libbase/misc_types.h"
+
+namespace libutil
+{
+
+/**
+ * Portable CRC implementations, processing 4 bytes per iteration with the
+ * slicing-by-4 tables (6 KB in total, placed in flash). The results are
+ * identical to those produced by libbase::k60::Crc with the corresponding
+ * configs, such that the same checksum could be verified on chips without
+ * the CRC peripheral (e.g., KL26) or on PC
+ */
+class CrcUtils
+{
+public:
+	/**
+	 * Compute the CRC-32/ISO-HDLC (as in zlib, Ethernet, etc) of @a data.
+	 * Matches libbase::k60::Crc with the default config
+	 *
+	 * @param data
+	 * @param size
+	 * @param crc Result of the previous chunk to continue from, or 0 to begin
+	 * a new one
+	 * @return
+	 */
+	static uint32_t Crc32(const Byte *data, const size_t size,
+			const uint32_t crc = 0);
+
+	/**
+	 * Compute the CRC-16/CCITT-FALSE (poly = 0x1021, init = 0xFFFF, not
+	 * reflected, no final XOR) of @a data. Matches libbase::k60::Crc with
+	 * polynomial = 0x1021, seed = 0xFFFF, is_32_bit = false,
+	 * is_reflect = false and is_xor_out = false
+	 *
+	 * @param data
+	 * @param size
+	 * @param crc Result of the previous chunk to continue from, or
+	 * kCrc16Init to begin a new one
+	 * @return
+	 */
+	static uint16_t Crc16(const Byte *data, const size_t size,
+			const uint16_t crc = kCrc16Init);
+
+	static constexpr uint16_t kCrc16Init = 0xFFFF;
+};
+
+}
@@ -0,0 +1,78 @@
+/*
+ * graph_batch_decoder.h
+ * Decoder of the batched graph messages sent by ScStudio::GraphBatcher. It
+ * has no hardware dependency and could be compiled on the host side as well
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <functional>
+
+#include "libbase/misc_types.h"
+
+namespace libutil
+{
+
+/**
+ * Payload layout (varint = LEB128, zvarint = zigzag + varint):
+ * <pre>
+ * varint base time, in ms
+ * varint # channels
+ * for each channel:
+ *   byte id
+ *   byte type, Sample::Type
+ *   varint # samples (N)
+ *   varint time of the first sample, in ms relative to the base time
+ *   varint time between the first and the last sample, in ms
+ *   kInt: zvarint first value, then N - 1 zvarint deltas to the previous one
+ *   kFloat: N big-endian IEEE 754 floats
+ * </pre>
+ * Samples of a channel are assumed to be evenly spaced within the time span
+ */
+class GraphBatchDecoder
+{
+public:
+	struct Sample
+	{
+		/// Same as the graph types used by ScStudio
+		enum struct Type
+		{
+			kInt = 0,
+			kFloat,
+		};
+
+		uint8_t id;
+		Type type;
+		/// In ms
+		uint32_t time;
+		union
+		{
+			int32_t i;
+			float f;
+		} value;
+	};
+
+	typedef std::function<void(const Sample &sample)> OnSampleListener;
+
+	/**
+	 * Decode a batched graph payload and call @a listener for every sample,
+	 * in the order of channels then samples
+	 *
+	 * @param data
+	 * @param size
+	 * @param listener
+	 * @return true if the whole payload is decoded successfully. Samples
+	 * decoded before an error are still delivered
+	 */
+	static bool Decode(const Byte *data, const size_t size,
+			const OnSampleListener &listener);
+};
+
+}
@@ -0,0 +1,130 @@
+/*
+ * gray_image.h
+ * Kernels for 8-bit grayscale images
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libbase/misc_types.h"
+
+/**
+ * If set to 1, the kernels process 4 pixels at a time with the Cortex-M4 SIMD
+ * instructions (__UQSUB8, __USADA8, __SEL, etc). Defaults to 1 when the
+ * target supports them. Setting it on other platforms builds the same code
+ * with the instructions emulated in C, so that the two paths could be
+ * compared on PC. Either way, the results are bit-identical to the plain
+ * per-pixel code used when it's 0
+ */
+#ifndef LIBUTIL_GRAY_SIMD
+	#if defined(__ARM_FEATURE_SIMD32) && __ARM_FEATURE_SIMD32
+		#define LIBUTIL_GRAY_SIMD 1
+	#else
+		#define LIBUTIL_GRAY_SIMD 0
+	#endif
+#endif
+
+namespace libutil
+{
+
+/**
+ * Image processing on 8-bit grayscale frames (e.g., those from
+ * MT9V034::LockBuffer()), w bytes per row. Rows need not be word aligned
+ *
+ * It has no hardware dependency and could be compiled on the host side as
+ * well
+ */
+class GrayImage
+{
+public:
+	/**
+	 * Count the pixels of each level
+	 *
+	 * @param data
+	 * @param size # pixels
+	 * @param out_hist 256 elements
+	 */
+	static void Histogram(const Byte *data, const size_t size,
+			uint32_t *out_hist);
+
+	/**
+	 * Return the threshold maximizing the between-class variance of
+	 * @a hist (Otsu's method), with the classes being [0, threshold] and
+	 * (threshold, 255]. The computation is done in integers, so the result is
+	 * the same on every platform
+	 *
+	 * @param hist 256 elements, as produced by Histogram()
+	 * @return
+	 */
+	static uint8_t OtsuThreshold(const uint32_t *hist);
+
+	/**
+	 * Convert to a 1bpp image in the layout of BinaryImage, a pixel is set if
+	 * it's not brighter than @a threshold, i.e., 1 is black as in Ov7725
+	 *
+	 * @param src
+	 * @param w
+	 * @param h
+	 * @param threshold
+	 * @param dst BinaryImage::GetRowBytes(w) * h bytes
+	 */
+	static void Binarize(const Byte *src, const Uint w, const Uint h,
+			const uint8_t threshold, Byte *dst);
+
+	/**
+	 * Compute the gradient magnitude with the 3x3 Sobel operator, as
+	 * min(|Gx| + |Gy|, 255). Pixels on the border are set to 0
+	 *
+	 * @param src
+	 * @param w
+	 * @param h
+	 * @param dst Must not overlap with @a src
+	 */
+	static void Sobel(const Byte *src, const Uint w, const Uint h, Byte *dst);
+
+	/**
+	 * Blur with a 3x3 box filter, each pixel becomes the rounded mean of
+	 * itself and its 8 neighbors. Pixels on the border are copied as is
+	 *
+	 * @param src
+	 * @param w
+	 * @param h
+	 * @param dst Must not overlap with @a src
+	 */
+	static void BoxBlur(const Byte *src, const Uint w, const Uint h,
+			Byte *dst);
+
+	/**
+	 * Compute the per-pixel absolute difference of two frames, e.g., to
+	 * detect motion
+	 *
+	 * @param a
+	 * @param b
+	 * @param size # pixels
+	 * @param dst |a - b| per pixel, may be nullptr if only the sum is needed,
+	 * or be the same as @a a or @a b
+	 * @return The sum of absolute differences
+	 */
+	static uint32_t AbsDiff(const Byte *a, const Byte *b, const size_t size,
+			Byte *dst);
+
+	/**
+	 * Halve the image in both dimensions, each pixel becomes the rounded mean
+	 * of a 2x2 block. The last row/column is dropped if @a h/@a w is odd
+	 *
+	 * @param src
+	 * @param w
+	 * @param h
+	 * @param dst (w / 2) * (h / 2) bytes, may be the same as @a src
+	 */
+	static void Downscale2x(const Byte *src, const Uint w, const Uint h,
+			Byte *dst);
+};
+
+}
@@ -9,15 +9,9 @@
 
 #pragma once
 
-#if MK60DZ10 || MK60D10 || MK60F15
-#include "libsc/system.h"
-
-#elif MKL26Z4
-#include "libsc/kl26/system.h"
+#include <cstdint>
 
-#endif
-
-#include "libsc/timer.h"
+#include "libsc/system.h"
 #include "libutil/pid_controller.h"
 
 namespace libutil
@@ -50,11 +44,7 @@ public:
 
 	void ResetTime()
 	{
-#if MK60DZ10 || MK60D10 || MK60F15
-		m_prev_time = libsc::System::Time();
-#elif MKL26Z4
-		m_prev_time = libsc::kl26::System::Time();
-#endif
+		m_prev_time = libsc::System::TimeUs();
 	}
 
 protected:
@@ -66,7 +56,8 @@ private:
 
 	InT m_prev_error[2];
 	OutT m_prev_output;
-	libsc::Timer::TimerInt m_prev_time;
+	/// In us
+	uint64_t m_prev_time;
 };
 
 }
@@ -9,10 +9,11 @@
 
 #pragma once
 
+#include <cstdint>
+
 #include <algorithm>
 
 #include "libsc/system.h"
-#include "libsc/timer.h"
 #include "libutil/incremental_pid_controller.h"
 #include "libutil/misc.h"
 
@@ -27,18 +28,18 @@ IncrementalPidController<InT_, OutT_>::IncrementalPidController(
 
 		  m_prev_error{0, 0},
 		  m_prev_output(0),
-		  m_prev_time(libsc::System::Time())
+		  m_prev_time(libsc::System::TimeUs())
 {}
 
 template<typename InT_, typename OutT_>
 void IncrementalPidController<InT_, OutT_>::OnCalc(const InT error)
 {
-	using namespace libsc::k60;
 	using namespace libsc;
 
-	const Timer::TimerInt time = System::Time();
-	const float time_diff = Timer::TimeDiff(System::Time(), m_prev_time)
-			/ 1000.0f;
+	const uint64_t time = System::TimeUs();
+	const float time_diff = static_cast<uint32_t>(time - m_prev_time)
+			/ 1000000.0f;
+	m_prev_time = time;
 
 	const float p = this->GetKp() * (error - m_prev_error[0]);
 	float i = this->GetKi() * (error + m_prev_error[0]) * time_diff * 0.5f;
@@ -46,8 +47,11 @@ void IncrementalPidController<InT_, OutT_>::OnCalc(const InT error)
 	{
 		i = libutil::Clamp<float>(-m_i_limit, i, m_i_limit);
 	}
-	const float d = this->GetKd() * (error - 2 * m_prev_error[0]
-			+ m_prev_error[1]) / time_diff;
+	// Keep the last D if no time has passed, which could happen with the ms
+	// resolution timer on KL26
+	const float d = (time_diff > 0.0f) ? this->GetKd() * (error
+			- 2 * m_prev_error[0] + m_prev_error[1]) / time_diff
+			: this->GetD();
 
 	std::swap(m_prev_error[0], m_prev_error[1]);
 	m_prev_error[0] = error;
@@ -9,17 +9,43 @@
 
 #pragma once
 
-#include <functional>
-#include <list>
+#include <cstddef>
+#include <cstdint>
 
 #include "libsc/timer.h"
+#include "libutil/task_scheduler.h"
+
+#if MK60D10 || MK60DZ10 || MK60F15
+namespace libsc
+{
+namespace k60
+{
+
+class UartDevice;
+
+}
+}
+
+#elif MKL26Z4
+namespace libsc
+{
+namespace kl26
+{
+
+class UartDevice;
+
+}
+}
+
+#endif
 
 namespace libutil
 {
 
 /**
  * Manage the main loop of a program, and invoke registered functions at the
- * time specified
+ * time specified. Scheduling is done by TaskScheduler in 125us ticks, each
+ * iteration only costs as much as the number of due callbacks
  *
  * Example:
  * @snippet test/src/kl26/looper_test.cpp code
@@ -27,19 +53,52 @@ namespace libutil
 class Looper
 {
 public:
-	typedef std::function<void(const libsc::Timer::TimerInt request,
-			const libsc::Timer::TimerInt actual)> Callback;
+	/**
+	 * Unlike std::function, the callable is stored in place and must fit in
+	 * LIBUTIL_TASK_CALLBACK_SIZE bytes, which is checked at compile time
+	 */
+	typedef TaskScheduler::Callback Callback;
+	typedef TaskScheduler::RepeatMode RepeatMode;
+	typedef TaskScheduler::TaskId TaskId;
+#if MK60D10 || MK60DZ10 || MK60F15
+	typedef libsc::k60::UartDevice UartDevice;
+
+#elif MKL26Z4
+	typedef libsc::kl26::UartDevice UartDevice;
+
+#endif
+
+	/**
+	 * Return the current time in 125us ticks
+	 */
+	typedef uint32_t (*Clock)();
 
-	enum struct RepeatMode
+	struct Config
 	{
-		/// Not repeating
-		kOnce = 0,
-		/// Reduce the time between two calls if the first is delayed
-		kPrecise,
-		/// Always wait for at least the specified period
-		kLoose,
+		Config()
+				: task_capacity(16),
+				  clock(nullptr),
+				  cycle_counter(nullptr)
+		{}
+
+		/// Max # callbacks registered at the same time
+		size_t task_capacity;
+		/**
+		 * Time source, leave it null to use System::TimeIn125us(), or
+		 * System::Time() on chips without the 125us timer. Provide a virtual
+		 * clock to drive the looper deterministically, e.g., in tests
+		 */
+		Clock clock;
+		/**
+		 * Counter used to measure the execution time of callbacks when
+		 * LIBUTIL_TASK_PROFILE is set. Leave it null to use the DWT cycle
+		 * counter on K60. KL26 has none, so only the counts and lateness are
+		 * recorded there by default
+		 */
+		TaskScheduler::CycleCounter cycle_counter;
 	};
 
+	explicit Looper(const Config &config);
 	Looper();
 	~Looper();
 
@@ -56,9 +115,9 @@ public:
 	 */
 	void Once();
 
-	void RunAfter(const libsc::Timer::TimerInt ms, const Callback &c)
+	TaskId RunAfter(const libsc::Timer::TimerInt ms, const Callback &c)
 	{
-		Repeat(ms, c, RepeatMode::kOnce);
+		return Repeat(ms, c, RepeatMode::kOnce);
 	}
 	/**
 	 * Repeatly call @a c per @a ms ms
@@ -66,10 +125,58 @@ public:
 	 * @param ms
 	 * @param c
 	 * @param mode
+	 * @param priority Among the callbacks due at the same time, those with a
+	 * smaller value are called first
+	 * @return ID of the callback, could be used to Cancel() it later
 	 * @see Looper::RepeatMode
 	 */
-	void Repeat(const libsc::Timer::TimerInt ms, const Callback &c,
-			const RepeatMode mode);
+	TaskId Repeat(const libsc::Timer::TimerInt ms, const Callback &c,
+			const RepeatMode mode,
+			const uint8_t priority = TaskScheduler::kDefaultPriority);
+	/**
+	 * Same as Repeat(), but with the period in 125us. @a c is also called
+	 * with the times in 125us
+	 *
+	 * @param period
+	 * @param c
+	 * @param mode
+	 * @param priority
+	 * @return
+	 * @see Repeat()
+	 */
+	TaskId RepeatIn125us(const uint32_t period, const Callback &c,
+			const RepeatMode mode,
+			const uint8_t priority = TaskScheduler::kDefaultPriority);
+	/**
+	 * Unregister a callback. Safe to be called inside callbacks
+	 *
+	 * @param id
+	 * @return true if the callback was still registered
+	 */
+	bool Cancel(const TaskId id);
+
+	/**
+	 * Send the per-callback statistics through @a uart as one binary packet.
+	 * All fields are little-endian:
+	 *
+	 * - 'L', 'P', version (1), # callbacks (n) -- all 1 byte
+	 * - run count (4), busy cycles (8), elapsed cycles (8)
+	 * - n records of: ID (4), count (4), min/max/mean cycles (4 each),
+	 *   deadline misses (4), lateness histogram (2 each *
+	 *   TaskScheduler::kLatenessBuckets), lateness being in 125us
+	 * - CRC-16/CCITT-FALSE of all the above (2), see CrcUtils::Crc16()
+	 *
+	 * Only available when LIBUTIL_TASK_PROFILE is set
+	 *
+	 * @param uart
+	 * @return true if the packet is queued successfully
+	 */
+	bool SendStats(UartDevice *uart) const;
+
+	const TaskScheduler& GetScheduler() const
+	{
+		return m_scheduler;
+	}
 
 	/**
 	 * Reset the internal time
@@ -87,12 +194,11 @@ public:
 	}
 
 private:
-	struct RunnerState;
-
-	void Invoke();
-
-	std::list<RunnerState> m_states;
-	libsc::Timer::TimerInt m_prev;
+	TaskScheduler m_scheduler;
+	Clock m_clock;
+	uint32_t m_prev;
+	/// Whether m_prev is set, the clock may not be ready on construction
+	bool m_is_timing_init;
 	bool m_is_run;
 };
 
@@ -57,6 +57,23 @@ void InitDefaultFwriteHandler(libsc::kl26::UartDevice *uart);
 
 void UninitDefaultFwriteHandler();
 
+/**
+ * Send the pending deferred log records through @a uart. Should be called
+ * regularly from the main loop when LIBBASE_DEFERRED_LOG is defined. Records
+ * that couldn't be queued by @a uart are kept for the next call, during which
+ * new ones may be dropped and counted when the ring fills up
+ *
+ * @param uart
+ * @see libbase::DeferredLog
+ */
+#if MK60DZ10 || MK60D10 || MK60F15
+void DrainDeferredLog(libsc::k60::UartDevice *uart);
+
+#elif MKL26Z4
+void DrainDeferredLog(libsc::kl26::UartDevice *uart);
+
+#endif
+
 template<typename T>
 inline T Clamp(const T &min, const T &x, const T &max)
 {
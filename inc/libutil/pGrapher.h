@@ -120,11 +120,31 @@ public:
 		{
 			ObjMng newObj(watchedObj, sizeof(*watchedObj), TypeId::getTypeId(*watchedObj), s);
 			watchedObjMng.push_back(newObj);
+			isWatchLayoutDirty = true;
 		}
 	}
 
+	/**
+	 * Send all watched variables in one frame, which is simply the raw bytes of
+	 * each variable concatenated in the order they are added. In changed-only
+	 * mode, the frame becomes:
+	 * '*', bitmask of changed variables ((n + 7) / 8 bytes, LSB of the first
+	 * byte being the first variable), raw bytes of each changed variable
+	 * Nothing would be sent if none has changed
+	 *
+	 * Full frames carry no header to stay compatible with the existing PC
+	 * side, so one starting with '*' (0x2A) looks the same as a changed-only
+	 * frame. The receiver must thus know which mode is in use rather than
+	 * guess from the first byte
+	 */
 	void sendWatchData(void);
 
+	/**
+	 * Only send the watched variables that changed since the last frame. See
+	 * sendWatchData() for the frame format
+	 */
+	void setSendChangedOnly(const bool flag);
+
 	bool							isStarted;
 	const Byte						rx_threshold;
 
@@ -140,12 +160,24 @@ private:
 
 	std::vector<Byte>				rx_buffer;
 
+	// Precomputed layout of the watch data frame
+	bool							isWatchLayoutDirty;
+	bool							isSendChangedOnly;
+	bool							isLastWatchDataValid;
+	size_t							watchDataSize;
+	std::vector<size_t>				watchOffsets;
+	std::vector<Byte>				watchFrame;
+	std::vector<Byte>				lastWatchData;
+
 	static bool listener(const Byte *data, const size_t size);
 
 	SysTick::Config getTimerConfig(void);
 	JyMcuBt106::Config get106UartConfig(const uint8_t id);
 	FtdiFt232r::Config get232UartConfig(const uint8_t id);
 
+	void prepareWatchLayout(void);
+	void sendChangedWatchData(void);
+
 	void sendWatchedVarInfo(void);
 	void sendSharedVarInfo(void);
 
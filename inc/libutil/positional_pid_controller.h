@@ -9,15 +9,9 @@
 
 #pragma once
 
-#if MK60DZ10 || MK60D10 || MK60F15
-#include "libsc/system.h"
+#include <cstdint>
 
-#elif MKL26Z4
 #include "libsc/system.h"
-
-#endif
-
-#include "libsc/timer.h"
 #include "libutil/pid_controller.h"
 
 namespace libutil
@@ -51,11 +45,7 @@ public:
 
 	void ResetTime()
 	{
-#if MK60DZ10 || MK60D10 || MK60F15
-		m_prev_time = libsc::System::Time();
-#elif MKL26Z4
-		m_prev_time = libsc::System::Time();
-#endif
+		m_prev_time = libsc::System::TimeUs();
 	}
 
 protected:
@@ -67,7 +57,8 @@ private:
 
 	float m_accumulated_error;
 	InT m_prev_error;
-	libsc::Timer::TimerInt m_prev_time;
+	/// In us
+	uint64_t m_prev_time;
 };
 
 }
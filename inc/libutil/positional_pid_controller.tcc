@@ -9,15 +9,9 @@
 
 #pragma once
 
-#if MK60DZ10 || MK60D10 || MK60F15
-#include "libsc/system.h"
+#include <cstdint>
 
-#elif MKL26Z4
 #include "libsc/system.h"
-
-#endif
-
-#include "libsc/timer.h"
 #include "libutil/misc.h"
 #include "libutil/positional_pid_controller.h"
 
@@ -32,7 +26,7 @@ PositionalPidController<InT_, OutT_>::PositionalPidController(const InT setpoint
 
 		  m_accumulated_error(0.0f),
 		  m_prev_error(0),
-		  m_prev_time(libsc::System::Time())
+		  m_prev_time(libsc::System::TimeUs())
 
 {}
 
@@ -46,9 +40,9 @@ void PositionalPidController<InT_, OutT_>::OnCalc(const InT error)
 	using namespace libsc::kl26;
 #endif
 
-	const Timer::TimerInt time = System::Time();
-	const float time_diff = Timer::TimeDiff(System::Time(), m_prev_time)
-			/ 1000.0f;
+	const uint64_t time = System::TimeUs();
+	const float time_diff = static_cast<uint32_t>(time - m_prev_time)
+			/ 1000000.0f;
 
 	const float p = this->GetKp() * error;
 	m_accumulated_error += error * time_diff;
@@ -57,8 +51,10 @@ void PositionalPidController<InT_, OutT_>::OnCalc(const InT error)
 	{
 		i = Clamp<float>(-m_i_limit, i, m_i_limit);
 	}
-	const float slope = (error - m_prev_error) / time_diff;
-	const float d = this->GetKd() * slope;
+	// Keep the last D if no time has passed, which could happen with the ms
+	// resolution timer on KL26
+	const float d = (time_diff > 0.0f) ? this->GetKd() * (error
+			- m_prev_error) / time_diff : this->GetD();
 
 	m_prev_error = error;
 	m_prev_time = time;
@@ -8,7 +8,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -70,24 +72,31 @@ public:
 			return m_id;
 		}
 
+		/**
+		 * Return the value in the committed table, remote updates will only
+		 * be visible after RemoteVarManager::Commit()
+		 *
+		 * @return
+		 */
 		uint32_t GetInt() const
 		{
-			return m_val;
+			return m_manager->m_live[m_id];
 		}
 
 		float GetReal() const
 		{
-			return *reinterpret_cast<const volatile float*>(&m_val);
+			const uint32_t val = GetInt();
+			return *reinterpret_cast<const float*>(&val);
 		}
 
 		void SetInt(const uint32_t val)
 		{
-			m_val = val;
+			m_manager->SetVal(m_id, val);
 		}
 
 		void SetReal(const float val)
 		{
-			m_val = *reinterpret_cast<const uint32_t*>(&val);
+			SetInt(*reinterpret_cast<const uint32_t*>(&val));
 		}
 
 	private:
@@ -96,7 +105,7 @@ public:
 		std::string m_name;
 		Type m_type;
 		uint8_t m_id;
-		volatile uint32_t m_val;
+		RemoteVarManager *m_manager;
 
 		friend class RemoteVarManager;
 	};
@@ -108,26 +117,163 @@ public:
 	Var* Register(std::string &&name, const Var::Type type);
 
 	/**
-	 * Broadcast the currectly registered variables
+	 * Broadcast the currectly registered variables, one text line per
+	 * variable, with the value as returned by Var::GetInt() or
+	 * Var::GetReal()
 	 *
 	 * @param uart
 	 */
 	void Broadcast(UartDevice *uart);
 
+	/**
+	 * Broadcast the descriptors of all registered variables in one binary
+	 * frame. Frames are in the form of:<br>
+	 * kFrameBegin, FrameToken, varint payload size, payload, kFrameEnd
+	 *
+	 * The payload of a descriptor table is:<br>
+	 * varint # variables, then for each variable:<br>
+	 * byte id, byte type, varint name length, name
+	 *
+	 * @param uart
+	 */
+	void BroadcastTable(UartDevice *uart);
+	/**
+	 * Broadcast the current values of all registered variables in one binary
+	 * frame, cheap enough to be called at loop rate. If the Tx ring of
+	 * @a uart is enabled, the frame is built in place there and nothing is
+	 * allocated, otherwise it costs one allocation that is handed over to
+	 * the Tx queue. The payload is:<br>
+	 * varint # variables, then the big-endian 32-bit value of each variable,
+	 * in the order of their ids
+	 *
+	 * @param uart
+	 * @see BroadcastTable()
+	 */
+	void BroadcastValues(UartDevice *uart);
+
 	/**
 	 * Process new data. You should set this method as the Rx ISR while
-	 * initializing the UartDevice, or call it manually
+	 * initializing the UartDevice, or call it manually. Every 5 bytes (1 byte
+	 * id + 4 bytes big-endian value) are taken as an update, which is applied
+	 * immediately
 	 *
 	 * @param data
 	 * @return true
+	 * @see OnUartReceiveFrame() for a more robust alternative
 	 */
 	bool OnUartReceiveChar(const Byte *data, const size_t size);
 	bool OnUartReceiveSingleChar(const Byte data);
 
+	/**
+	 * Process new data in framed form, to be used instead of
+	 * OnUartReceiveChar(). A frame is in the form of:<br>
+	 * kFrameBegin, FrameToken::kUpdate, varint payload size, payload,
+	 * big-endian CRC-16/CCITT-FALSE of the token and payload, kFrameEnd
+	 *
+	 * The payload is a list of updates, each being 1 byte id + 4 bytes
+	 * big-endian value. Updates of a valid frame are staged all together and
+	 * become visible on the next Commit(). Invalid frames are discarded and the
+	 * receiver resyncs on the next kFrameBegin
+	 *
+	 * @param data
+	 * @param size
+	 * @return true
+	 */
+	bool OnUartReceiveFrame(const Byte *data, const size_t size);
+
+	/**
+	 * Make all the staged remote updates visible at once. Should be called
+	 * from the main loop at a point where it's safe for the values to change,
+	 * e.g., at the beginning of a control cycle
+	 *
+	 * @return true if there were updates committed
+	 */
+	bool Commit();
+
+	enum struct FrameToken
+	{
+		kTable = 0,
+		kValues,
+		kUpdate,
+	};
+
+	static constexpr Byte kFrameBegin = 0xB5;
+	static constexpr Byte kFrameEnd = 0x5B;
+
 private:
+	enum struct RxState
+	{
+		kBegin,
+		kToken,
+		kSize,
+		kPayload,
+		kCrc,
+		kEnd,
+	};
+
+	void SetVal(const uint8_t id, const uint32_t val);
+	void OnRxFrameByte(const Byte data);
+	/**
+	 * Apply the updates in m_rx_frame to the staging table
+	 */
+	void StageRxFrame();
+	void ResetRx();
+
+	/**
+	 * Write the frame header to @a out, which must have room for at least
+	 * 2 + VarintUtils::kMaxSize bytes
+	 *
+	 * @param token
+	 * @param payload_size
+	 * @param out
+	 * @return # bytes written
+	 */
+	static size_t PutFrameHeader(const FrameToken token,
+			const size_t payload_size, Byte *out);
+	static size_t GetFrameSize(const size_t payload_size);
+	/**
+	 * Return where a frame of @a size bytes should be written, in place in
+	 * the Tx ring of @a uart if it's enabled, or in a new buffer stored in
+	 * @a out_owned otherwise
+	 *
+	 * @param uart
+	 * @param size
+	 * @param out_owned
+	 * @return nullptr if there's no space left in the Tx ring
+	 */
+	static Byte* BeginFrame(UartDevice *uart, const size_t size,
+			std::unique_ptr<Byte[]> *out_owned);
+	/**
+	 * Send the frame started with BeginFrame()
+	 *
+	 * @param uart
+	 * @param owned The buffer returned through BeginFrame()
+	 * @param size
+	 */
+	static void EndFrame(UartDevice *uart, std::unique_ptr<Byte[]> &&owned,
+			const size_t size);
+
 	std::vector<Var> m_vars;
 	Byte m_buffer[5];
 	int m_buffer_it;
+
+	std::unique_ptr<uint32_t[]> m_tables;
+	/// The committed values
+	volatile uint32_t *volatile m_live;
+	/// Remote updates pending commit
+	volatile uint32_t *m_staging;
+	volatile bool m_is_staged;
+	/// Whether m_staging is a copy of m_live (plus staged updates)
+	bool m_is_staging_synced;
+
+	RxState m_rx_state;
+	std::unique_ptr<Byte[]> m_rx_frame;
+	size_t m_rx_frame_capacity;
+	uint32_t m_rx_size;
+	uint8_t m_rx_size_it;
+	size_t m_rx_it;
+	uint16_t m_rx_crc;
+	uint16_t m_rx_expected_crc;
 };
 
 }
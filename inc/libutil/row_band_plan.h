@@ -0,0 +1,145 @@
+/*
+ * row_band_plan.h
+ * Split a camera frame into kept and discarded bands of rows
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include "libbase/misc_types.h"
+
+namespace libutil
+{
+
+/**
+ * Plan which rows of a frame are captured. The rows before the first and
+ * after the last kept row are expected to be cut off by the sensor's window,
+ * the remaining ones are described as a sequence of bands, each either
+ * written to the buffer or discarded, such that a DMA scatter/gather chain
+ * could be built from them directly (one TCD per band)
+ *
+ * The plan knows nothing about the hardware, it's only the bookkeeping
+ */
+class RowBandPlan
+{
+public:
+	struct Range
+	{
+		uint16_t start;
+		uint16_t count;
+	};
+
+	struct Band
+	{
+		/// # bytes in this band, never larger than kMaxBandSize
+		uint16_t size;
+		/// Whether the band is written to the buffer
+		bool is_keep;
+		/// Offset of the band in the buffer, only valid if is_keep is true
+		uint32_t dst_offset;
+	};
+
+	/// Max major iteration count of a DMA TCD, without channel linking
+	static constexpr uint16_t kMaxBandSize = 0x7FFF;
+
+	RowBandPlan();
+
+	/**
+	 * Build the plan. Rows are kept if they fall inside any of @a ranges,
+	 * and, in that range, are a multiple of @a stride away from its start.
+	 * Ranges may overlap or be unsorted, rows beyond the frame are ignored
+	 *
+	 * @param w # bytes per row
+	 * @param h # rows of the full frame
+	 * @param ranges Rows to keep, or nullptr to keep the whole frame
+	 * @param range_count
+	 * @param stride 1 to keep every row in the ranges, 2 for every other
+	 * row, etc
+	 * @return false if no row would be kept, in which case the plan keeps the
+	 * whole frame
+	 */
+	bool Build(const Uint w, const Uint h, const Range *ranges,
+			const size_t range_count, const Uint stride = 1);
+
+	/**
+	 * Return the first row of the full frame that needs to be read out, i.e.,
+	 * the first kept row
+	 *
+	 * @return
+	 */
+	Uint GetWindowStart() const
+	{
+		return m_rows.empty() ? 0 : m_rows.front();
+	}
+
+	/**
+	 * Return the # rows from the first to the last kept row, inclusive
+	 *
+	 * @return
+	 */
+	Uint GetWindowSize() const
+	{
+		return m_rows.empty() ? 0 : m_rows.back() - m_rows.front() + 1;
+	}
+
+	/**
+	 * Return the # kept rows, i.e., the height of the captured image
+	 *
+	 * @return
+	 */
+	Uint GetRowCount() const
+	{
+		return m_rows.size();
+	}
+
+	/**
+	 * Return the row in the full frame where @a row of the captured image
+	 * comes from
+	 *
+	 * @param row
+	 * @return
+	 */
+	Uint GetSourceRow(const Uint row) const
+	{
+		return m_rows[row];
+	}
+
+	size_t GetBufferSize() const
+	{
+		return m_w * m_rows.size();
+	}
+
+	/**
+	 * Return the bands, in the order they are read out, covering exactly
+	 * GetWindowSize() rows
+	 *
+	 * @return
+	 */
+	const std::vector<Band>& GetBands() const
+	{
+		return m_bands;
+	}
+
+private:
+	/**
+	 * @param size
+	 * @param is_keep
+	 * @param io_dst_offset Offset of the band in the buffer, advanced past it
+	 * on return if @a is_keep is true
+	 */
+	void AppendBand(size_t size, const bool is_keep, uint32_t *io_dst_offset);
+
+	Uint m_w;
+	std::vector<uint16_t> m_rows;
+	std::vector<Band> m_bands;
+};
+
+}
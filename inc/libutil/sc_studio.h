@@ -21,8 +21,10 @@
 #include "libbase/misc_types.h"
 #include LIBBASE_H(uart)
 
+#include "libsc/timer.h"
 #include "libsc/tsl1401cl.h"
 #include LIBSC_H(uart_device)
+#include "libutil/camera_codec.h"
 
 namespace libutil
 {
@@ -54,6 +56,81 @@ public:
 		Byte *m_it;
 	};
 
+	/**
+	 * Accumulate graph samples per channel and send them together as one
+	 * kGraphBatch message, either when the time window elapses or when a
+	 * channel's buffer is full. Int samples are delta encoded. The payload
+	 * could be decoded with GraphBatchDecoder
+	 *
+	 * No allocation is made after construction
+	 */
+	class GraphBatcher
+	{
+	public:
+		struct Config
+		{
+			/// Max # distinct channels
+			uint8_t channel_count = 8;
+			/// Size of the sample buffer of each channel, in bytes
+			uint16_t channel_buf_size = 64;
+			/// Max time to hold a sample before it's sent
+			libsc::Timer::TimerInt window_ms = 20;
+		};
+
+		GraphBatcher(ScStudio *studio, const Config &config);
+
+		/**
+		 * Add a sample to channel @a id, timestamped with System::Time()
+		 *
+		 * @param id
+		 * @param value
+		 * @return true if added, false if there's no free channel for @a id
+		 */
+		bool Add(const uint8_t id, const int32_t value);
+		bool AddF(const uint8_t id, const float value);
+
+		/**
+		 * Send the message if the time window has elapsed. Should be called
+		 * periodically when samples don't come in regularly
+		 */
+		void Update();
+		/**
+		 * Send all the accumulated samples immediately
+		 */
+		void Flush();
+
+	private:
+		struct Channel
+		{
+			uint8_t id;
+			uint8_t type;
+			uint16_t count;
+			/// Relative to the base time
+			libsc::Timer::TimerInt first_time;
+			libsc::Timer::TimerInt last_time;
+			uint32_t last_value;
+			Byte *buf;
+			uint16_t buf_size;
+		};
+
+		Channel* GetChannel(const uint8_t id, const uint8_t type,
+				const size_t sample_size);
+		void AddSample(Channel *channel, const Byte *data, const size_t size);
+
+		ScStudio *m_studio;
+		libsc::Timer::TimerInt m_window_ms;
+		uint8_t m_channel_capacity;
+		uint16_t m_channel_buf_size;
+
+		std::unique_ptr<Channel[]> m_channels;
+		uint8_t m_channel_size;
+		std::unique_ptr<Byte[]> m_data;
+		std::unique_ptr<Byte[]> m_payload;
+
+		bool m_is_window_open;
+		libsc::Timer::TimerInt m_base_time;
+	};
+
 	enum struct MessageToken
 	{
 		kNull = -1,
@@ -62,10 +139,19 @@ public:
 		kCcdData,
 		kCamera,
 		kGraph,
+		kGraphBatch,
+		kCameraFrame,
 
 		kSize
 	};
 
+	/**
+	 * Called when a complete message is received. @a data points to the Rx
+	 * buffer (or the UART buffer directly) and is only valid within the call
+	 */
+	typedef std::function<void(const Byte *data, const size_t size)>
+			OnMessageListener;
+
 	ScStudio();
 
 	void SetUart(LIBSC_MODULE(UartDevice) *uart)
@@ -92,11 +178,60 @@ public:
 	void SendCcdData(const uint8_t id,
 			const std::array<uint16_t, libsc::Tsl1401cl::kSensorW> &data);
 	void SendCamera(const Byte *data, const size_t size);
+	/**
+	 * Compress @a frame with @a encoder and send it as a kCameraFrame message.
+	 * Unlike SendCamera(), frames of any size and format supported by
+	 * CameraCodec are accepted
+	 *
+	 * @param encoder
+	 * @param frame
+	 * @see CameraCodec
+	 */
+	void SendCameraFrame(CameraCodec::Encoder *encoder, const Byte *frame);
 	void SendGraph(const uint8_t id, const int32_t value);
 	void SendGraphF(const uint8_t id, const float value);
 	void SendGraph(const GraphPack &pack);
 
+	/**
+	 * Set the listener for messages of @a token
+	 *
+	 * @param token
+	 * @param listener
+	 */
+	void SetMessageListener(const MessageToken token,
+			const OnMessageListener &listener);
+	/**
+	 * Use @a buf to hold incoming payloads, replacing the internal 255-byte
+	 * one. Messages larger than the buffer are discarded. @a buf must stay
+	 * valid as long as the UART listener is active
+	 *
+	 * @param buf
+	 * @param size
+	 */
+	void SetRxBuffer(Byte *buf, const size_t size);
+	/**
+	 * Use @a buf to build outgoing frames, replacing the internal 256-byte
+	 * one. Without a Tx ring, frames are built in this pool and sent without
+	 * copying, and the pool is only reused once UartDevice::IsTxIdle(). A
+	 * message is dropped if the pool is full, while one larger than the whole
+	 * pool is sent from a freshly allocated buffer instead. @a buf must stay
+	 * valid as long as this ScStudio is in use
+	 *
+	 * @param buf
+	 * @param size
+	 */
+	void SetTxPool(Byte *buf, const size_t size);
+
 private:
+	enum struct RxState
+	{
+		kBegin,
+		kToken,
+		kSize,
+		kData,
+		kEnd,
+	};
+
 	bool OnRx(const Byte *data, const size_t size);
 	bool OnRx1(const Byte data)
 	{
@@ -106,16 +241,40 @@ private:
 	void OnNewMessage();
 
 	void SendRaw(const MessageToken token, const uint32_t size, const Byte *data);
+	/**
+	 * Write a complete frame of @a token and @a data to @a frame, which must
+	 * be at least GetFrameSize(size) bytes
+	 *
+	 * @param token
+	 * @param size
+	 * @param data
+	 * @param frame
+	 */
+	static void FillFrame(const MessageToken token, const uint32_t size,
+			const Byte *data, Byte *frame);
+	static size_t GetFrameSize(const uint32_t size);
 	void Reset();
 
 	static constexpr Byte kBegin = 0xDC;
 	static constexpr Byte kEnd = 0xCD;
 
-	bool m_is_start;
+	RxState m_rx_state;
 	MessageToken m_token;
-	int m_size;
+	uint32_t m_size;
+	uint8_t m_size_it;
 	Byte m_buf[255];
-	uint8_t m_buf_it;
+	Byte *m_rx_buf;
+	size_t m_rx_buf_capacity;
+	size_t m_rx_buf_it;
+	/// Set when the payload is passed to listeners directly from the UART
+	const Byte *m_rx_data;
+	Byte m_tx_buf[256];
+	Byte *m_tx_pool;
+	size_t m_tx_pool_capacity;
+	/// # bytes of m_tx_pool taken by frames that may still be queued
+	size_t m_tx_pool_it;
+	std::array<OnMessageListener, static_cast<size_t>(MessageToken::kSize)>
+			m_listeners;
 
 	LIBSC_MODULE(UartDevice) *m_uart;
 };
@@ -0,0 +1,177 @@
+/*
+ * spsc_ring_buffer.h
+ * Lock-free single producer single consumer ring buffer
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <type_traits>
+
+namespace libutil
+{
+
+/**
+ * A fixed capacity FIFO safe to be shared by exactly one producer and one
+ * consumer running in different contexts (e.g., an ISR and the main loop, or
+ * two threads on PC) without disabling interrupts. Unlike FixedCircularBuffer,
+ * the storage is embedded in the object, elements are constructed in place on
+ * push and destroyed on pop, so T needs not be default constructible
+ *
+ * The indices are free running counters published with release/acquire
+ * ordering, the producer only writes m_write and the consumer only writes
+ * m_read
+ *
+ * @tparam T
+ * @tparam kCapacity Must be a power of 2
+ */
+template<typename T, size_t kCapacity>
+class SpscRingBuffer
+{
+	static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0,
+			"kCapacity must be a power of 2");
+	static_assert(kCapacity <= (1u << 31), "kCapacity too large");
+
+public:
+	SpscRingBuffer();
+	~SpscRingBuffer();
+
+	SpscRingBuffer(const SpscRingBuffer&) = delete;
+	SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+	// Producer side
+
+	bool Push(const T &data)
+	{
+		return Emplace(data);
+	}
+
+	bool Push(T &&data)
+	{
+		return Emplace(std::move(data));
+	}
+
+	/**
+	 * Construct an element in place at the back
+	 *
+	 * @param args Arguments forwarded to T's constructor
+	 * @return false if the buffer is full
+	 */
+	template<typename... Args>
+	bool Emplace(Args&&... args);
+
+	/**
+	 * Copy as many elements from @a data as the buffer could hold, and publish
+	 * them all at once
+	 *
+	 * @param data
+	 * @param size
+	 * @return # elements pushed
+	 */
+	size_t PushN(const T *data, const size_t size);
+
+	// Consumer side
+
+	/**
+	 * Return the front element, which stays valid until it's popped
+	 *
+	 * @return The element, or nullptr if the buffer is empty
+	 */
+	T* Front();
+	/**
+	 * Destroy the front element
+	 *
+	 * @return false if the buffer is empty
+	 */
+	bool Pop();
+	/**
+	 * Move the front element to @a out_data then destroy it
+	 *
+	 * @param out_data
+	 * @return false if the buffer is empty
+	 */
+	bool Pop(T *out_data);
+	/**
+	 * Move up to @a size elements to @a out_data
+	 *
+	 * @param out_data
+	 * @param size
+	 * @return # elements popped
+	 */
+	size_t PopN(T *out_data, const size_t size);
+
+	/**
+	 * Return the next contiguous span of elements ready to be read in place.
+	 * A span never crosses the end of the storage, so two calls may be needed
+	 * to see all the elements
+	 *
+	 * @param out_size # elements in the span, 0 if the buffer is empty
+	 * @return Pointer to the first element of the span
+	 */
+	T* GetReadable(size_t *out_size);
+	/**
+	 * Destroy the first @a size elements, which must not be more than the
+	 * elements available
+	 *
+	 * @param size
+	 */
+	void Consume(const size_t size);
+
+	// Either side
+
+	/**
+	 * Return the # elements in the buffer. The value is only a snapshot if
+	 * called while the other party is active
+	 *
+	 * @return
+	 */
+	size_t GetSize() const
+	{
+		// Read m_read first such that the result never underflows
+		const uint32_t read = m_read.load(std::memory_order_acquire);
+		return m_write.load(std::memory_order_acquire) - read;
+	}
+
+	bool IsEmpty() const
+	{
+		return (GetSize() == 0);
+	}
+
+	bool IsFull() const
+	{
+		return (GetSize() == kCapacity);
+	}
+
+	static constexpr size_t GetCapacity()
+	{
+		return kCapacity;
+	}
+
+private:
+	typedef typename std::aligned_storage<sizeof(T),
+			std::alignment_of<T>::value>::type Storage;
+
+	static constexpr uint32_t kMask = kCapacity - 1;
+
+	T* At(const uint32_t index)
+	{
+		return reinterpret_cast<T*>(&m_data[index & kMask]);
+	}
+
+	Storage m_data[kCapacity];
+	/// Owned by the consumer
+	std::atomic<uint32_t> m_read;
+	/// Owned by the producer
+	std::atomic<uint32_t> m_write;
+};
+
+}
+
+#include "spsc_ring_buffer.tcc"
@@ -0,0 +1,143 @@
+/*
+ * spsc_ring_buffer.tcc
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "libutil/spsc_ring_buffer.h"
+
+namespace libutil
+{
+
+template<typename T, size_t kCapacity>
+SpscRingBuffer<T, kCapacity>::SpscRingBuffer()
+		: m_read(0),
+		  m_write(0)
+{}
+
+template<typename T, size_t kCapacity>
+SpscRingBuffer<T, kCapacity>::~SpscRingBuffer()
+{
+	Consume(GetSize());
+}
+
+template<typename T, size_t kCapacity>
+template<typename... Args>
+bool SpscRingBuffer<T, kCapacity>::Emplace(Args&&... args)
+{
+	const uint32_t write = m_write.load(std::memory_order_relaxed);
+	if (write - m_read.load(std::memory_order_acquire) == kCapacity)
+	{
+		return false;
+	}
+	new (At(write)) T(std::forward<Args>(args)...);
+	// Make the element visible before the index
+	m_write.store(write + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T, size_t kCapacity>
+size_t SpscRingBuffer<T, kCapacity>::PushN(const T *data, const size_t size)
+{
+	const uint32_t write = m_write.load(std::memory_order_relaxed);
+	const size_t count = std::min<size_t>(size,
+			kCapacity - (write - m_read.load(std::memory_order_acquire)));
+	for (size_t i = 0; i < count; ++i)
+	{
+		new (At(write + i)) T(data[i]);
+	}
+	m_write.store(write + count, std::memory_order_release);
+	return count;
+}
+
+template<typename T, size_t kCapacity>
+T* SpscRingBuffer<T, kCapacity>::Front()
+{
+	const uint32_t read = m_read.load(std::memory_order_relaxed);
+	if (read == m_write.load(std::memory_order_acquire))
+	{
+		return nullptr;
+	}
+	return At(read);
+}
+
+template<typename T, size_t kCapacity>
+bool SpscRingBuffer<T, kCapacity>::Pop()
+{
+	const uint32_t read = m_read.load(std::memory_order_relaxed);
+	if (read == m_write.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+	At(read)->~T();
+	// Finish with the slot before handing it back to the producer
+	m_read.store(read + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T, size_t kCapacity>
+bool SpscRingBuffer<T, kCapacity>::Pop(T *out_data)
+{
+	const uint32_t read = m_read.load(std::memory_order_relaxed);
+	if (read == m_write.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+	T *const element = At(read);
+	*out_data = std::move(*element);
+	element->~T();
+	m_read.store(read + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T, size_t kCapacity>
+size_t SpscRingBuffer<T, kCapacity>::PopN(T *out_data, const size_t size)
+{
+	const uint32_t read = m_read.load(std::memory_order_relaxed);
+	const size_t count = std::min<size_t>(size,
+			m_write.load(std::memory_order_acquire) - read);
+	for (size_t i = 0; i < count; ++i)
+	{
+		T *const element = At(read + i);
+		out_data[i] = std::move(*element);
+		element->~T();
+	}
+	m_read.store(read + count, std::memory_order_release);
+	return count;
+}
+
+template<typename T, size_t kCapacity>
+T* SpscRingBuffer<T, kCapacity>::GetReadable(size_t *out_size)
+{
+	const uint32_t read = m_read.load(std::memory_order_relaxed);
+	const size_t available = m_write.load(std::memory_order_acquire) - read;
+	*out_size = std::min<size_t>(available, kCapacity - (read & kMask));
+	return At(read);
+}
+
+template<typename T, size_t kCapacity>
+void SpscRingBuffer<T, kCapacity>::Consume(const size_t size)
+{
+	const uint32_t read = m_read.load(std::memory_order_relaxed);
+	assert(size <= m_write.load(std::memory_order_acquire) - read);
+	for (size_t i = 0; i < size; ++i)
+	{
+		At(read + i)->~T();
+	}
+	m_read.store(read + size, std::memory_order_release);
+}
+
+}
@@ -18,6 +18,12 @@
 namespace libutil
 {
 
+/**
+ * printf style formatting into a std::string. Prefer StringBuilder in
+ * performance critical code or ISRs, which doesn't allocate
+ *
+ * @see StringBuilder
+ */
 class String
 {
 public:
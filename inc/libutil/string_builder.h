@@ -0,0 +1,225 @@
+/*
+ * string_builder.h
+ * Allocation free text formatting
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+
+namespace libutil
+{
+
+/**
+ * Format text into a caller provided buffer (a stack array, a UART Tx
+ * reservation, etc). Unlike String::Format(), nothing is allocated and no
+ * static storage is involved, so it is safe to use in ISRs and reentrant
+ * code. Integers and fixed precision floats are converted without going
+ * through newlib's vsnprintf
+ *
+ * Output that doesn't fit is truncated but the required size is still being
+ * counted, see IsTruncated() and GetRequiredSize(). The content is always NUL
+ * terminated as long as the capacity is not 0
+ */
+class StringBuilder
+{
+public:
+	/**
+	 * Formatting options of a single conversion, as in printf's
+	 * %[flags][width][.precision]conv
+	 */
+	struct Spec
+	{
+		Spec()
+				: conv(0),
+				  width(0),
+				  precision(-1),
+				  is_zero_pad(false),
+				  is_left_align(false),
+				  is_plus(false)
+		{}
+
+		/// One of d, i, u, x, X, o, f, F, s, c, p, or 0 for the default one
+		char conv;
+		uint8_t width;
+		/// -1 for the default one, i.e., 6 for floats and unlimited for strings
+		int8_t precision;
+		bool is_zero_pad;
+		bool is_left_align;
+		/// Always show the sign for signed numbers
+		bool is_plus;
+	};
+
+	/**
+	 * Construct a builder writing to @a buf
+	 *
+	 * @param buf
+	 * @param capacity Size of @a buf, including the NUL terminator
+	 */
+	StringBuilder(char *buf, const size_t capacity);
+	template<size_t N>
+	explicit StringBuilder(char (&buf)[N])
+			: StringBuilder(buf, N)
+	{}
+
+	StringBuilder& Append(const char c);
+	StringBuilder& Append(const char *str);
+	StringBuilder& Append(const char *str, const size_t size);
+	StringBuilder& Append(const std::string &str)
+	{
+		return Append(str.data(), str.size());
+	}
+
+	StringBuilder& AppendInt(const int32_t value, const Spec &spec = Spec());
+	StringBuilder& AppendInt(const int64_t value, const Spec &spec = Spec());
+	/**
+	 * Append an unsigned integer, in decimal, or in hex/octal if @a spec.conv
+	 * is x, X or o
+	 *
+	 * @param value
+	 * @param spec
+	 */
+	StringBuilder& AppendUint(const uint32_t value, const Spec &spec = Spec());
+	StringBuilder& AppendUint(const uint64_t value, const Spec &spec = Spec());
+	/**
+	 * Append a float in fixed point notation, with @a spec.precision digits
+	 * after the decimal point (max 9). Values with a magnitude >= 2^32 are not
+	 * handled by the fast path and are delegated to snprintf
+	 *
+	 * @param value
+	 * @param spec
+	 */
+	StringBuilder& AppendFloat(const double value, const Spec &spec = Spec());
+	StringBuilder& AppendStr(const char *str, const Spec &spec);
+	StringBuilder& AppendPtr(const void *ptr, const Spec &spec = Spec());
+
+	/**
+	 * Append formatted text. The syntax is a subset of printf, i.e.,
+	 * %[-+0][width][.precision][length]conv, where length modifiers (h, l, z,
+	 * etc) are accepted but ignored. Unlike printf, arguments are formatted
+	 * according to their actual types, with conv only selecting the
+	 * representation (hex, char, etc) -- passing a float to %d is fine. As in
+	 * printf though, an unsigned int passed to %d is printed as signed. Excess
+	 * conversions are dropped, so do excess arguments
+	 *
+	 * @param format
+	 * @param args
+	 */
+	template<typename... Args>
+	StringBuilder& Format(const char *format, const Args&... args);
+
+	/**
+	 * Format into @a buf in one go
+	 *
+	 * @param buf
+	 * @param capacity Size of @a buf, including the NUL terminator
+	 * @param format
+	 * @param args
+	 * @return # chars required to hold the complete output, excluding the NUL
+	 * terminator, like snprintf
+	 * @see Format()
+	 */
+	template<typename... Args>
+	static size_t FormatTo(char *buf, const size_t capacity,
+			const char *format, const Args&... args);
+
+	/**
+	 * Format and send the text through @a uart. The text is written directly
+	 * into a Tx reservation if the Tx ring is enabled and has @a max_size bytes
+	 * available. Otherwise it's formatted on stack (or on the heap if larger
+	 * than kStackSize) and sent with the copying UartDevice::SendBuffer(), so
+	 * the output is never truncated. The ring is only used by UartDevice
+	 * implementations that support ReserveTx()
+	 *
+	 * @param uart A UartDevice
+	 * @param max_size Expected max size of the text, the size to reserve
+	 * @param format
+	 * @param args
+	 * @return true if the text is queued successfully
+	 * @see Format()
+	 */
+	template<typename UartDeviceT, typename... Args>
+	static bool SendFormat(UartDeviceT *uart, const size_t max_size,
+			const char *format, const Args&... args);
+
+	void Clear();
+
+	const char* GetData() const
+	{
+		return m_buf;
+	}
+
+	/**
+	 * Return the # chars actually written, excluding the NUL terminator
+	 *
+	 * @return
+	 */
+	size_t GetSize() const
+	{
+		return (m_required < m_capacity) ? m_required
+				: (m_capacity ? m_capacity - 1 : 0);
+	}
+
+	/**
+	 * Return the # chars that would have been written if the buffer was large
+	 * enough, excluding the NUL terminator
+	 *
+	 * @return
+	 */
+	size_t GetRequiredSize() const
+	{
+		return m_required;
+	}
+
+	bool IsTruncated() const
+	{
+		return (m_required != GetSize());
+	}
+
+	/// Size of the on stack buffer used by SendFormat()
+	static constexpr size_t kStackSize = 64;
+
+private:
+	/**
+	 * Parse the literal text and the next conversion spec in @a format. The
+	 * literal part is appended immediately
+	 *
+	 * @param format
+	 * @param out_spec
+	 * @return Pointer to the char after the conversion spec, or nullptr if the
+	 * end of string is reached without seeing any
+	 */
+	const char* ParseNext(const char *format, Spec *out_spec);
+	/**
+	 * Append @a str padded according to @a spec. If @a is_numeric and zero
+	 * padding is requested, zeros are inserted after the sign/prefix
+	 *
+	 * @param str
+	 * @param size
+	 * @param spec
+	 * @param prefix_size Size of the sign/prefix in @a str
+	 * @param is_numeric
+	 */
+	void AppendPadded(const char *str, const size_t size, const Spec &spec,
+			const size_t prefix_size, const bool is_numeric);
+	void AppendFill(const char c, size_t count);
+
+	void FormatImpl(const char *format);
+	template<typename T, typename... Args>
+	void FormatImpl(const char *format, const T &arg, const Args&... args);
+
+	char *m_buf;
+	size_t m_capacity;
+	size_t m_required;
+};
+
+}
+
+#include "string_builder.tcc"
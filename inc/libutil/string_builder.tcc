@@ -0,0 +1,282 @@
+/*
+ * string_builder.tcc
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "libbase/misc_types.h"
+
+#include "libutil/string_builder.h"
+
+namespace libutil
+{
+
+namespace internal
+{
+
+inline bool IsStringBuilderRadixConv(const char conv)
+{
+	return (conv == 'x' || conv == 'X' || conv == 'o');
+}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value
+		&& !std::is_same<T, char>::value>::type
+AppendArg_(StringBuilder *builder, const StringBuilder::Spec &spec,
+		const T value)
+{
+	typedef typename std::make_unsigned<T>::type U;
+	if (spec.conv == 'c')
+	{
+		builder->Append(static_cast<char>(value));
+	}
+	else if (IsStringBuilderRadixConv(spec.conv) || spec.conv == 'u')
+	{
+		if (sizeof(T) <= sizeof(uint32_t))
+		{
+			// Follow printf, e.g., -1 is 0xFFFFFFFF but not 0xFFFFFFFFFFFFFFFF
+			builder->AppendUint(static_cast<uint32_t>(static_cast<U>(value)),
+					spec);
+		}
+		else
+		{
+			builder->AppendUint(static_cast<uint64_t>(static_cast<U>(value)),
+					spec);
+		}
+	}
+	else if (sizeof(T) <= sizeof(int32_t))
+	{
+		builder->AppendInt(static_cast<int32_t>(value), spec);
+	}
+	else
+	{
+		builder->AppendInt(static_cast<int64_t>(value), spec);
+	}
+}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value
+		&& std::is_unsigned<T>::value>::type
+AppendArg_(StringBuilder *builder, const StringBuilder::Spec &spec,
+		const T value)
+{
+	if (spec.conv == 'c')
+	{
+		builder->Append(static_cast<char>(value));
+	}
+	else if ((spec.conv == 'd' || spec.conv == 'i')
+			&& sizeof(T) >= sizeof(int32_t))
+	{
+		// Follow printf, e.g., 0xFFFFFFFF is -1. Smaller types are promoted
+		// to int by printf and thus stay positive
+		if (sizeof(T) == sizeof(int32_t))
+		{
+			builder->AppendInt(static_cast<int32_t>(value), spec);
+		}
+		else
+		{
+			builder->AppendInt(static_cast<int64_t>(value), spec);
+		}
+	}
+	else if (sizeof(T) <= sizeof(uint32_t))
+	{
+		builder->AppendUint(static_cast<uint32_t>(value), spec);
+	}
+	else
+	{
+		builder->AppendUint(static_cast<uint64_t>(value), spec);
+	}
+}
+
+inline void AppendArg_(StringBuilder *builder,
+		const StringBuilder::Spec &spec, const char value)
+{
+	if (spec.conv == 0 || spec.conv == 'c' || spec.conv == 's')
+	{
+		const char str[2] = {value, '\0'};
+		builder->AppendStr(str, spec);
+	}
+	else
+	{
+		AppendArg_(builder, spec, static_cast<signed char>(value));
+	}
+}
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type
+AppendArg_(StringBuilder *builder, const StringBuilder::Spec &spec,
+		const T value)
+{
+	if ((spec.conv == 'd' || spec.conv == 'i' || spec.conv == 'u')
+			&& spec.precision < 0)
+	{
+		StringBuilder::Spec int_spec = spec;
+		int_spec.precision = 0;
+		builder->AppendFloat(value, int_spec);
+	}
+	else
+	{
+		builder->AppendFloat(value, spec);
+	}
+}
+
+template<typename T>
+typename std::enable_if<std::is_enum<T>::value>::type
+AppendArg_(StringBuilder *builder, const StringBuilder::Spec &spec,
+		const T value)
+{
+	AppendArg_(builder, spec,
+			static_cast<typename std::underlying_type<T>::type>(value));
+}
+
+inline void AppendArg_(StringBuilder *builder,
+		const StringBuilder::Spec &spec, const char *str)
+{
+	if (spec.conv == 'p')
+	{
+		builder->AppendPtr(str, spec);
+	}
+	else
+	{
+		builder->AppendStr(str, spec);
+	}
+}
+
+inline void AppendArg_(StringBuilder *builder,
+		const StringBuilder::Spec &spec, const std::string &str)
+{
+	builder->AppendStr(str.c_str(), spec);
+}
+
+template<typename T>
+inline void AppendArg_(StringBuilder *builder,
+		const StringBuilder::Spec &spec, const T *ptr)
+{
+	builder->AppendPtr(ptr, spec);
+}
+
+/*
+ * The in place Tx API is not available in every UartDevice implementation,
+ * fall back to the copying path if that's the case
+ */
+template<typename UartDeviceT>
+auto IsTxRingEnabled_(UartDeviceT *uart, int)
+		-> decltype(uart->IsTxRingEnabled())
+{
+	return uart->IsTxRingEnabled();
+}
+
+template<typename UartDeviceT>
+bool IsTxRingEnabled_(UartDeviceT*, long)
+{
+	return false;
+}
+
+template<typename UartDeviceT>
+auto ReserveTx_(UartDeviceT *uart, const size_t size, int)
+		-> decltype(uart->ReserveTx(size))
+{
+	return uart->ReserveTx(size);
+}
+
+template<typename UartDeviceT>
+Byte* ReserveTx_(UartDeviceT*, const size_t, long)
+{
+	return nullptr;
+}
+
+template<typename UartDeviceT>
+auto CommitTx_(UartDeviceT *uart, const size_t size, int)
+		-> decltype(uart->CommitTx(size))
+{
+	uart->CommitTx(size);
+}
+
+template<typename UartDeviceT>
+void CommitTx_(UartDeviceT*, const size_t, long)
+{}
+
+}
+
+template<typename... Args>
+StringBuilder& StringBuilder::Format(const char *format, const Args&... args)
+{
+	FormatImpl(format, args...);
+	return *this;
+}
+
+template<typename T, typename... Args>
+void StringBuilder::FormatImpl(const char *format, const T &arg,
+		const Args&... args)
+{
+	Spec spec;
+	const char *next = ParseNext(format, &spec);
+	if (!next)
+	{
+		return;
+	}
+	internal::AppendArg_(this, spec, arg);
+	FormatImpl(next, args...);
+}
+
+template<typename... Args>
+size_t StringBuilder::FormatTo(char *buf, const size_t capacity,
+		const char *format, const Args&... args)
+{
+	StringBuilder builder(buf, capacity);
+	builder.FormatImpl(format, args...);
+	return builder.GetRequiredSize();
+}
+
+template<typename UartDeviceT, typename... Args>
+bool StringBuilder::SendFormat(UartDeviceT *uart, const size_t max_size,
+		const char *format, const Args&... args)
+{
+	if (internal::IsTxRingEnabled_(uart, 0))
+	{
+		// One extra byte for the NUL terminator, which is not going to be sent
+		Byte *reserved = internal::ReserveTx_(uart, max_size + 1, 0);
+		if (!reserved)
+		{
+			// Ring is full, the drop is already accounted by the UartDevice
+			return false;
+		}
+		StringBuilder builder(reinterpret_cast<char*>(reserved), max_size + 1);
+		builder.FormatImpl(format, args...);
+		if (!builder.IsTruncated())
+		{
+			internal::CommitTx_(uart, builder.GetSize(), 0);
+			return true;
+		}
+		// Larger than expected, cancel the reservation and copy it instead
+		internal::CommitTx_(uart, 0, 0);
+	}
+
+	char stack_buf[kStackSize];
+	StringBuilder builder(stack_buf);
+	builder.FormatImpl(format, args...);
+	if (!builder.IsTruncated())
+	{
+		return uart->SendBuffer(reinterpret_cast<const Byte*>(stack_buf),
+				builder.GetSize());
+	}
+
+	const size_t size = builder.GetRequiredSize();
+	std::unique_ptr<char[]> heap_buf(new char[size + 1]);
+	FormatTo(heap_buf.get(), size + 1, format, args...);
+	return uart->SendBuffer(reinterpret_cast<const Byte*>(heap_buf.get()),
+			size);
+}
+
+}
@@ -0,0 +1,277 @@
+/*
+ * task_scheduler.h
+ * Min-heap based timer task scheduler
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+
+#include "libbase/delegate.h"
+
+/**
+ * If set to 1, per-task execution time and lateness are recorded, see
+ * TaskScheduler::GetTaskStats()
+ */
+#ifndef LIBUTIL_TASK_PROFILE
+#define LIBUTIL_TASK_PROFILE 0
+#endif
+
+/**
+ * Max size (in bytes) of a callable stored as a TaskScheduler::Callback, the
+ * default fits a lambda capturing up to 8 pointers. A larger callable fails to
+ * compile, define a larger value in that case
+ */
+#ifndef LIBUTIL_TASK_CALLBACK_SIZE
+#define LIBUTIL_TASK_CALLBACK_SIZE (8 * sizeof(void*))
+#endif
+
+namespace libutil
+{
+
+/**
+ * Schedule one-shot and periodic tasks on a monotonic tick counter. Tasks are
+ * kept in a min-heap keyed on their due tick, such that Run() only costs
+ * O(k log n) for k due tasks out of n, and nothing at all when none is due.
+ * All storage is allocated in the constructor, adding/cancelling tasks
+ * afterwards never allocates
+ *
+ * The scheduler knows nothing about the hardware, the current tick is
+ * supplied by the caller. Ticks may wrap around, as long as no task is
+ * scheduled more than 2^31 ticks ahead
+ */
+class TaskScheduler
+{
+public:
+	typedef uint32_t Tick;
+	/**
+	 * Identify a task, composed of a slot index and a generation count such
+	 * that a stale ID won't cancel the task later reusing the slot
+	 */
+	typedef int32_t TaskId;
+
+	/**
+	 * @param request The period (or delay) of the task
+	 * @param actual The actual time passed since the task was last scheduled
+	 * @see LIBUTIL_TASK_CALLBACK_SIZE
+	 */
+	typedef libbase::Delegate<void(const uint32_t request,
+			const uint32_t actual), LIBUTIL_TASK_CALLBACK_SIZE> Callback;
+
+	enum struct RepeatMode
+	{
+		/// Not repeating
+		kOnce = 0,
+		/// Reduce the time between two calls if the first is delayed
+		kPrecise,
+		/// Always wait for at least the specified period
+		kLoose,
+	};
+
+	/**
+	 * Return a free running cycle counter, e.g., DWT->CYCCNT
+	 */
+	typedef uint32_t (*CycleCounter)();
+
+	static constexpr TaskId kInvalidTask = -1;
+	static constexpr uint8_t kDefaultPriority = 128;
+	/**
+	 * Lateness (tick the task is run - tick it's due) is counted in log2
+	 * buckets: 0, 1, 2-3, 4-7, ..., >= 64
+	 */
+	static constexpr size_t kLatenessBuckets = 8;
+
+	struct TaskStats
+	{
+		uint32_t count = 0;
+		uint32_t min_cycles = UINT32_MAX;
+		uint32_t max_cycles = 0;
+		uint64_t total_cycles = 0;
+		/// # times the task is run a whole period (or more) behind
+		uint32_t deadline_misses = 0;
+		uint16_t lateness_hist[kLatenessBuckets] = {};
+
+		uint32_t GetMeanCycles() const
+		{
+			return count ? static_cast<uint32_t>(total_cycles / count) : 0;
+		}
+	};
+
+	struct RunStats
+	{
+		/// # Run() calls with at least one task due
+		uint32_t run_count = 0;
+		/// Cycles spent in those Run() calls
+		uint64_t busy_cycles = 0;
+		/// Cycles between the first and the last of those Run() calls
+		uint64_t elapsed_cycles = 0;
+	};
+
+	/**
+	 * @param capacity Max # tasks scheduled at the same time
+	 */
+	explicit TaskScheduler(const size_t capacity);
+
+	/**
+	 * Schedule @a callback to be called @a period ticks later (and every
+	 * @a period ticks afterwards, if repeating)
+	 *
+	 * @param now Current tick
+	 * @param period
+	 * @param callback
+	 * @param mode
+	 * @param priority Among the tasks due in the same Run(), those with a
+	 * smaller value are called first
+	 * @param unit_shift The request and actual time passed to @a callback are
+	 * right shifted by this amount, e.g., 3 to convert 125us ticks to ms
+	 * @return ID of the task, or kInvalidTask if the scheduler is full
+	 */
+	TaskId Add(const Tick now, const Tick period, const Callback &callback,
+			const RepeatMode mode, const uint8_t priority = kDefaultPriority,
+			const uint8_t unit_shift = 0);
+	/**
+	 * Cancel a task. Safe to be called inside a callback, including the one
+	 * of the task itself
+	 *
+	 * @param id
+	 * @return true if the task was still scheduled
+	 */
+	bool Cancel(const TaskId id);
+
+	/**
+	 * Call all the tasks due at @a now, ordered by priority, then by due
+	 * tick. Tasks (re)scheduled during this call are not run until the next
+	 * call, even if they are already due
+	 *
+	 * @param now
+	 */
+	void Run(const Tick now);
+
+	/**
+	 * Return whether any task is due at @a now, i.e., whether Run() would do
+	 * anything
+	 *
+	 * @param now
+	 * @return
+	 */
+	bool IsDue(const Tick now) const;
+
+	/**
+	 * Set the counter used to measure the execution time of tasks. Without
+	 * one, only the counts and lateness are recorded
+	 *
+	 * @param counter
+	 */
+	void SetCycleCounter(const CycleCounter counter);
+
+	/**
+	 * Return the statistics of the task in @a slot, slots range from 0 to
+	 * GetCapacity() - 1. Only available when LIBUTIL_TASK_PROFILE is set
+	 *
+	 * @param slot
+	 * @param out_id ID of the task in @a slot
+	 * @param out_stats
+	 * @return false if @a slot is not in use, or profiling is disabled
+	 */
+	bool GetTaskStats(const size_t slot, TaskId *out_id,
+			TaskStats *out_stats) const;
+	/**
+	 * Return the overall statistics. Only available when LIBUTIL_TASK_PROFILE
+	 * is set, otherwise all zeros are returned
+	 *
+	 * @return
+	 */
+	RunStats GetRunStats() const;
+	void ResetStats();
+
+	size_t GetSize() const
+	{
+		return m_size;
+	}
+
+	size_t GetCapacity() const
+	{
+		return m_capacity;
+	}
+
+private:
+	enum struct State : uint8_t
+	{
+		kFree = 0,
+		kQueued,
+		kReady,
+		kRunning,
+	};
+
+	struct Task
+	{
+		Callback callback;
+		Tick due;
+		Tick period;
+		/// Tie breaker for tasks with the same due tick and priority
+		uint32_t seq;
+		uint16_t heap_pos;
+		uint16_t generation;
+		uint8_t priority;
+		RepeatMode mode;
+		uint8_t unit_shift;
+		State state;
+	};
+
+	static bool IsBefore(const Tick a, const Tick b)
+	{
+		return (static_cast<int32_t>(a - b) < 0);
+	}
+
+	bool IsHeapLess(const uint16_t a, const uint16_t b) const;
+	bool IsReadyLess(const uint16_t a, const uint16_t b) const;
+
+	void Push(const uint16_t slot);
+	uint16_t PopTop();
+	void Remove(const uint16_t slot);
+	void SiftUp(size_t pos);
+	void SiftDown(size_t pos);
+	void Place(const size_t pos, const uint16_t slot);
+
+	void Free(const uint16_t slot);
+
+#if LIBUTIL_TASK_PROFILE
+	uint32_t ReadCycle() const
+	{
+		return m_cycle_counter ? m_cycle_counter() : 0;
+	}
+
+	void RecordTask(const uint16_t slot, const Tick lateness,
+			const uint32_t cycles);
+#endif
+
+	const size_t m_capacity;
+	std::unique_ptr<Task[]> m_tasks;
+	/// Slot indices arranged as a binary min-heap
+	std::unique_ptr<uint16_t[]> m_heap;
+	size_t m_heap_size;
+	/// Due tasks collected in Run(), sorted by priority
+	std::unique_ptr<uint16_t[]> m_ready;
+	/// Free slots, used as a stack
+	std::unique_ptr<uint16_t[]> m_free;
+	size_t m_free_size;
+
+	size_t m_size;
+	uint32_t m_seq;
+
+#if LIBUTIL_TASK_PROFILE
+	CycleCounter m_cycle_counter;
+	std::unique_ptr<TaskStats[]> m_stats;
+	RunStats m_run_stats;
+	uint32_t m_prev_run_cycle;
+#endif
+};
+
+}
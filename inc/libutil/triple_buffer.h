@@ -0,0 +1,100 @@
+/*
+ * triple_buffer.h
+ * Lock-free triple buffer index rotation
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <atomic>
+
+namespace libutil
+{
+
+/**
+ * Rotate three buffers between a producer (e.g., a DMA complete ISR) and a
+ * consumer (e.g., the main loop) by swapping indices, no data is ever
+ * copied. At any time, one buffer is being written, one holds the latest
+ * complete data and one is being read. The producer never waits for the
+ * consumer, and the consumer always gets the latest complete data
+ *
+ * Only the indices are managed here, the buffers themselves are owned by the
+ * user. Safe for exactly one producer and one consumer
+ */
+class TripleBuffer
+{
+public:
+	TripleBuffer();
+
+	/**
+	 * Return the buffer the producer should write to
+	 *
+	 * @return
+	 */
+	uint8_t GetWriteIndex() const
+	{
+		return m_write;
+	}
+
+	/**
+	 * Publish the buffer just written as the latest one, the producer should
+	 * then continue with GetWriteIndex()
+	 *
+	 * @return true if the previous latest buffer is replaced before being
+	 * picked up by the consumer, i.e., it's dropped
+	 */
+	bool Publish();
+
+	/**
+	 * Return whether a newer buffer has been published since the last
+	 * Acquire()
+	 *
+	 * @return
+	 */
+	bool HasNew() const
+	{
+		return (m_latest.load(std::memory_order_acquire) & kNewBit);
+	}
+
+	/**
+	 * Switch to the latest published buffer if there's a newer one. The
+	 * returned buffer is not touched by the producer until the next Acquire()
+	 *
+	 * @return The buffer to be read
+	 */
+	uint8_t Acquire();
+
+	/**
+	 * Return the buffer currently held by the consumer
+	 *
+	 * @return
+	 */
+	uint8_t GetReadIndex() const
+	{
+		return m_read;
+	}
+
+	/**
+	 * Return to the initial state. Must not be called while the producer is
+	 * active
+	 */
+	void Reset();
+
+private:
+	static constexpr uint8_t kIndexMask = 0x03;
+	static constexpr uint8_t kNewBit = 0x04;
+
+	/// Owned by the producer
+	uint8_t m_write;
+	/// Index of the latest buffer, along with kNewBit if not yet acquired
+	std::atomic<uint8_t> m_latest;
+	/// Owned by the consumer
+	uint8_t m_read;
+};
+
+}
@@ -0,0 +1,73 @@
+/*
+ * varint_utils.h
+ * Variable length integer encoding (LEB128) and zigzag mapping
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libbase/misc_types.h"
+
+namespace libutil
+{
+
+class VarintUtils
+{
+public:
+	/// Max # bytes of an encoded 32-bit value
+	static constexpr size_t kMaxSize = 5;
+
+	/**
+	 * Return the # bytes needed to encode @a value
+	 *
+	 * @param value
+	 * @return
+	 */
+	static size_t GetSize(const uint32_t value);
+
+	/**
+	 * Encode @a value to @a out, which must have room for at least
+	 * GetSize(value) bytes
+	 *
+	 * @param value
+	 * @param out
+	 * @return # bytes written
+	 */
+	static size_t Encode(const uint32_t value, Byte *out);
+
+	/**
+	 * Decode a value from @a data
+	 *
+	 * @param data
+	 * @param size Size of @a data
+	 * @param out_value
+	 * @return # bytes consumed, or 0 if @a data is truncated or malformed
+	 */
+	static size_t Decode(const Byte *data, const size_t size,
+			uint32_t *out_value);
+
+	/**
+	 * Map a signed value to an unsigned one such that values with a small
+	 * magnitude will have a short encoding, i.e., 0, -1, 1, -2 => 0, 1, 2, 3
+	 *
+	 * @param value
+	 * @return
+	 */
+	static uint32_t ZigzagEncode(const int32_t value)
+	{
+		return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+	}
+
+	static int32_t ZigzagDecode(const uint32_t value)
+	{
+		return (int32_t)((value >> 1) ^ (~(value & 1) + 1));
+	}
+};
+
+}
@@ -0,0 +1,166 @@
+/*
+ * deferred_log.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+
+#include "libbase/deferred_log.h"
+#include "libbase/misc_types.h"
+
+#if defined(__ARM_ARCH_6M__)
+#include "libbase/helper.h"
+#include LIBBASE_H(hardware)
+#endif
+
+namespace libbase
+{
+
+namespace
+{
+
+/// Next index to be claimed by producers
+std::atomic<uint32_t> g_head(0);
+/// Next index to be drained
+std::atomic<uint32_t> g_tail(0);
+std::atomic<uint32_t> g_dropped(0);
+/// Owned by the consumer
+uint32_t g_reported_dropped = 0;
+/// Where g_tail and g_reported_dropped will be once Consume() is called
+uint32_t g_peek_tail = 0;
+uint32_t g_peek_reported_dropped = 0;
+
+void PutLe32(const uint32_t value, Byte *out)
+{
+	out[0] = value;
+	out[1] = value >> 8;
+	out[2] = value >> 16;
+	out[3] = value >> 24;
+}
+
+}
+
+DeferredLog::Slot DeferredLog::m_slots[DeferredLog::kSlotCount];
+
+DeferredLog::Slot* DeferredLog::Claim(uint32_t *out_index)
+{
+#if defined(__ARM_ARCH_6M__)
+	// No LDREX/STREX on ARMv6-M, resort to a (very short) critical section
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	const uint32_t head = g_head.load(std::memory_order_relaxed);
+	const bool is_full = (head - g_tail.load(std::memory_order_acquire)
+			>= kSlotCount);
+	if (is_full)
+	{
+		g_dropped.store(g_dropped.load(std::memory_order_relaxed) + 1,
+				std::memory_order_relaxed);
+	}
+	else
+	{
+		g_head.store(head + 1, std::memory_order_relaxed);
+	}
+	if (!primask)
+	{
+		__enable_irq();
+	}
+	if (is_full)
+	{
+		return nullptr;
+	}
+
+#else
+	uint32_t head = g_head.load(std::memory_order_relaxed);
+	do
+	{
+		if (head - g_tail.load(std::memory_order_acquire) >= kSlotCount)
+		{
+			g_dropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+	}
+	while (!g_head.compare_exchange_weak(head, head + 1,
+			std::memory_order_acq_rel, std::memory_order_relaxed));
+
+#endif
+	*out_index = head;
+	return &m_slots[head & (kSlotCount - 1)];
+}
+
+void DeferredLog::PutArg(Slot *slot, const char *arg)
+{
+	if (slot->size & 0x80)
+	{
+		return;
+	}
+	const size_t space = sizeof(slot->data) - slot->size;
+	if (space == 0)
+	{
+		slot->size |= 0x80;
+		return;
+	}
+	const size_t len = std::min<size_t>(arg ? strlen(arg) : 0, space - 1);
+	slot->data[slot->size] = len;
+	memcpy(slot->data + slot->size + 1, arg, len);
+	slot->size += len + 1;
+}
+
+size_t DeferredLog::Peek(Byte *out, const size_t size)
+{
+	size_t pos = 0;
+	const uint32_t dropped = g_dropped.load(std::memory_order_relaxed);
+	g_peek_reported_dropped = g_reported_dropped;
+	if (dropped != g_reported_dropped && pos + 10 <= size)
+	{
+		out[pos++] = kSync;
+		PutLe32(0, out + pos);
+		pos += 4;
+		out[pos++] = 4;
+		PutLe32(dropped - g_reported_dropped, out + pos);
+		pos += 4;
+		g_peek_reported_dropped = dropped;
+	}
+
+	uint32_t tail = g_tail.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Slot *slot = &m_slots[tail & (kSlotCount - 1)];
+		if (slot->seq.load(std::memory_order_acquire) != tail + 1)
+		{
+			// Not yet published
+			break;
+		}
+		const size_t data_size = slot->size & 0x7F;
+		if (pos + 6 + data_size > size)
+		{
+			break;
+		}
+
+		out[pos++] = kSync;
+		PutLe32(reinterpret_cast<uintptr_t>(slot->fmt), out + pos);
+		pos += 4;
+		out[pos++] = slot->size;
+		memcpy(out + pos, slot->data, data_size);
+		pos += data_size;
+		++tail;
+	}
+	g_peek_tail = tail;
+	return pos;
+}
+
+void DeferredLog::Consume()
+{
+	g_reported_dropped = g_peek_reported_dropped;
+	// Slots are only released to producers here
+	g_tail.store(g_peek_tail, std::memory_order_release);
+}
+
+}
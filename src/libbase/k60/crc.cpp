@@ -13,23 +13,70 @@
 
 #include "libbase/log.h"
 #include "libbase/k60/crc.h"
+#include "libbase/k60/dma.h"
+#include "libbase/k60/dma_manager.h"
 #include "libbase/k60/misc_utils.h"
 #include "libbase/k60/sim.h"
+#include "libbase/misc_types.h"
 
 namespace libbase
 {
 namespace k60
 {
 
+namespace
+{
+
+Dma::Config GetDmaConfig(const uint32_t *data, const size_t count)
+{
+	Dma::Config product;
+	product.src.addr = const_cast<uint32_t*>(data);
+	product.src.offset = 4;
+	product.src.size = Dma::Config::TransferSize::k4Byte;
+	product.src.major_offset = 0;
+	product.dst.addr = const_cast<uint32_t*>(&CRC0->CRC);
+	product.dst.offset = 0;
+	product.dst.size = Dma::Config::TransferSize::k4Byte;
+	product.dst.major_offset = 0;
+	// Software triggered, so the whole block has to be done in one minor loop
+	product.minor_bytes = count * 4;
+	product.major_count = 1;
+	return product;
+}
+
+}
+
 Crc::Crc(const Config &config)
-		: m_seed(config.seed), m_is_init(true)
+		: m_seed(config.seed),
+		  m_is_32_bit(config.is_32_bit),
+		  m_is_reflect(config.is_reflect),
+		  m_dma(nullptr),
+		  m_dma_threshold(config.dma_threshold),
+		  m_is_init(true)
 {
 	Sim::SetEnableClockGate(Sim::ClockGate::kCrc, true);
 
 	NewInstance(config.seed);
-	CRC0->CTRL = 0 | CRC_CTRL_TCRC_MASK | CRC_CTRL_TOT(1) | CRC_CTRL_TOTR(1)
-			| CRC_CTRL_FXOR_MASK;
+	uint32_t ctrl = 0;
+	if (config.is_32_bit)
+	{
+		ctrl |= CRC_CTRL_TCRC_MASK;
+	}
+	if (config.is_reflect)
+	{
+		ctrl |= CRC_CTRL_TOT(1) | CRC_CTRL_TOTR(1);
+	}
+	if (config.is_xor_out)
+	{
+		ctrl |= CRC_CTRL_FXOR_MASK;
+	}
+	CRC0->CTRL = ctrl;
 	CRC0->GPOLY = config.polynomial;
+
+	if (config.dma_channel != static_cast<uint8_t>(-1))
+	{
+		m_dma = DmaManager::New(GetDmaConfig(nullptr, 0), config.dma_channel);
+	}
 }
 
 Crc::Crc(Crc &&rhs)
@@ -39,7 +86,12 @@ Crc::Crc(Crc &&rhs)
 }
 
 Crc::Crc(nullptr_t)
-		: m_seed(0), m_is_init(false)
+		: m_seed(0),
+		  m_is_32_bit(true),
+		  m_is_reflect(true),
+		  m_dma(nullptr),
+		  m_dma_threshold(0),
+		  m_is_init(false)
 {}
 
 Crc::~Crc()
@@ -57,6 +109,11 @@ Crc& Crc::operator=(Crc &&rhs)
 			rhs.m_is_init = false;
 
 			m_seed = rhs.m_seed;
+			m_is_32_bit = rhs.m_is_32_bit;
+			m_is_reflect = rhs.m_is_reflect;
+			m_dma = rhs.m_dma;
+			rhs.m_dma = nullptr;
+			m_dma_threshold = rhs.m_dma_threshold;
 
 			m_is_init = true;
 		}
@@ -70,6 +127,11 @@ void Crc::Uninit()
 	{
 		m_is_init = false;
 
+		if (m_dma)
+		{
+			DmaManager::Delete(m_dma);
+			m_dma = nullptr;
+		}
 		Sim::SetEnableClockGate(Sim::ClockGate::kCrc, false);
 	}
 }
@@ -98,11 +160,86 @@ void Crc::PushData(const Byte data)
 	CRC0->ACCESS8BIT.CRCLL = data;
 }
 
+void Crc::PushData(const Byte *data, const size_t size)
+{
+	STATE_GUARD(Crc, VOID);
+
+	const Byte *it = data;
+	const Byte *const end = data + size;
+	while (it != end && (reinterpret_cast<uint32_t>(it) & 0x3))
+	{
+		CRC0->ACCESS8BIT.CRCLL = *it++;
+	}
+	const size_t word_count = (end - it) / 4;
+	if (word_count)
+	{
+		const uint32_t *words = reinterpret_cast<const uint32_t*>(it);
+		if (m_dma && word_count * 4 >= m_dma_threshold)
+		{
+			PushWordsDma(words, word_count);
+		}
+		else
+		{
+			PushWords(words, word_count);
+		}
+		it += word_count * 4;
+	}
+	while (it != end)
+	{
+		CRC0->ACCESS8BIT.CRCLL = *it++;
+	}
+}
+
+void Crc::PushWords(const uint32_t *data, const size_t count)
+{
+	// The CRC takes the MSB of a 32-bit write as the first byte, reverse the
+	// little endian words such that the bytes are fed in memory order
+	const uint32_t *it = data;
+	const uint32_t *const end = data + count;
+	while (end - it >= 4)
+	{
+		CRC0->CRC = __REV(it[0]);
+		CRC0->CRC = __REV(it[1]);
+		CRC0->CRC = __REV(it[2]);
+		CRC0->CRC = __REV(it[3]);
+		it += 4;
+	}
+	while (it != end)
+	{
+		CRC0->CRC = __REV(*it++);
+	}
+}
+
+void Crc::PushWordsDma(const uint32_t *data, const size_t count)
+{
+	// DMA can't reverse the words for us, let the CRC transpose the bytes
+	// instead (TOT = 2 transposes both bits and bytes, 3 transposes bytes
+	// only) during the transfer
+	const uint32_t ctrl = CRC0->CTRL;
+	CRC0->CTRL = (ctrl & ~CRC_CTRL_TOT_MASK)
+			| CRC_CTRL_TOT(m_is_reflect ? 2 : 3);
+
+	m_dma->Reinit(GetDmaConfig(data, count));
+	m_dma->Start();
+	while (!m_dma->IsDone())
+	{}
+	m_dma->Stop();
+
+	CRC0->CTRL = ctrl;
+}
+
 uint32_t Crc::GetCrc() const
 {
 	STATE_GUARD(Crc, 0);
 
-	return CRC0->CRC;
+	if (m_is_32_bit)
+	{
+		return CRC0->CRC;
+	}
+	else
+	{
+		return CRC0->CRC & 0xFFFF;
+	}
 }
 
 }
@@ -92,40 +92,87 @@ Dma& Dma::operator=(Dma &&rhs)
 
 void Dma::Init(const Config &config)
 {
-	DMA0->TCD[m_channel].SADDR = DMA_SADDR_SADDR(config.src.addr);
-	DMA0->TCD[m_channel].SOFF = DMA_SOFF_SOFF(config.src.offset);
-	InitTcdAttrReg(config);
-	InitTcdNbytesReg(config);
-	DMA0->TCD[m_channel].SLAST = DMA_SLAST_SLAST(config.src.major_offset);
-	DMA0->TCD[m_channel].DADDR = DMA_DADDR_DADDR(config.dst.addr);
-	DMA0->TCD[m_channel].DOFF = DMA_DOFF_DOFF(config.dst.offset);
-	DMA0->TCD[m_channel].DLAST_SGA = DMA_DLAST_SGA_DLASTSGA(
-			config.dst.major_offset);
-	InitTcdCsrReg(config);
-	InitTcdIterReg(config);
+	Tcd tcd;
+	MakeTcd(config, &tcd);
+	InitTcd(tcd);
 
 	InitEeiReg(config);
 
 	ResetDone();
 }
 
-void Dma::InitTcdAttrReg(const Config &config)
+void Dma::InitTcd(const Tcd &tcd)
+{
+	DMA0->TCD[m_channel].SADDR = tcd.saddr;
+	DMA0->TCD[m_channel].SOFF = tcd.soff;
+	DMA0->TCD[m_channel].ATTR = tcd.attr;
+	DMA0->TCD[m_channel].NBYTES_MLNO = tcd.nbytes;
+	DMA0->TCD[m_channel].SLAST = tcd.slast;
+	DMA0->TCD[m_channel].DADDR = tcd.daddr;
+	DMA0->TCD[m_channel].DOFF = tcd.doff;
+	DMA0->TCD[m_channel].DLAST_SGA = tcd.dlast_sga;
+	DMA0->TCD[m_channel].CSR = tcd.csr;
+	DMA0->TCD[m_channel].CITER_ELINKNO = tcd.citer;
+	DMA0->TCD[m_channel].BITER_ELINKNO = tcd.biter;
+}
+
+void Dma::MakeTcd(const Config &config, Tcd *out_tcd)
+{
+	out_tcd->saddr = DMA_SADDR_SADDR(config.src.addr);
+	out_tcd->soff = DMA_SOFF_SOFF(config.src.offset);
+	out_tcd->attr = GetTcdAttrReg(config);
+	out_tcd->nbytes = GetTcdNbytesReg(config);
+	out_tcd->slast = DMA_SLAST_SLAST(config.src.major_offset);
+	out_tcd->daddr = DMA_DADDR_DADDR(config.dst.addr);
+	out_tcd->doff = DMA_DOFF_DOFF(config.dst.offset);
+	out_tcd->citer = DMA_CITER_ELINKNO_CITER(config.major_count);
+	out_tcd->dlast_sga = DMA_DLAST_SGA_DLASTSGA(config.dst.major_offset);
+	out_tcd->csr = GetTcdCsrReg(config);
+	out_tcd->biter = DMA_BITER_ELINKNO_BITER(config.major_count);
+}
+
+void Dma::LinkTcd(Tcd *tcd, const Tcd *next)
+{
+	// The engine requires the next TCD to be 32-byte aligned
+	assert(!(reinterpret_cast<uint32_t>(next) & 0x1F));
+
+	tcd->dlast_sga = DMA_DLAST_SGA_DLASTSGA(next);
+	SET_BIT(tcd->csr, DMA_CSR_ESG_SHIFT);
+	CLEAR_BIT(tcd->csr, DMA_CSR_DREQ_SHIFT);
+	CLEAR_BIT(tcd->csr, DMA_CSR_INTMAJOR_SHIFT);
+	CLEAR_BIT(tcd->csr, DMA_CSR_INTHALF_SHIFT);
+}
+
+void Dma::SetTcdSrc(Tcd *tcd, const void *src_addr, const uint16_t major_count)
+{
+	tcd->saddr = DMA_SADDR_SADDR(src_addr);
+	tcd->citer = DMA_CITER_ELINKNO_CITER(major_count);
+	tcd->biter = DMA_BITER_ELINKNO_BITER(major_count);
+}
+
+void Dma::SetTcdDst(Tcd *tcd, void *dst_addr, const int16_t dst_offset,
+		const uint16_t major_count)
+{
+	tcd->daddr = DMA_DADDR_DADDR(dst_addr);
+	tcd->doff = DMA_DOFF_DOFF(dst_offset);
+	tcd->citer = DMA_CITER_ELINKNO_CITER(major_count);
+	tcd->biter = DMA_BITER_ELINKNO_BITER(major_count);
+}
+
+uint16_t Dma::GetTcdAttrReg(const Config &config)
 {
 	uint16_t reg = 0;
 	reg |= DMA_ATTR_SSIZE(config.src.size);
 	reg |= DMA_ATTR_DSIZE(config.dst.size);
-
-	DMA0->TCD[m_channel].ATTR = reg;
+	return reg;
 }
 
-void Dma::InitTcdNbytesReg(const Config &config)
+uint32_t Dma::GetTcdNbytesReg(const Config &config)
 {
 	uint32_t reg = 0;
 	if (!DmaManager::IsMinorLoopMapping())
 	{
 		reg |= DMA_NBYTES_MLNO_NBYTES(config.minor_bytes);
-
-		DMA0->TCD[m_channel].NBYTES_MLNO = reg;
 	}
 	else if (!config.minor_loop.is_enable_src_offset
 				&& !config.minor_loop.is_enable_dst_offset)
@@ -133,8 +180,6 @@ void Dma::InitTcdNbytesReg(const Config &config)
 		assert(config.minor_bytes < (1 << 30));
 
 		reg |= DMA_NBYTES_MLOFFNO_NBYTES(config.minor_bytes);
-
-		DMA0->TCD[m_channel].NBYTES_MLOFFNO = reg;
 	}
 	else
 	{
@@ -150,20 +195,11 @@ void Dma::InitTcdNbytesReg(const Config &config)
 		}
 		reg |= DMA_NBYTES_MLOFFYES_MLOFF(config.minor_loop.offset);
 		reg |= DMA_NBYTES_MLOFFYES_NBYTES(config.minor_bytes);
-
-		DMA0->TCD[m_channel].NBYTES_MLOFFYES = reg;
 	}
+	return reg;
 }
 
-void Dma::InitTcdIterReg(const Config &config)
-{
-	uint16_t reg = 0;
-	reg |= DMA_CITER_ELINKNO_CITER(config.major_count);
-	DMA0->TCD[m_channel].CITER_ELINKNO = reg;
-	DMA0->TCD[m_channel].BITER_ELINKNO = reg;
-}
-
-void Dma::InitTcdCsrReg(const Config &config)
+uint16_t Dma::GetTcdCsrReg(const Config &config)
 {
 	uint16_t reg = 0;
 	reg |= DMA_CSR_BWC(static_cast<int>(config.stall_duration));
@@ -179,8 +215,7 @@ void Dma::InitTcdCsrReg(const Config &config)
 		}
 		SET_BIT(reg, DMA_CSR_INTMAJOR_SHIFT);
 	}
-
-	DMA0->TCD[m_channel].CSR = reg;
+	return reg;
 }
 
 void Dma::InitEeiReg(const Config &config)
@@ -208,6 +243,36 @@ bool Dma::Reinit(const Config &config)
 	}
 }
 
+bool Dma::Reinit(const Tcd &tcd)
+{
+	if (!IsActive())
+	{
+		// DONE must be cleared before ESG could be set
+		ResetDone();
+		InitTcd(tcd);
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+bool Dma::SetDstAddr(void *addr)
+{
+	STATE_GUARD(Dma, false);
+
+	if (!IsActive())
+	{
+		DMA0->TCD[m_channel].DADDR = DMA_DADDR_DADDR(addr);
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
 void Dma::Uninit()
 {
 	if (m_is_init)
@@ -290,6 +355,13 @@ bool Dma::IsActive() const
 	return GET_BIT(DMA0->TCD[m_channel].CSR, DMA_CSR_ACTIVE_SHIFT);
 }
 
+uint16_t Dma::GetCurrentMajorCount() const
+{
+	STATE_GUARD(Dma, 0);
+
+	return DMA0->TCD[m_channel].CITER_ELINKNO & DMA_CITER_ELINKNO_CITER_MASK;
+}
+
 void Dma::EnableInterrupt()
 {
 #if MK60F15
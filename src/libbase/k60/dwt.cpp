@@ -20,7 +20,7 @@ namespace libbase
 namespace k60
 {
 
-void Dwt::DelayUs(const uint16_t us)
+void Dwt::EnableCycleCounter()
 {
 	if (GET_BIT(DWT->CTRL, DWT_CTRL_NOCYCCNT_Pos))
 	{
@@ -30,20 +30,25 @@ void Dwt::DelayUs(const uint16_t us)
 	}
 
 	SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Pos);
-	CLEAR_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Pos);
-	const uint32_t count = ClockUtils::GetCoreTickPerUs(us);
-	DWT->CYCCNT = 0;
 	SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Pos);
-	uint32_t store = 0;
-	uint32_t curr = 0;
-	while (store + curr < count)
+}
+
+void Dwt::DelayUs(const uint16_t us)
+{
+	if (GET_BIT(DWT->CTRL, DWT_CTRL_NOCYCCNT_Pos))
 	{
-		if (curr > DWT->CYCCNT)
-		{
-			store += curr;
-		}
-		curr = DWT->CYCCNT;
+		// CYCCNT not implemented
+		assert(false);
+		return;
 	}
+
+	// Measure the delta instead of resetting CYCCNT, which is shared with
+	// others measuring time spans
+	EnableCycleCounter();
+	const uint32_t count = ClockUtils::GetCoreTickPerUs(us);
+	const uint32_t start = DWT->CYCCNT;
+	while (DWT->CYCCNT - start < count)
+	{}
 }
 
 }
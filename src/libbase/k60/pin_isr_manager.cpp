@@ -7,11 +7,14 @@
  * Refer to LICENSE for details
  */
 
-#include <cstring>
+#include "libbase/k60/hardware.h"
+
+#include <cstdint>
 
 #include <bitset>
 #include <functional>
 
+#include "libbase/k60/dwt.h"
 #include "libbase/k60/misc_utils.h"
 #include "libbase/k60/pin.h"
 #include "libbase/k60/pin_isr_manager.h"
@@ -28,6 +31,14 @@ namespace libbase
 namespace k60
 {
 
+namespace
+{
+
+PORT_Type* const MEM_MAPS[PINOUT::GetPortCount()] = {PORTA, PORTB, PORTC,
+		PORTD, PORTE};
+
+}
+
 PinIsrManager* PinIsrManager::m_instance = nullptr;
 
 PinIsrManager* PinIsrManager::GetInstance()
@@ -43,9 +54,13 @@ PinIsrManager::PinIsrManager()
 {
 	for (Uint i = 0; i < PINOUT::GetPortCount(); ++i)
 	{
-		m_pin_data[i] = nullptr;
+		m_isrs[i] = nullptr;
+		m_isr_masks[i] = 0;
 		m_is_enable[i] = false;
 	}
+#if LIBBASE_PIN_ISR_PROFILE
+	Dwt::EnableCycleCounter();
+#endif
 }
 
 PinIsrManager::~PinIsrManager()
@@ -54,22 +69,20 @@ PinIsrManager::~PinIsrManager()
 	{
 		if (m_is_enable[i])
 		{
-			SetIsr(EnumAdvance(PORTA_IRQn, i), DefaultIsr);
-			DisableIrq(EnumAdvance(PORTA_IRQn, i));
+			UninitPort(i);
 		}
-		if (m_pin_data[i])
+		if (m_isrs[i])
 		{
-			delete[] m_pin_data[i];
+			delete[] m_isrs[i];
 		}
 	}
 }
 
 void PinIsrManager::InitPort(const Uint port)
 {
-	if (!m_pin_data[port])
+	if (!m_isrs[port])
 	{
-		m_pin_data[port] = new PinData[PINOUT::GetPortPinCount()];
-		memset(m_pin_data[port], 0, PINOUT::GetPortPinCount() * sizeof(PinData));
+		m_isrs[port] = new OnPinIrqListener[PINOUT::GetPortPinCount()];
 	}
 
 	switch (port)
@@ -101,6 +114,13 @@ void PinIsrManager::InitPort(const Uint port)
 	m_is_enable[port] = true;
 }
 
+void PinIsrManager::UninitPort(const Uint port)
+{
+	SetIsr(EnumAdvance(PORTA_IRQn, port), DefaultIsr);
+	DisableIrq(EnumAdvance(PORTA_IRQn, port));
+	m_is_enable[port] = false;
+}
+
 void PinIsrManager::SetPinIsr_(Pin *pin, const OnPinIrqListener &isr)
 {
 	const Uint port = PinUtils::GetPort(pin->GetName());
@@ -111,45 +131,114 @@ void PinIsrManager::SetPinIsr_(Pin *pin, const OnPinIrqListener &isr)
 		{
 			InitPort(port);
 		}
-		m_pin_data[port][pin_num].pin = nullptr;
-		m_pin_data[port][pin_num].isr = isr;
-		m_pin_data[port][pin_num].pin = pin;
+		// The listener and the mask must be seen together by the handler
+		const uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		m_isrs[port][pin_num] = isr;
+		SET_BIT(m_isr_masks[port], pin_num);
+		if (!primask)
+		{
+			__enable_irq();
+		}
 	}
 	else if (m_is_enable[port])
 	{
-		m_pin_data[port][pin_num].pin = nullptr;
-		m_pin_data[port][pin_num].isr = nullptr;
+		const uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		CLEAR_BIT(m_isr_masks[port], pin_num);
+		m_isrs[port][pin_num] = nullptr;
+		if (!primask)
+		{
+			__enable_irq();
+		}
 
 		// Disable interrupt only if all are null
-		for (Uint i = 0; i < PINOUT::GetPortPinCount(); ++i)
+		if (!m_isr_masks[port])
 		{
-			if (m_pin_data[port][i].isr)
-			{
-				return;
-			}
+			UninitPort(port);
 		}
-		SetIsr(EnumAdvance(PORTA_IRQn, port), DefaultIsr);
-		DisableIrq(EnumAdvance(PORTA_IRQn, port));
-		m_is_enable[port] = false;
 	}
 }
 
+PinIsrManager::DispatchStats PinIsrManager::GetDispatchStats(
+		const Uint port)
+{
+#if LIBBASE_PIN_ISR_PROFILE
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	const DispatchStats product = GetInstance()->m_stats[port];
+	if (!primask)
+	{
+		__enable_irq();
+	}
+	return product;
+#else
+	(void)port;
+	return {};
+#endif
+}
+
+void PinIsrManager::ResetDispatchStats(const Uint port)
+{
+#if LIBBASE_PIN_ISR_PROFILE
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	GetInstance()->m_stats[port] = DispatchStats();
+	if (!primask)
+	{
+		__enable_irq();
+	}
+#else
+	(void)port;
+#endif
+}
+
 template<Uint port>
 __ISR void PinIsrManager::PortIrqHandler()
 {
-	PinData *pin_data = PinIsrManager::GetInstance()->m_pin_data[port];
-	for (Uint i = 0; i < PINOUT::GetPortPinCount(); ++i)
+#if LIBBASE_PIN_ISR_PROFILE
+	const uint32_t enter_cycle = DWT->CYCCNT;
+	bool is_first = true;
+#endif
+
+	PinIsrManager *const that = m_instance;
+	// Clear every flag in the snapshot in one go, including those of pins
+	// without a listener, which would otherwise keep the IRQ firing. Only
+	// flags set after the read survive, and trigger the IRQ again
+	const uint32_t flags = MEM_MAPS[port]->ISFR;
+	MEM_MAPS[port]->ISFR = flags;
+
+	const OnPinIrqListener *isrs = that->m_isrs[port];
+	uint32_t pending = flags & that->m_isr_masks[port];
+	while (pending)
 	{
-		const Pin::Name pin = PinUtils::GetPin(port, i);
-		if (Pin::IsInterruptRequested(pin))
+		const Uint pin_num = __builtin_ctz(pending);
+		pending &= pending - 1;
+#if LIBBASE_PIN_ISR_PROFILE
+		if (is_first)
 		{
-			if (pin_data[i].pin && pin_data[i].isr)
+			const uint32_t latency = DWT->CYCCNT - enter_cycle;
+			DispatchStats &stats = that->m_stats[port];
+			stats.last_latency_cycles = latency;
+			if (latency > stats.max_latency_cycles)
 			{
-				pin_data[i].isr(pin);
+				stats.max_latency_cycles = latency;
 			}
-			Pin::ConsumeInterrupt(pin);
+			is_first = false;
 		}
+#endif
+		isrs[pin_num](PinUtils::GetPin(port, pin_num));
+	}
+
+#if LIBBASE_PIN_ISR_PROFILE
+	const uint32_t duration = DWT->CYCCNT - enter_cycle;
+	DispatchStats &stats = that->m_stats[port];
+	++stats.irq_count;
+	if (duration > stats.max_handler_cycles)
+	{
+		stats.max_handler_cycles = duration;
 	}
+#endif
 }
 
 }
@@ -47,8 +47,9 @@ Gpo::Config GetGpoConfig(const SoftPwm::Config &config)
 
 SoftPwm::SoftPwm(const Config &config)
 		: m_precision(config.precision),
-		  m_pit(GetPitConfig(config, std::bind(&SoftPwm::OnTick, this,
-				  std::placeholders::_1))),
+		  m_pit(GetPitConfig(config,
+				Pit::OnPitTriggerListener::Bind<SoftPwm,
+					&SoftPwm::OnTick>(this))),
 		  m_pin(GetGpoConfig(config)),
 		  m_flag(true),
 		  m_is_init(true)
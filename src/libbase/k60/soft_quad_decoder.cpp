@@ -47,8 +47,9 @@ SoftQuadDecoder::SoftQuadDecoder(const Config &config)
 		  m_is_invert_b_polarity(config.is_invert_b_polarity),
 		  m_is_dir_mode(config.encoding_mode
 				  == Config::EncodingMode::kCountDirection),
-		  m_qda(GetQdaConfig(config, std::bind(&SoftQuadDecoder::OnTick, this,
-				  std::placeholders::_1))),
+		  m_qda(GetQdaConfig(config,
+				Gpi::OnGpiEventListener::Bind<SoftQuadDecoder,
+					&SoftQuadDecoder::OnTick>(this))),
 		  m_qdb(GetQdbConfig(config)),
 		  m_count(0),
 		  m_is_init(true)
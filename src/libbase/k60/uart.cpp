@@ -128,6 +128,8 @@ Uart::Uart(const Config &config)
 		: m_is_fifo(false),
 		  m_rx_fifo_size(1),
 		  m_tx_fifo_size(1),
+		  m_rx_idle_size(0),
+		  m_is_rx_idle_paused(false),
 		  m_rx(nullptr),
 		  m_tx(nullptr),
 		  m_is_init(false)
@@ -148,12 +150,18 @@ Uart::Uart(const Config &config)
 	InitPin(config);
 	InitBaudRate(config.baud_rate);
 	InitC1Reg(config);
-	// Clear DMA bit in case it was set before
+	// Clear DMA bits in case they were set before
 	CLEAR_BIT(MEM_MAPS[m_module]->C5, UART_C5_TDMAS_SHIFT);
+	CLEAR_BIT(MEM_MAPS[m_module]->C5, UART_C5_RDMAS_SHIFT);
 	InitFifo(config);
 	InitInterrupt(config);
 
 	m_rx_buf.reset(new Byte[m_rx_fifo_size]);
+	if (m_rx_idle_isr)
+	{
+		// Whatever is in the FIFO, plus what's arrived while Rx is paused
+		m_rx_idle_buf.reset(new Byte[m_rx_fifo_size * 2]);
+	}
 
 	// Enable UART
 	MEM_MAPS[m_module]->C2 |= UART_C2_TE_MASK | UART_C2_RE_MASK;
@@ -170,6 +178,8 @@ Uart::Uart(nullptr_t)
 		  m_is_fifo(false),
 		  m_rx_fifo_size(0),
 		  m_tx_fifo_size(0),
+		  m_rx_idle_size(0),
+		  m_is_rx_idle_paused(false),
 		  m_rx(nullptr),
 		  m_tx(nullptr),
 
@@ -202,6 +212,10 @@ Uart& Uart::operator=(Uart &&rhs)
 			m_rx_fifo_size = rhs.m_rx_fifo_size;
 			// Copy instead of move to prevent race condition
 			m_rx_isr = rhs.m_rx_isr;
+			m_rx_idle_isr = rhs.m_rx_idle_isr;
+			m_rx_idle_buf = std::move(rhs.m_rx_idle_buf);
+			m_rx_idle_size = rhs.m_rx_idle_size;
+			m_is_rx_idle_paused = rhs.m_is_rx_idle_paused;
 
 			// Copy instead of move to prevent race condition
 			m_rx_buf.reset(new Byte[m_rx_fifo_size]);
@@ -320,8 +334,9 @@ void Uart::InitInterrupt(const Config &config)
 {
 	m_rx_isr = config.rx_isr;
 	m_tx_isr = config.tx_isr;
+	m_rx_idle_isr = config.rx_idle_isr;
 
-	SetInterrupt((bool)m_rx_isr, (bool)m_tx_isr);
+	SetInterrupt((bool)m_rx_isr || (bool)m_rx_idle_isr, (bool)m_tx_isr);
 }
 
 void Uart::Uninit()
@@ -331,6 +346,7 @@ void Uart::Uninit()
 		m_is_init = false;
 
 		m_rx_buf.reset();
+		m_rx_idle_buf.reset();
 
 		// Disable Tx, Rx and IRQ
 		MEM_MAPS[m_module]->C2 = 0;
@@ -362,6 +378,7 @@ void Uart::SetInterrupt(const bool tx_flag, const bool rx_flag)
 	// may not be intended
 	SetEnableRxIrq(false);
 	SetEnableTxIrq(false);
+	SetEnableRxIdleIrq(false);
 
 	if (tx_flag || rx_flag)
 	{
@@ -403,6 +420,38 @@ void Uart::SetEnableTxIrq(const bool flag)
 	}
 }
 
+void Uart::SetEnableRxIdleIrq(const bool flag)
+{
+	STATE_GUARD(Uart, VOID);
+
+	if (flag)
+	{
+		SET_BIT(MEM_MAPS[m_module]->C2, UART_C2_ILIE_SHIFT);
+	}
+	else
+	{
+		CLEAR_BIT(MEM_MAPS[m_module]->C2, UART_C2_ILIE_SHIFT);
+	}
+}
+
+size_t Uart::TakeRxIdleBytes(Byte *out_bytes)
+{
+	STATE_GUARD(Uart, 0);
+
+	const size_t size = m_rx_idle_size;
+	if (size)
+	{
+		memcpy(out_bytes, m_rx_idle_buf.get(), size);
+		m_rx_idle_size = 0;
+	}
+	if (m_is_rx_idle_paused)
+	{
+		m_is_rx_idle_paused = false;
+		SET_BIT(MEM_MAPS[m_module]->C2, UART_C2_RIE_SHIFT);
+	}
+	return size;
+}
+
 void Uart::ConfigTxAsDmaDst(Dma::Config *config)
 {
 	STATE_GUARD(Uart, VOID);
@@ -423,6 +472,26 @@ void Uart::ConfigTxAsDmaDst(Dma::Config *config)
 	SET_BIT(MEM_MAPS[m_module]->C5, UART_C5_TDMAS_SHIFT);
 }
 
+void Uart::ConfigRxAsDmaSrc(Dma::Config *config)
+{
+	STATE_GUARD(Uart, VOID);
+
+	if (m_rx_isr)
+	{
+		assert(false);
+		return;
+	}
+	config->mux_src = EnumAdvance(DmaMux::Source::kUart0Rx, m_module * 2);
+	config->src.addr = (void*)&MEM_MAPS[m_module]->D;
+	config->src.offset = 0;
+	config->src.size = Dma::Config::TransferSize::k1Byte;
+	config->src.major_offset = 0;
+	config->minor_bytes = 1;
+
+	SetEnableRxIrq(false);
+	SET_BIT(MEM_MAPS[m_module]->C5, UART_C5_RDMAS_SHIFT);
+}
+
 uint8_t Uart::GetAvailableBytes() const
 {
 	STATE_GUARD(Uart, 0);
@@ -554,8 +623,12 @@ __ISR void Uart::IrqHandler()
 		return;
 	}
 
+	// Reading S1 here is also the first step to clear IDLE
+	const uint8_t s1 = MEM_MAPS[module]->S1;
+	// RDRF is served by DMA instead when RDMAS is set
 	if (GET_BIT(MEM_MAPS[module]->C2, UART_C2_RIE_SHIFT)
-			&& GET_BIT(MEM_MAPS[module]->S1, UART_S1_RDRF_SHIFT))
+			&& !GET_BIT(MEM_MAPS[module]->C5, UART_C5_RDMAS_SHIFT)
+			&& GET_BIT(s1, UART_S1_RDRF_SHIFT))
 	{
 		if (that->m_rx_isr)
 		{
@@ -567,6 +640,70 @@ __ISR void Uart::IrqHandler()
 		}
 	}
 
+	if (GET_BIT(MEM_MAPS[module]->C2, UART_C2_ILIE_SHIFT)
+			&& GET_BIT(s1, UART_S1_IDLE_SHIFT))
+	{
+		if (!that->m_rx_idle_isr)
+		{
+			CLEAR_BIT(MEM_MAPS[module]->C2, UART_C2_ILIE_SHIFT);
+		}
+		else
+		{
+			// Reading D after S1 clears IDLE, which also pops the FIFO.
+			// Rather than waiting for the DMA to drain it, pause Rx requests
+			// and read out whatever is left, such that those bytes stay in
+			// order right after what the DMA has written. They are handed
+			// over, and the requests resumed, in TakeRxIdleBytes(). Only the
+			// FIFO access is done with interrupts masked
+			const uint32_t primask = __get_PRIMASK();
+			__disable_irq();
+			if (GET_BIT(MEM_MAPS[module]->C2, UART_C2_RIE_SHIFT))
+			{
+				CLEAR_BIT(MEM_MAPS[module]->C2, UART_C2_RIE_SHIFT);
+				that->m_is_rx_idle_paused = true;
+			}
+			const size_t capacity = that->m_rx_fifo_size * 2u;
+			const uint8_t available = MEM_MAPS[module]->RCFIFO;
+			if (available == 0)
+			{
+				const Byte byte = MEM_MAPS[module]->D;
+				// Reading an empty FIFO underflows it
+				if (GET_BIT(MEM_MAPS[module]->SFIFO, UART_SFIFO_RXUF_SHIFT))
+				{
+					MEM_MAPS[module]->SFIFO = UART_SFIFO_RXUF_MASK;
+					SET_BIT(MEM_MAPS[module]->CFIFO, UART_CFIFO_RXFLUSH_SHIFT);
+				}
+				else if (that->m_rx_idle_size < capacity)
+				{
+					// A byte made it into the FIFO right after the check
+					that->m_rx_idle_buf[that->m_rx_idle_size++] = byte;
+				}
+			}
+			else
+			{
+				// Anything beyond would stay in the FIFO for the DMA, which
+				// only happens if the previous bytes were never taken
+				for (Uint i = 0; i < available
+						&& that->m_rx_idle_size < capacity; ++i)
+				{
+					that->m_rx_idle_buf[that->m_rx_idle_size++] =
+							MEM_MAPS[module]->D;
+				}
+			}
+			if (that->m_rx_idle_size == 0 && that->m_is_rx_idle_paused)
+			{
+				that->m_is_rx_idle_paused = false;
+				SET_BIT(MEM_MAPS[module]->C2, UART_C2_RIE_SHIFT);
+			}
+			if (!primask)
+			{
+				__enable_irq();
+			}
+
+			that->m_rx_idle_isr(that);
+		}
+	}
+
 	if (GET_BIT(MEM_MAPS[module]->C2, UART_C2_TIE_SHIFT)
 			&& GET_BIT(MEM_MAPS[module]->S1, UART_S1_TDRE_SHIFT))
 	{
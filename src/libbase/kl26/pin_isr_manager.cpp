@@ -7,8 +7,10 @@
  * Refer to LICENSE for details
  */
 
+#include "libbase/kl26/hardware.h"
+
 #include <cassert>
-#include <cstring>
+#include <cstdint>
 
 #include <bitset>
 #include <functional>
@@ -29,6 +31,20 @@ namespace libbase
 namespace kl26
 {
 
+namespace
+{
+
+PORT_Type* const MEM_MAPS[PINOUT::GetPortCount()] = {PORTA, PORTB, PORTC,
+		PORTD, PORTE};
+
+IRQn_Type GetIrq(const Uint port)
+{
+	// Port C and D share the same IRQ
+	return (port == 0) ? PORTA_IRQn : PORTC_PORTD_IRQn;
+}
+
+}
+
 PinIsrManager* PinIsrManager::m_instance = nullptr;
 
 PinIsrManager* PinIsrManager::GetInstance()
@@ -44,7 +60,8 @@ PinIsrManager::PinIsrManager()
 {
 	for (Uint i = 0; i < PINOUT::GetPortCount(); ++i)
 	{
-		m_pin_data[i] = nullptr;
+		m_isrs[i] = nullptr;
+		m_isr_masks[i] = 0;
 		m_is_enable[i] = false;
 	}
 }
@@ -55,12 +72,11 @@ PinIsrManager::~PinIsrManager()
 	{
 		if (m_is_enable[i])
 		{
-			SetIsr(EnumAdvance(PORTA_IRQn, i), DefaultIsr);
-			DisableIrq(EnumAdvance(PORTA_IRQn, i));
+			UninitPort(i);
 		}
-		if (m_pin_data[i])
+		if (m_isrs[i])
 		{
-			delete[] m_pin_data[i];
+			delete[] m_isrs[i];
 		}
 	}
 }
@@ -74,10 +90,9 @@ void PinIsrManager::InitPort(const Uint port)
 		return;
 	}
 
-	if (!m_pin_data[port])
+	if (!m_isrs[port])
 	{
-		m_pin_data[port] = new PinData[PINOUT::GetPortPinCount()];
-		memset(m_pin_data[port], 0, PINOUT::GetPortPinCount() * sizeof(PinData));
+		m_isrs[port] = new OnPinIrqListener[PINOUT::GetPortPinCount()];
 	}
 
 	switch (port)
@@ -92,15 +107,22 @@ void PinIsrManager::InitPort(const Uint port)
 		SetIsr(PORTC_PORTD_IRQn, PortIrqHandler<2>);
 		EnableIrq(PORTC_PORTD_IRQn);
 		break;
-
-/*	case 3:
-		SetIsr(PORTC_PORTD_IRQn, PortIrqHandler<3>);
-		EnableIrq(PORTC_PORTD_IRQn);
-		break;*/
 	}
 	m_is_enable[port] = true;
 }
 
+void PinIsrManager::UninitPort(const Uint port)
+{
+	m_is_enable[port] = false;
+	if ((port == 2 && m_is_enable[3]) || (port == 3 && m_is_enable[2]))
+	{
+		// The shared IRQ is still in use by the other port
+		return;
+	}
+	SetIsr(GetIrq(port), DefaultIsr);
+	DisableIrq(GetIrq(port));
+}
+
 void PinIsrManager::SetPinIsr_(Pin *pin, const OnPinIrqListener &isr)
 {
 	const Uint port = PinUtils::GetPort(pin->GetName());
@@ -110,67 +132,69 @@ void PinIsrManager::SetPinIsr_(Pin *pin, const OnPinIrqListener &isr)
 		if (!m_is_enable[port])
 		{
 			InitPort(port);
+			if (!m_is_enable[port])
+			{
+				return;
+			}
+		}
+		// The listener and the mask must be seen together by the handler
+		const uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		m_isrs[port][pin_num] = isr;
+		SET_BIT(m_isr_masks[port], pin_num);
+		if (!primask)
+		{
+			__enable_irq();
 		}
-		m_pin_data[port][pin_num].pin = nullptr;
-		m_pin_data[port][pin_num].isr = isr;
-		m_pin_data[port][pin_num].pin = pin;
 	}
 	else if (m_is_enable[port])
 	{
-		m_pin_data[port][pin_num].pin = nullptr;
-		m_pin_data[port][pin_num].isr = nullptr;
+		const uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		CLEAR_BIT(m_isr_masks[port], pin_num);
+		m_isrs[port][pin_num] = nullptr;
+		if (!primask)
+		{
+			__enable_irq();
+		}
 
 		// Disable interrupt only if all are null
-		for (Uint i = 0; i < PINOUT::GetPortPinCount(); ++i)
+		if (!m_isr_masks[port])
 		{
-			if (m_pin_data[port][i].isr)
-			{
-				return;
-			}
+			UninitPort(port);
 		}
-		SetIsr(EnumAdvance(PORTA_IRQn, port), DefaultIsr);
-		DisableIrq(EnumAdvance(PORTA_IRQn, port));
-		m_is_enable[port] = false;
 	}
 }
 
-template<Uint port>
-__ISR void PinIsrManager::PortIrqHandler()
+inline void PinIsrManager::DispatchPort(const Uint port)
 {
-	PinData *pin_data = PinIsrManager::GetInstance()->m_pin_data[port];
-	for (Uint i = 0; i < PINOUT::GetPortPinCount(); ++i)
+	PinIsrManager *const that = m_instance;
+	// Clear every flag in the snapshot in one go, including those of pins
+	// without a listener, which would otherwise keep the IRQ firing. Only
+	// flags set after the read survive, and trigger the IRQ again
+	const uint32_t flags = MEM_MAPS[port]->ISFR;
+	MEM_MAPS[port]->ISFR = flags;
+
+	const OnPinIrqListener *isrs = that->m_isrs[port];
+	uint32_t pending = flags & that->m_isr_masks[port];
+	while (pending)
 	{
-		const Pin::Name pin = PinUtils::GetPin(port, i);
-		if (Pin::IsInterruptRequested(pin))
-		{
-			if (pin_data[i].pin && pin_data[i].isr)
-			{
-				pin_data[i].isr(pin);
-			}
-			Pin::ConsumeInterrupt(pin);
-		}
+		const Uint pin_num = __builtin_ctz(pending);
+		pending &= pending - 1;
+		isrs[pin_num](PinUtils::GetPin(port, pin_num));
 	}
-	/*
-	 * Consume Port D Isrs on PORTC_PORTD_IRQn
-	 */
-	if(port == 2)
+}
+
+template<Uint port>
+__ISR void PinIsrManager::PortIrqHandler()
+{
+	DispatchPort(port);
+	if (port == 2)
 	{
-		pin_data = PinIsrManager::GetInstance()->m_pin_data[port+1];
-		for (Uint i = 0; i < PINOUT::GetPortPinCount(); ++i)
-		{
-			const Pin::Name pin = PinUtils::GetPin(port+1, i);
-			if (Pin::IsInterruptRequested(pin))
-			{
-				if (pin_data[i].pin && pin_data[i].isr)
-				{
-					pin_data[i].isr(pin);
-				}
-				Pin::ConsumeInterrupt(pin);
-			}
-		}
+		// Port D shares PORTC_PORTD_IRQn
+		DispatchPort(port + 1);
 	}
 }
 
 }
 }
-
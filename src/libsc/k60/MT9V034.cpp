@@ -29,6 +29,7 @@
 #include "libsc/k60/MT9V034.h"
 #include "libsc/system.h"
 #include "libutil/misc.h"
+#include "libutil/row_band_plan.h"
 
 using namespace libbase::k60;
 using namespace libutil;
@@ -73,6 +74,22 @@ namespace {
 		return product;
 	}
 
+	RowBandPlan MakeRowPlan(const MT9V034::Config &config, const Uint w) {
+		// row_ranges only has room for kMaxRowRanges
+		assert(config.row_range_count <= MT9V034::Config::kMaxRowRanges);
+		const Uint range_count = (config.row_range_count
+				> MT9V034::Config::kMaxRowRanges)
+				? MT9V034::Config::kMaxRowRanges : config.row_range_count;
+		RowBandPlan product;
+		if (!product.Build(w, 480 / ((uint8_t) config.h_binning * 2),
+				range_count ? config.row_ranges : nullptr, range_count,
+				config.row_stride)) {
+			// No row selected, fall back to the whole frame
+			assert(false);
+		}
+		return product;
+	}
+
 }
 
 void MT9V034::RegSet(uint8_t reg_addr, uint16_t value) {
@@ -81,7 +98,7 @@ void MT9V034::RegSet(uint8_t reg_addr, uint16_t value) {
 }
 
 MT9V034::MT9V034(const Config &config) :
-m_sccb(GetSccbConfig()), m_data_array(GetGpiArrayConfig()), m_clock(GetClockConfig()), m_vsync(nullptr), m_dma(nullptr), m_w(1+752 / ((uint8_t) config.w_binning * 2)), m_h(480 / ((uint8_t) config.h_binning * 2)), m_buf_size(m_w * m_h), m_is_shoot(false), m_is_lock_buffer(false), m_is_available(false), m_is_dma_start(false) {
+m_sccb(GetSccbConfig()), m_data_array(GetGpiArrayConfig()), m_clock(GetClockConfig()), m_vsync(nullptr), m_dma(nullptr), m_tcds(nullptr), m_scratch(0), m_w(1+752 / ((uint8_t) config.w_binning * 2)), m_row_plan(MakeRowPlan(config, m_w)), m_h(m_row_plan.GetRowCount()), m_buf_size(m_row_plan.GetBufferSize()), m_vsync_time(0), m_seq(0), m_dropped_count(0), m_overrun_count(0), m_is_shoot(false), m_is_lock_buffer(false), m_is_available(false), m_is_dma_start(false) {
 	Byte out_byte_high;
 	Byte out_byte_low;
 	uint16_t result;
@@ -255,15 +272,14 @@ m_sccb(GetSccbConfig()), m_data_array(GetGpiArrayConfig()), m_clock(GetClockConf
 	m_sccb.SendByte(0xB8 >> 1, 0x0D, 3);
 	m_sccb.SendByte(0xB8 >> 1, 0xF0, out_byte_low);
 
-//Set window
+//Set window, only the rows from the first to the last captured one are read out
+	const Uint row_factor = (uint8_t) config.h_binning * 2;
 	m_sccb.SendByte(0xB8 >> 1, 0x01, 0);
 	m_sccb.SendByte(0xB8 >> 1, 0xF0, 1);
-	m_sccb.SendByte(0xB8 >> 1, 0x02, 0);
-	m_sccb.SendByte(0xB8 >> 1, 0xF0, 4);
+	RegSet(0x02, 4 + m_row_plan.GetWindowStart() * row_factor);
 
 //Set resolution
-	m_sccb.SendByte(0xB8 >> 1, 0x03, 480 >> 8);
-	m_sccb.SendByte(0xB8 >> 1, 0xF0, 480 & 0b11111111);
+	RegSet(0x03, m_row_plan.GetWindowSize() * row_factor);
 	m_sccb.SendByte(0xB8 >> 1, 0x04, 752 >> 8);
 	m_sccb.SendByte(0xB8 >> 1, 0xF0, 752 & 0b11111111);
 
@@ -281,7 +297,7 @@ m_sccb(GetSccbConfig()), m_data_array(GetGpiArrayConfig()), m_clock(GetClockConf
 	RegSet(0xAD, 0x01E0);//0xAD  max fine width   0x01E0-480
 	RegSet(0xAB, 50);//0xAB  max analog gain     64
 
-	RegSet(0xB0, 188*120);
+	RegSet(0xB0, std::min<Uint>(188*120, (m_w - 1) * m_row_plan.GetWindowSize()));
 	RegSet(0x1C, 0x0303);//0x1C  here is the way to regulate darkness :)
 
 	RegSet(0x13,0x2D2E);//We also recommended using R0x13 = 0x2D2E with this setting for better column FPN.
@@ -317,12 +333,15 @@ m_sccb(GetSccbConfig()), m_data_array(GetGpiArrayConfig()), m_clock(GetClockConf
 	m_front_buf.reset(new Byte[m_buf_size]);
 	memset(m_front_buf.get(), 0, m_buf_size);
 	m_back_buf.reset(new Byte[m_buf_size]);
+	m_frames[0].buffer = m_front_buf.get();
+	m_frames[1].buffer = m_back_buf.get();
+	m_frames[0].size = m_frames[1].size = m_buf_size;
 
 	RegSet(0x0C, 0x03);//0x0c  λ
 
 	InitDma();
 
-	m_vsync = Gpi(GetVsyncConfig(std::bind(&MT9V034::OnVsync, this, placeholders::_1)));
+	m_vsync = Gpi(GetVsyncConfig(Gpi::OnGpiEventListener::Bind<MT9V034, &MT9V034::OnVsync>(this)));
 // Set DMA to a higher priority to prevent VSYNC being processed earlier
 	NVIC_SetPriority(DMA1_DMA17_IRQn, __BASE_IRQ_PRIORITY - 2);
 	NVIC_SetPriority(PORTA_IRQn, __BASE_IRQ_PRIORITY - 1);
@@ -339,10 +358,42 @@ void MT9V034::InitDma() {
 	m_dma_config.dst.size = Dma::Config::TransferSize::k1Byte;
 	m_dma_config.dst.major_offset = -m_buf_size;
 	m_dma_config.major_count = m_buf_size;
-	m_dma_config.complete_isr = std::bind(&MT9V034::OnDmaComplete, this, placeholders::_1);
+	m_dma_config.complete_isr = Dma::OnCompleteListener::Bind<MT9V034, &MT9V034::OnDmaComplete>(this);
 	m_dma_config.mux_src = EnumAdvance(DmaMux::Source::kPortA, PinUtils::GetPort(LIBSC_MT9V034_PCLK));
 	m_dma = DmaManager::New(m_dma_config, LIBSC_MT9V034_DMA_CH);
 	m_front_buffer_writing=true;
+
+	const vector<RowBandPlan::Band> &bands = m_row_plan.GetBands();
+	if (bands.size() > 1) {
+		// One TCD per band, the discarded ones are all written to m_scratch
+		m_tcd_mem.reset(new Byte[(bands.size() + 1) * sizeof(Dma::Tcd)]);
+		const uint32_t addr = reinterpret_cast<uint32_t>(m_tcd_mem.get());
+		m_tcds = reinterpret_cast<Dma::Tcd*>((addr + 0x1F) & ~0x1F);
+		for (size_t i = 0; i < bands.size(); ++i) {
+			Dma::MakeTcd(m_dma_config, &m_tcds[i]);
+			Dma::SetTcdDst(&m_tcds[i], &m_scratch, 0, bands[i].size);
+			if (i > 0) {
+				Dma::LinkTcd(&m_tcds[i - 1], &m_tcds[i]);
+			}
+		}
+		SetDmaDst(m_front_buf.get());
+	}
+}
+
+void MT9V034::SetDmaDst(Byte *buf) {
+	if (!m_tcds) {
+		m_dma_config.dst.addr = buf;
+		m_dma->Reinit(m_dma_config);
+		return;
+	}
+
+	const vector<RowBandPlan::Band> &bands = m_row_plan.GetBands();
+	for (size_t i = 0; i < bands.size(); ++i) {
+		if (bands[i].is_keep) {
+			Dma::SetTcdDst(&m_tcds[i], buf + bands[i].dst_offset, 1, bands[i].size);
+		}
+	}
+	m_dma->Reinit(m_tcds[0]);
 }
 
 void MT9V034::Start() {
@@ -370,32 +421,53 @@ void MT9V034::UnlockBuffer() {
 	m_is_lock_buffer = false;
 }
 
+CameraFrame MT9V034::LockFrame() {
+	const Byte *buf = LockBuffer();
+	CameraFrame product = m_frames[(buf == m_front_buf.get()) ? 0 : 1];
+	product.dropped_count = m_dropped_count;
+	product.overrun_count = m_overrun_count;
+	return product;
+}
+
 void MT9V034::OnVsync(Gpi*) {
 	LOG_VL("MT9V034 vsync");
 	if (!m_is_shoot) {
 		return;
 	}
 	if (!m_is_dma_start) {
+		m_vsync_time = System::TimeUs();
 		m_is_dma_start = true;
+		// The channel may still hold the tail of the chain from before Stop()
+		SetDmaDst(m_front_buffer_writing?m_front_buf.get():m_back_buf.get());
 		m_dma->Start();
 		return;
 	}
 	if(!m_is_lock_buffer&&m_dma->IsDone()) {
-		m_dma_config.dst.addr = m_front_buffer_writing?m_front_buf.get():m_back_buf.get();
-		m_dma->Reinit(m_dma_config);
+		m_vsync_time = System::TimeUs();
+		SetDmaDst(m_front_buffer_writing?m_front_buf.get():m_back_buf.get());
 		m_dma->Start();
+	} else {
+		// Buffer locked or the previous frame still transferring, this one is lost
+		++m_overrun_count;
 	}
 }
 
 void MT9V034::OnDmaComplete(Dma*) {
 	LOG_VL("MT9V034 line complete");
+	CameraFrame &frame = m_frames[m_front_buffer_writing ? 0 : 1];
+	frame.seq = ++m_seq;
+	frame.timestamp_us = m_vsync_time;
+	if (m_is_available) {
+		// The previous frame was never locked and is going to be overwritten
+		++m_dropped_count;
+	}
 	m_is_available=true;
 	m_front_buffer_writing=!m_front_buffer_writing;
 }
 
 #else
 MT9V034::MT9V034(const Config&) :
-		m_sccb(nullptr), m_data_array(nullptr), m_dma(nullptr), m_w(0), m_h(0), m_is_shoot(false), m_is_lock_buffer(false), m_is_available(false), m_is_dma_start(false) {
+		m_sccb(nullptr), m_data_array(nullptr), m_dma(nullptr), m_tcds(nullptr), m_scratch(0), m_w(0), m_h(0), m_vsync_time(0), m_seq(0), m_dropped_count(0), m_overrun_count(0), m_is_shoot(false), m_is_lock_buffer(false), m_is_available(false), m_is_dma_start(false) {
 	LOG_DL("Configured not to use MT9V034");
 }
 MT9V034::~MT9V034() {
@@ -409,6 +481,9 @@ const Byte* MT9V034::LockBuffer() {
 }
 void MT9V034::UnlockBuffer() {
 }
+CameraFrame MT9V034::LockFrame() {
+	return {};
+}
 
 #endif /* LIBSC_USE_MT9V034 */
 
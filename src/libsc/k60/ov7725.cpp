@@ -162,19 +162,26 @@ Ov7725::Ov7725(const Config &config)
 		  m_w(libutil::Clamp<Uint>(1, config.w, 640)),
 		  m_h(libutil::Clamp<Uint>(1, config.h, 480)),
 		  m_buf_size(m_w * m_h / 8),
+		  m_bufs(new Byte[m_buf_size * 3]),
+		  m_vsync_time(0),
+		  m_seq(0),
+		  m_dropped_count(0),
+		  m_overrun_count(0),
 		  m_is_shoot(false),
-		  m_is_lock_buffer(false),
 		  m_is_available(false),
 		  m_is_dma_start(false)
 {
-	m_front_buf.reset(new Byte[m_buf_size]);
-	memset(m_front_buf.get(), 0, m_buf_size);
-	m_back_buf.reset(new Byte[m_buf_size]);
+	memset(m_bufs.get(), 0, m_buf_size * 3);
+	for (Uint i = 0; i < 3; ++i)
+	{
+		m_frames[i].buffer = GetBuffer(i);
+		m_frames[i].size = m_buf_size;
+	}
 
 	InitDma(config.id);
 
-	m_vsync = Gpi(GetVsyncConfig(config.id, std::bind(&Ov7725::OnVsync, this,
-			placeholders::_1)));
+	m_vsync = Gpi(GetVsyncConfig(config.id,
+			Gpi::OnGpiEventListener::Bind<Ov7725, &Ov7725::OnVsync>(this)));
 	// Set DMA to a higher priority to prevent VSYNC being processed earlier
 	NVIC_SetPriority(DMA1_DMA17_IRQn, __BASE_IRQ_PRIORITY - 1);
 }
@@ -189,13 +196,13 @@ void Ov7725::InitDma(const uint8_t id)
 {
 	Dma::Config config;
 	m_data_array.ConfigValueAsDmaSrc(&config);
-	config.dst.addr = m_back_buf.get();
+	config.dst.addr = GetBuffer(m_rotation.GetWriteIndex());
 	config.dst.offset = 1;
 	config.dst.size = Dma::Config::TransferSize::k1Byte;
 	config.dst.major_offset = -m_buf_size;
 	config.major_count = m_buf_size;
-	config.complete_isr = std::bind(&Ov7725::OnDmaComplete, this,
-			placeholders::_1);
+	config.complete_isr =
+			Dma::OnCompleteListener::Bind<Ov7725, &Ov7725::OnDmaComplete>(this);
 
 	switch (id)
 	{
@@ -230,13 +237,19 @@ void Ov7725::Stop()
 
 const Byte* Ov7725::LockBuffer()
 {
-	m_is_lock_buffer = true;
-	return m_front_buf.get();
+	return GetBuffer(m_rotation.Acquire());
 }
 
 void Ov7725::UnlockBuffer()
+{}
+
+CameraFrame Ov7725::LockFrame()
 {
-	m_is_lock_buffer = false;
+	// The ISR never touches the frame held by the consumer
+	CameraFrame product = m_frames[m_rotation.Acquire()];
+	product.dropped_count = m_dropped_count;
+	product.overrun_count = m_overrun_count;
+	return product;
 }
 
 void Ov7725::OnVsync(Gpi*)
@@ -249,27 +262,40 @@ void Ov7725::OnVsync(Gpi*)
 
 	if (m_dma->IsDone() || !m_is_dma_start)
 	{
+		m_vsync_time = System::TimeUs();
 		m_is_dma_start = true;
 		Pin::ConsumeInterrupt(m_clock.GetPin()->GetName());
 		m_dma->Start();
 	}
+	else
+	{
+		// Still transferring the previous frame, this one is lost
+		++m_overrun_count;
+	}
 }
 
 void Ov7725::OnDmaComplete(Dma*)
 {
 	LOG_VL("Ov7725 complete");
-	if (!m_is_lock_buffer)
+	// Hand the frame over and redirect the next one to a free buffer, nothing
+	// is copied
+	CameraFrame &frame = m_frames[m_rotation.GetWriteIndex()];
+	frame.seq = ++m_seq;
+	frame.timestamp_us = m_vsync_time;
+	if (m_rotation.Publish())
 	{
-		memcpy(m_front_buf.get(), m_back_buf.get(), m_buf_size);
-		m_is_available = true;
+		++m_dropped_count;
 	}
+	m_dma->SetDstAddr(GetBuffer(m_rotation.GetWriteIndex()));
+	m_is_available = true;
 }
 
 #else
 Ov7725::Ov7725(const Config&)
 		: m_config(nullptr), m_data_array(nullptr), m_dma(nullptr), m_w(0),
-		  m_h(0), m_buf_size(0), m_is_shoot(false), m_is_lock_buffer(false),
-		  m_is_available(false), m_is_dma_start(false)
+		  m_h(0), m_buf_size(0), m_vsync_time(0), m_seq(0), m_dropped_count(0),
+		  m_overrun_count(0), m_is_shoot(false), m_is_available(false),
+		  m_is_dma_start(false)
 {
 	LOG_DL("Configured not to use Ov7725");
 }
@@ -278,6 +304,7 @@ void Ov7725::Start() {}
 void Ov7725::Stop() {}
 const Byte* Ov7725::LockBuffer() { return nullptr; }
 void Ov7725::UnlockBuffer() {}
+CameraFrame Ov7725::LockFrame() { return {}; }
 
 #endif /* LIBSC_USE_OV7725 */
 
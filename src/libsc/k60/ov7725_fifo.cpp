@@ -290,10 +290,14 @@ Ov7725Fifo::Ov7725Fifo(const Config &config)
 		  m_vsync(nullptr),
 		  m_w(libutil::Clamp<Uint>(1, config.w, 640)),
 		  m_h(libutil::Clamp<Uint>(1, config.h, 480)),
-		  m_write_state(State::kIdle)
+		  m_write_state(State::kIdle),
+		  m_vsync_time(0),
+		  m_seq(0),
+		  m_overrun_count(0)
 {
-	m_vsync = Gpi(GetVsyncConfig(config, std::bind(&Ov7725Fifo::OnVsync, this,
-			placeholders::_1)));
+	m_vsync = Gpi(GetVsyncConfig(config,
+			Gpi::OnGpiEventListener::Bind<Ov7725Fifo,
+				&Ov7725Fifo::OnVsync>(this)));
 }
 
 Ov7725Fifo::~Ov7725Fifo()
@@ -305,6 +309,10 @@ void Ov7725Fifo::Start()
 	{
 		m_write_state = State::kReqStart;
 	}
+	else
+	{
+		++m_overrun_count;
+	}
 }
 
 bool Ov7725Fifo::ReadStep()
@@ -332,6 +340,7 @@ void Ov7725Fifo::OnVsync(Gpi*)
 		break;
 
 	case State::kReqStart:
+		m_vsync_time = System::TimeUs();
 		m_fifo.ResetWrite();
 		m_wen.Set();
 		m_write_state = State::kStart;
@@ -341,11 +350,24 @@ void Ov7725Fifo::OnVsync(Gpi*)
 		m_wen.Reset();
 		m_fifo.ResetRead();
 		m_fifo.Start(m_w * m_h * 2);
+		++m_seq;
 		m_write_state = State::kIdle;
 		break;
 	}
 }
 
+CameraFrame Ov7725Fifo::GetFrame() const
+{
+	CameraFrame product;
+	product.buffer = m_fifo.GetData().data();
+	product.size = m_fifo.GetDataSize();
+	product.seq = m_seq;
+	product.timestamp_us = m_vsync_time;
+	// Frames are only captured on request, so dropped_count is always 0
+	product.overrun_count = m_overrun_count;
+	return product;
+}
+
 vector<uint16_t> Ov7725Fifo::GetRgb565Data() const
 {
 	vector<uint16_t> product(m_w * m_h);
@@ -360,13 +382,15 @@ vector<uint16_t> Ov7725Fifo::GetRgb565Data() const
 #else
 Ov7725Fifo::Ov7725Fifo(const Config&)
 		: m_config(nullptr), m_fifo(nullptr), m_w(0), m_h(0),
-		  m_write_state(State::kIdle)
+		  m_write_state(State::kIdle), m_vsync_time(0), m_seq(0),
+		  m_overrun_count(0)
 {
 	LOG_DL("Configured not to use Ov7725");
 }
 Ov7725Fifo::~Ov7725Fifo() {}
 void Ov7725Fifo::Start() {}
 bool Ov7725Fifo::ReadStep() { return false; }
+CameraFrame Ov7725Fifo::GetFrame() const { return {}; }
 vector<uint16_t> Ov7725Fifo::GetRgb565Data() const { return {}; }
 
 #endif /* LIBSC_USE_OV7725_FIFO */
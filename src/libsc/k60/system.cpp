@@ -10,6 +10,7 @@
 #include <cstdint>
 
 #include "libbase/k60/cache.h"
+#include "libbase/k60/clock_utils.h"
 
 #include "libsc/config.h"
 #include "libsc/k60/dwt_delay.h"
@@ -22,6 +23,30 @@ using namespace libsc::k60;
 namespace libsc
 {
 
+namespace
+{
+
+/**
+ * Return the upper 64 bits of the 128-bit product, with 32-bit multiplies
+ * only
+ */
+inline uint64_t MulHigh(const uint64_t a, const uint64_t b)
+{
+	const uint64_t a_lo = static_cast<uint32_t>(a);
+	const uint64_t a_hi = a >> 32;
+	const uint64_t b_lo = static_cast<uint32_t>(b);
+	const uint64_t b_hi = b >> 32;
+
+	const uint64_t lo_lo = a_lo * b_lo;
+	const uint64_t hi_lo = a_hi * b_lo;
+	const uint64_t lo_hi = a_lo * b_hi;
+	const uint64_t mid = (lo_lo >> 32) + static_cast<uint32_t>(hi_lo)
+			+ static_cast<uint32_t>(lo_hi);
+	return a_hi * b_hi + (hi_lo >> 32) + (lo_hi >> 32) + (mid >> 32);
+}
+
+}
+
 System::Impl *System::m_instance = nullptr;
 
 struct System::Impl
@@ -30,9 +55,15 @@ struct System::Impl
 
 	DwtDelay delay;
 	SysTickTimer timer;
+
+	uint32_t tick_per_us;
+	/// floor((2^64 - 1) / tick_per_us), to turn TimeUs() into multiplies
+	uint64_t us_reciprocal;
 };
 
 System::Impl::Impl()
+		: tick_per_us(ClockUtils::GetCoreTickPerUs()),
+		  us_reciprocal(UINT64_MAX / tick_per_us)
 {
 	// Enable cache unless otherwise disabled
 #if !LIBSC_NOT_USE_CACHE && MK60F15
@@ -82,4 +113,24 @@ Timer::TimerInt System::TimeIn125us()
 }
 #endif
 
+uint64_t System::TimeUs()
+{
+	assert(m_instance);
+	const uint64_t cycles = m_instance->timer.TimeCycles();
+	// The reciprocal is at most 1 short of 2^64 / tick_per_us, so the
+	// estimate is either exact or 1 less
+	uint64_t us = MulHigh(cycles, m_instance->us_reciprocal);
+	if (cycles - us * m_instance->tick_per_us >= m_instance->tick_per_us)
+	{
+		++us;
+	}
+	return us;
+}
+
+uint64_t System::TimeCycles()
+{
+	assert(m_instance);
+	return m_instance->timer.TimeCycles();
+}
+
 }
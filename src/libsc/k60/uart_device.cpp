@@ -11,6 +11,7 @@
 #include <cstdio>
 #include <cstring>
 
+#include <algorithm>
 #include <functional>
 #include <list>
 #include <memory>
@@ -18,6 +19,7 @@
 #include <vector>
 
 #include "libbase/log.h"
+#include "libbase/k60/hardware.h"
 #include "libbase/k60/dma.h"
 #include "libbase/k60/dma_manager.h"
 #include "libbase/k60/misc_utils.h"
@@ -26,6 +28,7 @@
 
 #include "libsc/config.h"
 #include "libsc/k60/uart_device.h"
+#include "libutil/byte_ring_buffer.h"
 #include "libutil/misc.h"
 
 using namespace libbase::k60;
@@ -59,89 +62,112 @@ struct UartDevice::RxBuffer
 	uint32_t end;
 };
 
-class UartDevice::TxBuffer
+struct UartDevice::TxBlock
 {
-public:
-	struct Block
+	TxBlock(Byte* const data, const size_t size, const bool is_mem_owned)
+			: type(kByteAry),
+			  size(size),
+			  it(0),
+			  is_mem_owned(is_mem_owned)
 	{
-		Block(Byte* const data, const size_t size, const bool is_mem_owned)
-				: type(kByteAry),
-				  size(size),
-				  it(0),
-				  is_mem_owned(is_mem_owned)
-		{
-			this->data.byte_ = data;
-		}
+		this->data.byte_ = data;
+	}
 
-		Block(Byte* const data, const size_t size)
-				: Block(data, size, true)
-		{}
+	TxBlock(Byte* const data, const size_t size)
+			: TxBlock(data, size, true)
+	{}
 
-		explicit Block(std::string* const data)
-				: type(kString),
-				  size(data->size()),
-				  it(0),
-				  is_mem_owned(true)
-		{
-			this->data.string_ = data;
-		}
+	explicit TxBlock(std::string* const data)
+			: type(kString),
+			  size(data->size()),
+			  it(0),
+			  is_mem_owned(true)
+	{
+		this->data.string_ = data;
+	}
 
-		explicit Block(std::vector<Byte>* const data)
-				: type(kVector),
-				  size(data->size()),
-				  it(0),
-				  is_mem_owned(true)
-		{
-			this->data.vector_ = data;
-		}
+	explicit TxBlock(std::vector<Byte>* const data)
+			: type(kVector),
+			  size(data->size()),
+			  it(0),
+			  is_mem_owned(true)
+	{
+		this->data.vector_ = data;
+	}
 
-		Block()
-				: type(kByteAry),
-				  size(0),
-				  it(0),
-				  is_mem_owned(false)
-		{
-			this->data.byte_ = nullptr;
-		}
+	TxBlock()
+			: type(kByteAry),
+			  size(0),
+			  it(0),
+			  is_mem_owned(false)
+	{
+		this->data.byte_ = nullptr;
+	}
 
-		Block(const Block&) = delete;
-		Block(Block &&rhs)
-				: data(rhs.data),
-				  type(rhs.type),
-				  size(rhs.size),
-				  it(rhs.it),
-				  is_mem_owned(rhs.is_mem_owned)
-		{
-			rhs.data.byte_ = nullptr;
-			rhs.is_mem_owned = false;
-		}
+	TxBlock(const TxBlock&) = delete;
+	TxBlock(TxBlock &&rhs)
+			: data(rhs.data),
+			  type(rhs.type),
+			  size(rhs.size),
+			  it(rhs.it),
+			  is_mem_owned(rhs.is_mem_owned),
+			  channel(rhs.channel)
+	{
+		rhs.data.byte_ = nullptr;
+		rhs.is_mem_owned = false;
+	}
 
-		~Block()
-		{
-			Recycle();
-		}
+	~TxBlock()
+	{
+		Recycle();
+	}
 
-		Block& operator=(const Block&) = delete;
-		Block& operator=(Block &&rhs);
+	TxBlock& operator=(const TxBlock&) = delete;
+	TxBlock& operator=(TxBlock &&rhs);
 
-		void Recycle();
+	void Recycle();
 
-		union
-		{
-			Byte *byte_;
-			std::string *string_;
-			std::vector<Byte> *vector_;
-		} data;
-		enum : uint8_t
+	const Byte* GetData() const
+	{
+		switch (type)
 		{
-			kByteAry,
-			kString,
-			kVector,
-		} type;
-		size_t size;
-		volatile size_t it;
-		bool is_mem_owned;
-	};
+		default:
+			assert(false);
+			// no break
+
+		case kByteAry:
+			return data.byte_;
+
+		case kString:
+			return reinterpret_cast<const Byte*>(data.string_->data());
+
+		case kVector:
+			return data.vector_->data();
+		}
+	}
+
+	union
+	{
+		Byte *byte_;
+		std::string *string_;
+		std::vector<Byte> *vector_;
+	} data;
+	enum : uint8_t
+	{
+		kByteAry,
+		kString,
+		kVector,
+	} type;
+	size_t size;
+	volatile size_t it;
+	bool is_mem_owned;
+	uint8_t channel = kNoChannel;
+};
+
+class UartDevice::TxBuffer
+{
+public:
+	typedef TxBlock Block;
 
 	explicit TxBuffer(const size_t capacity)
 			: m_capacity(capacity),
@@ -155,9 +181,29 @@ public:
 		return (uint32_t)(m_end - m_start);
 	}
 
+	bool IsFull() const
+	{
+		return (GetSize() == m_capacity);
+	}
+
 	bool PushBlock(Block &&block);
 	Block* GetActiveBlock();
 	Block* NextBlock();
+	/**
+	 * Return the block @a offset blocks after the active one, or nullptr if
+	 * there's no such block
+	 *
+	 * @param offset
+	 * @return
+	 */
+	Block* GetBlock(const size_t offset);
+	/**
+	 * Remove the block @a offset blocks after the active one, blocks after it
+	 * are shifted forward
+	 *
+	 * @param offset
+	 */
+	void RemoveBlock(const size_t offset);
 
 private:
 	const size_t m_capacity;
@@ -167,7 +213,7 @@ private:
 };
 
 
-UartDevice::TxBuffer::Block& UartDevice::TxBuffer::Block::operator=(Block &&rhs)
+UartDevice::TxBlock& UartDevice::TxBlock::operator=(TxBlock &&rhs)
 {
 	if (this != &rhs)
 	{
@@ -182,11 +228,12 @@ UartDevice::TxBuffer::Block& UartDevice::TxBuffer::Block::operator=(Block &&rhs)
 		size = rhs.size;
 		it = rhs.it;
 		is_mem_owned = is_mem_owned_;
+		channel = rhs.channel;
 	}
 	return *this;
 }
 
-void UartDevice::TxBuffer::Block::Recycle()
+void UartDevice::TxBlock::Recycle()
 {
 	if (is_mem_owned && data.byte_)
 	{
@@ -236,6 +283,35 @@ UartDevice::TxBuffer::Block* UartDevice::TxBuffer::GetActiveBlock()
 	}
 }
 
+UartDevice::TxBuffer::Block* UartDevice::TxBuffer::GetBlock(
+		const size_t offset)
+{
+	if (GetSize() <= offset)
+	{
+		return nullptr;
+	}
+	else
+	{
+		return &m_data[(m_start + offset) % m_capacity];
+	}
+}
+
+void UartDevice::TxBuffer::RemoveBlock(const size_t offset)
+{
+	const uint32_t size = GetSize();
+	if (size <= offset)
+	{
+		return;
+	}
+
+	for (uint32_t i = m_start + offset; i + 1 != m_start + size; ++i)
+	{
+		m_data[i % m_capacity] = std::move(m_data[(i + 1) % m_capacity]);
+	}
+	m_data[(m_start + size - 1) % m_capacity].Recycle();
+	--m_end;
+}
+
 UartDevice::TxBuffer::Block* UartDevice::TxBuffer::NextBlock()
 {
 	if (GetSize() == 0)
@@ -252,6 +328,30 @@ UartDevice::TxBuffer::Block* UartDevice::TxBuffer::NextBlock()
 namespace
 {
 
+/**
+ * Mask interrupts within the scope, restoring the previous state on leaving
+ */
+class IrqLock
+{
+public:
+	IrqLock()
+			: m_primask(__get_PRIMASK())
+	{
+		__disable_irq();
+	}
+
+	~IrqLock()
+	{
+		if (!m_primask)
+		{
+			__enable_irq();
+		}
+	}
+
+private:
+	uint32_t m_primask;
+};
+
 #if LIBSC_USE_UART == 1
 inline Pin::Name GetTxPin(const uint8_t)
 {
@@ -334,13 +434,49 @@ Uart::Config UartDevice::Initializer::GetUartConfig() const
 UartDevice::UartDevice(const Initializer &initializer)
 		: m_rx_buf{new RxBuffer},
 		  m_rx_isr(initializer.config.rx_isr),
-		  m_tx_buf(new TxBuffer(initializer.config.tx_buf_size)),
+		  m_rx_dma(nullptr),
+		  m_rx_dma_buf_size(0),
+		  m_rx_dma_pos(0),
+		  m_is_rx_flushing(false),
+		  m_is_rx_flush_pending(false),
 		  m_is_tx_idle(true),
+		  m_is_tx_reserved(false),
+		  m_tx_budget(initializer.config.tx_buf_bytes),
+		  m_tx_policy(initializer.config.tx_overflow_policy),
+		  m_tx_pending_bytes(0),
 		  m_dma(nullptr),
+		  m_tx_dma_size(0),
+		  m_tx_tcds(nullptr),
+		  m_tx_tcd_count(0),
+		  m_tx_dma_block_count(0),
 		  m_uart(nullptr)
 {
+	if (initializer.config.tx_ring_size)
+	{
+		m_tx_ring.reset(new ByteRingBuffer(initializer.config.tx_ring_size));
+	}
+	else
+	{
+		m_tx_buf.reset(new TxBuffer(initializer.config.tx_buf_size));
+	}
+
+	const bool is_rx_dma =
+			(initializer.config.rx_dma_channel != static_cast<uint8_t>(-1));
 	Uart::Config &&uart_config = initializer.GetUartConfig();
-	uart_config.rx_isr = std::bind(&UartDevice::OnRxFull, this, placeholders::_1);
+	if (is_rx_dma)
+	{
+		// Every byte should be moved out by DMA as soon as it arrives, or it
+		// would be stuck in the FIFO on idle
+		uart_config.rx_irq_threshold = 1;
+		uart_config.is_rx_irq_threshold_percentage = false;
+		uart_config.rx_idle_isr = std::bind(&UartDevice::OnRxIdle, this,
+				placeholders::_1);
+	}
+	else
+	{
+		uart_config.rx_isr = std::bind(&UartDevice::OnRxFull, this,
+				placeholders::_1);
+	}
 	if (initializer.config.tx_dma_channel == static_cast<uint8_t>(-1))
 	{
 		uart_config.tx_isr = std::bind(&UartDevice::OnTxEmpty, this,
@@ -357,10 +493,50 @@ UartDevice::UartDevice(const Initializer &initializer)
 		m_dma_config->src.major_offset = 0;
 		m_dma_config->major_count = 0;
 		m_uart.ConfigTxAsDmaDst(m_dma_config.get());
-		m_dma_config->complete_isr = std::bind(&UartDevice::OnTxDmaComplete,
-				this, placeholders::_1);
+		m_dma_config->complete_isr =
+				Dma::OnCompleteListener::Bind<UartDevice,
+					&UartDevice::OnTxDmaComplete>(this);
 
 		m_dma = DmaManager::New(*m_dma_config, initializer.config.tx_dma_channel);
+
+		Dma::MakeTcd(*m_dma_config, &m_tx_tcd_template);
+		m_tx_tcd_count = std::max<uint8_t>(
+				initializer.config.tx_dma_chain_length, 1);
+		if (!m_tx_ring && m_tx_tcd_count > 1)
+		{
+			// TCDs in a chain must be 32-byte aligned
+			m_tx_tcd_mem.reset(new Byte[(m_tx_tcd_count + 1) * sizeof(Dma::Tcd)]);
+			const uint32_t addr = reinterpret_cast<uint32_t>(m_tx_tcd_mem.get());
+			m_tx_tcds = reinterpret_cast<Dma::Tcd*>((addr + 0x1F) & ~0x1F);
+		}
+	}
+
+	if (is_rx_dma)
+	{
+		m_rx_dma_buf_size = std::max<uint16_t>(
+				initializer.config.rx_dma_buf_size, 1) * 2;
+		// CITER is only 15-bit wide
+		assert(m_rx_dma_buf_size <= 0x7FFF);
+		m_rx_dma_buf.reset(new Byte[m_rx_dma_buf_size]);
+		m_rx_idle_buf.reset(new Byte[m_uart.GetRxFifoSize() * 2]);
+
+		Dma::Config rx_dma_config;
+		m_uart.ConfigRxAsDmaSrc(&rx_dma_config);
+		rx_dma_config.dst.addr = m_rx_dma_buf.get();
+		rx_dma_config.dst.offset = 1;
+		rx_dma_config.dst.size = Dma::Config::TransferSize::k1Byte;
+		// Rewind to the beginning and keep going forever
+		rx_dma_config.dst.major_offset = -static_cast<int32_t>(m_rx_dma_buf_size);
+		rx_dma_config.major_count = m_rx_dma_buf_size;
+		rx_dma_config.is_listen_half_complete = true;
+		rx_dma_config.is_disable_request = false;
+		rx_dma_config.complete_isr =
+				Dma::OnCompleteListener::Bind<UartDevice,
+					&UartDevice::OnRxDmaComplete>(this);
+
+		m_rx_dma = DmaManager::New(rx_dma_config,
+				initializer.config.rx_dma_channel);
+		m_rx_dma->Start();
 	}
 
 	EnableRx();
@@ -373,16 +549,28 @@ UartDevice::~UartDevice()
 		DmaManager::Delete(m_dma);
 	}
 	DisableRx();
+	if (m_rx_dma)
+	{
+		DmaManager::Delete(m_rx_dma);
+	}
 }
 
 inline void UartDevice::EnableRx()
 {
 	m_uart.SetEnableRxIrq(true);
+	if (m_rx_dma)
+	{
+		m_uart.SetEnableRxIdleIrq(true);
+	}
 }
 
 inline void UartDevice::DisableRx()
 {
 	m_uart.SetEnableRxIrq(false);
+	if (m_rx_dma)
+	{
+		m_uart.SetEnableRxIdleIrq(false);
+	}
 }
 
 inline void UartDevice::EnableTx()
@@ -417,135 +605,368 @@ bool UartDevice::SendStr(const char *str)
 	{
 		return true;
 	}
+	if (m_tx_ring)
+	{
+		return PushTxRing(reinterpret_cast<const Byte*>(str), size);
+	}
 	Byte *data = new Byte[size];
 	memcpy(data, str, size);
 
-	if(m_tx_buf->PushBlock(TxBuffer::Block(data, size)))
+	return PushTxBlock(TxBlock(data, size));
+}
+
+bool UartDevice::SendStr(unique_ptr<char[]> &&str)
+{
+	const size_t size = strlen(str.get());
+	if (size == 0)
 	{
-		EnableTx();
 		return true;
 	}
-	else
+	if (m_tx_ring)
 	{
-		return false;
+		return PushTxRing(reinterpret_cast<const Byte*>(str.get()), size);
 	}
+
+	return PushTxBlock(TxBlock(reinterpret_cast<Byte*>(str.release()),
+			size));
 }
 
-bool UartDevice::SendStr(unique_ptr<char[]> &&str)
+bool UartDevice::SendStr(string &&str)
 {
-	const size_t size = strlen(str.get());
-	if (size == 0)
+	if (str.size() == 0)
 	{
 		return true;
 	}
+	if (m_tx_ring)
+	{
+		return PushTxRing(reinterpret_cast<const Byte*>(str.data()), str.size());
+	}
 
-	if(m_tx_buf->PushBlock(TxBuffer::Block(reinterpret_cast<Byte*>(str.release()),
-			size)))
+	return PushTxBlock(TxBlock(new string(std::move(str))));
+}
+
+bool UartDevice::SendBuffer(const Byte *buf, const size_t len)
+{
+	if (len == 0)
 	{
-		EnableTx();
 		return true;
 	}
-	else
+	if (m_tx_ring)
 	{
-		return false;
+		return PushTxRing(buf, len);
 	}
+	Byte *data = new Byte[len];
+	memcpy(data, buf, len);
+
+	return PushTxBlock(TxBlock(data, len));
 }
 
-bool UartDevice::SendStr(string &&str)
+bool UartDevice::SendBuffer(unique_ptr<Byte[]> &&buf, const size_t len)
 {
-	if (str.size() == 0)
+	if (len == 0)
 	{
 		return true;
 	}
+	if (m_tx_ring)
+	{
+		return PushTxRing(buf.get(), len);
+	}
 
-	if(m_tx_buf->PushBlock(TxBuffer::Block(new string(std::move(str)))))
+	return PushTxBlock(TxBlock(buf.release(), len));
+}
+
+bool UartDevice::SendBuffer(vector<Byte> &&buf)
+{
+	if (buf.size() == 0)
 	{
-		EnableTx();
 		return true;
 	}
-	else
+	if (m_tx_ring)
 	{
-		return false;
+		return PushTxRing(buf.data(), buf.size());
 	}
+
+	return PushTxBlock(TxBlock(new vector<Byte>(std::move(buf))));
 }
 
-bool UartDevice::SendBuffer(const Byte *buf, const size_t len)
+bool UartDevice::SendBuffer(const Byte *buf, const size_t len,
+		const uint8_t channel)
 {
 	if (len == 0)
 	{
 		return true;
 	}
+	if (m_tx_ring)
+	{
+		return PushTxRing(buf, len);
+	}
 	Byte *data = new Byte[len];
 	memcpy(data, buf, len);
 
-	if (m_tx_buf->PushBlock(TxBuffer::Block(data, len)))
+	TxBlock block(data, len);
+	block.channel = channel;
+	return PushTxBlock(std::move(block));
+}
+
+bool UartDevice::SendStrLiteral(const char *str)
+{
+	const size_t size = strlen(str);
+	if (size == 0)
 	{
-		EnableTx();
 		return true;
 	}
-	else
+	if (m_tx_ring)
 	{
-		return false;
+		return PushTxRing(reinterpret_cast<const Byte*>(str), size);
 	}
+
+	return PushTxBlock(TxBlock((Byte*)str, size, false));
 }
 
-bool UartDevice::SendBuffer(unique_ptr<Byte[]> &&buf, const size_t len)
+bool UartDevice::SendBufferNoCopy(const Byte *buf, const size_t len)
 {
 	if (len == 0)
 	{
 		return true;
 	}
+	if (m_tx_ring)
+	{
+		return PushTxRing(buf, len);
+	}
+
+	return PushTxBlock(TxBlock(const_cast<Byte*>(buf), len, false));
+}
 
-	if (m_tx_buf->PushBlock(TxBuffer::Block(buf.release(), len)))
+Byte* UartDevice::ReserveTx(const size_t size)
+{
+	if (!m_tx_ring)
 	{
-		EnableTx();
-		return true;
+		return nullptr;
+	}
+	IrqLock lock;
+	// The ring only allows one reservation at a time. Any other producer
+	// (e.g., an ISR interrupting one in the main loop) is turned away
+	Byte *product = m_is_tx_reserved ? nullptr : m_tx_ring->Reserve(size);
+	if (product)
+	{
+		m_is_tx_reserved = true;
 	}
 	else
 	{
-		return false;
+		m_tx_stats.dropped_bytes += size;
 	}
+	return product;
 }
 
-bool UartDevice::SendBuffer(vector<Byte> &&buf)
+void UartDevice::CommitTx(const size_t size)
 {
-	if (buf.size() == 0)
+	if (!m_tx_ring)
 	{
-		return true;
+		return;
 	}
-
-	if (m_tx_buf->PushBlock(TxBuffer::Block(new vector<Byte>(std::move(buf)))))
+	{
+		IrqLock lock;
+		if (!m_is_tx_reserved)
+		{
+			// ReserveTx() failed
+			assert(size == 0);
+			return;
+		}
+		m_tx_ring->Commit(size);
+		m_is_tx_reserved = false;
+		if (size > 0)
+		{
+			OnTxQueued(size);
+		}
+	}
+	if (size > 0)
 	{
 		EnableTx();
-		return true;
 	}
-	else
+}
+
+bool UartDevice::PushTxRing(const Byte *data, const size_t size)
+{
 	{
-		return false;
+		IrqLock lock;
+		Byte *dst = m_is_tx_reserved ? nullptr : m_tx_ring->Reserve(size);
+		if (!dst)
+		{
+			m_tx_stats.dropped_bytes += size;
+			return false;
+		}
+		memcpy(dst, data, size);
+		m_tx_ring->Commit(size);
+		OnTxQueued(size);
 	}
+	EnableTx();
+	return true;
 }
 
-bool UartDevice::SendStrLiteral(const char *str)
+bool UartDevice::PushTxBlock(TxBlock &&block)
 {
-	const size_t size = strlen(str);
-	if (size == 0)
+	const size_t size = block.size;
+	bool is_queued = false;
 	{
-		return true;
+		IrqLock lock;
+		if (!IsTxFit(size))
+		{
+			switch (m_tx_policy)
+			{
+			case TxOverflowPolicy::kDropNewest:
+				break;
+
+			case TxOverflowPolicy::kDropOldest:
+				DropOldestTx(size);
+				break;
+
+			case TxOverflowPolicy::kCoalesce:
+				is_queued = CoalesceTx(&block);
+				break;
+			}
+		}
+
+		if (!is_queued && IsTxFit(size))
+		{
+			is_queued = m_tx_buf->PushBlock(std::move(block));
+		}
+		if (is_queued)
+		{
+			OnTxQueued(size);
+		}
+		else
+		{
+			m_tx_stats.dropped_bytes += size;
+		}
 	}
 
-	if (m_tx_buf->PushBlock(TxBuffer::Block((Byte*)str, size, false)))
+	if (is_queued)
 	{
 		EnableTx();
-		return true;
 	}
-	else
+	return is_queued;
+}
+
+inline bool UartDevice::IsTxFit(const size_t size) const
+{
+	return (!m_tx_buf->IsFull() && (m_tx_budget == 0
+			|| m_tx_pending_bytes + size <= m_tx_budget));
+}
+
+void UartDevice::DropOldestTx(const size_t size)
+{
+	if (m_tx_budget != 0 && size > m_tx_budget)
+	{
+		// Would never fit, don't bother
+		return;
+	}
+
+	size_t offset = 0;
+	while (!IsTxFit(size))
+	{
+		TxBlock *block = m_tx_buf->GetBlock(offset);
+		if (!block)
+		{
+			return;
+		}
+		else if (!IsTxBlockPending(offset))
+		{
+			++offset;
+			continue;
+		}
+
+		m_tx_pending_bytes -= block->size;
+		m_tx_stats.dropped_bytes += block->size;
+		m_tx_buf->RemoveBlock(offset);
+	}
+}
+
+bool UartDevice::CoalesceTx(TxBlock *block)
+{
+	if (block->channel == kNoChannel)
 	{
 		return false;
 	}
+
+	for (size_t offset = 0; ; ++offset)
+	{
+		TxBlock *queued = m_tx_buf->GetBlock(offset);
+		if (!queued)
+		{
+			return false;
+		}
+		else if (queued->channel != block->channel
+				|| !IsTxBlockPending(offset))
+		{
+			continue;
+		}
+
+		const uint32_t pending = m_tx_pending_bytes - queued->size;
+		if (m_tx_budget != 0 && pending + block->size > m_tx_budget)
+		{
+			return false;
+		}
+		m_tx_pending_bytes = pending;
+		m_tx_stats.dropped_bytes += queued->size;
+		*queued = std::move(*block);
+		return true;
+	}
+}
+
+inline bool UartDevice::IsTxBlockPending(const size_t offset)
+{
+	// Blocks being walked by DMA, or partially sent, must stay put
+	return (offset >= m_tx_dma_block_count
+			&& m_tx_buf->GetBlock(offset)->it == 0);
+}
+
+inline void UartDevice::OnTxQueued(const size_t size)
+{
+	IrqLock lock;
+	const uint32_t pending = m_tx_pending_bytes + size;
+	m_tx_pending_bytes = pending;
+	m_tx_stats.queued_bytes += size;
+	m_tx_stats.high_water_bytes = std::max(m_tx_stats.high_water_bytes,
+			pending);
+}
+
+inline void UartDevice::OnTxSent(const size_t size)
+{
+	// Only called in ISR
+	m_tx_stats.sent_bytes += size;
+	m_tx_pending_bytes -= size;
+}
+
+UartDevice::TxStats UartDevice::GetTxStats() const
+{
+	IrqLock lock;
+	return m_tx_stats;
+}
+
+void UartDevice::ResetTxStats()
+{
+	IrqLock lock;
+	m_tx_stats = TxStats();
+	m_tx_stats.high_water_bytes = m_tx_pending_bytes;
 }
 
 void UartDevice::OnTxEmpty(Uart *uart)
 {
+	if (m_tx_ring)
+	{
+		size_t size;
+		const Byte *data = m_tx_ring->GetReadable(&size);
+		if (!data)
+		{
+			DisableTx();
+			return;
+		}
+		const size_t sent = uart->PutBytes(data, size);
+		m_tx_ring->Consume(sent);
+		OnTxSent(sent);
+		return;
+	}
+
 	TxBuffer::Block *block = m_tx_buf->GetActiveBlock();
 	while (block && block->it == block->size)
 	{
@@ -558,33 +979,53 @@ void UartDevice::OnTxEmpty(Uart *uart)
 	}
 
 	const size_t size = block->size - block->it;
-	switch (block->type)
-	{
-	case TxBuffer::Block::kByteAry:
-		block->it += uart->PutBytes(block->data.byte_ + block->it, size);
-		break;
-
-	case TxBuffer::Block::kString:
-		block->it += uart->PutBytes((const Byte*)block->data.string_->data()
-				+ block->it, size);
-		break;
-
-	case TxBuffer::Block::kVector:
-		block->it += uart->PutBytes(block->data.vector_->data() + block->it,
-				size);
-		break;
-	}
+	const size_t sent = uart->PutBytes(block->GetData() + block->it, size);
+	block->it += sent;
+	OnTxSent(sent);
 }
 
 void UartDevice::OnTxDmaComplete(Dma*)
 {
-	TxBuffer::Block *block = m_tx_buf->GetActiveBlock();
-	block->it = block->size;
+	if (m_tx_ring)
+	{
+		m_tx_ring->Consume(m_tx_dma_size);
+		OnTxSent(m_tx_dma_size);
+		m_tx_dma_size = 0;
+		NextTxDma();
+		return;
+	}
+
+	for (Uint i = 0; i < m_tx_dma_block_count; ++i)
+	{
+		TxBuffer::Block *block = m_tx_buf->GetBlock(i);
+		OnTxSent(block->size - block->it);
+		block->it = block->size;
+	}
+	m_tx_dma_block_count = 0;
 	NextTxDma();
 }
 
 void UartDevice::NextTxDma()
 {
+	if (m_tx_ring)
+	{
+		size_t size;
+		const Byte *data = m_tx_ring->GetReadable(&size);
+		if (!data)
+		{
+			DisableTx();
+			return;
+		}
+		// CITER is only 15-bit wide
+		m_tx_dma_size = std::min<size_t>(size, 0x7FFF);
+		m_dma_config->src.addr = const_cast<Byte*>(data);
+		m_dma_config->major_count = m_tx_dma_size;
+
+		m_dma->Reinit(*m_dma_config);
+		m_dma->Start();
+		return;
+	}
+
 	TxBuffer::Block *block = m_tx_buf->GetActiveBlock();
 	while (block && block->it == block->size)
 	{
@@ -596,23 +1037,33 @@ void UartDevice::NextTxDma()
 		return;
 	}
 
-	switch (block->type)
+	if (!m_tx_tcds)
 	{
-	case TxBuffer::Block::kByteAry:
-		m_dma_config->src.addr = block->data.byte_;
-		break;
+		m_dma_config->src.addr = const_cast<Byte*>(block->GetData());
+		m_dma_config->major_count = block->size;
+		m_tx_dma_block_count = 1;
 
-	case TxBuffer::Block::kString:
-		m_dma_config->src.addr = (void*)block->data.string_->data();
-		break;
+		m_dma->Reinit(*m_dma_config);
+		m_dma->Start();
+		return;
+	}
 
-	case TxBuffer::Block::kVector:
-		m_dma_config->src.addr = block->data.vector_->data();
-		break;
+	// Express the queued blocks as a scatter/gather chain
+	Uint count = 0;
+	while (block && count < m_tx_tcd_count)
+	{
+		Dma::Tcd *tcd = &m_tx_tcds[count];
+		*tcd = m_tx_tcd_template;
+		Dma::SetTcdSrc(tcd, block->GetData(), block->size);
+		if (count > 0)
+		{
+			Dma::LinkTcd(&m_tx_tcds[count - 1], tcd);
+		}
+		block = m_tx_buf->GetBlock(++count);
 	}
-	m_dma_config->major_count = block->size;
+	m_tx_dma_block_count = count;
 
-	m_dma->Reinit(*m_dma_config);
+	m_dma->Reinit(m_tx_tcds[0]);
 	m_dma->Start();
 }
 
@@ -634,28 +1085,106 @@ void UartDevice::SetRxIsr(const OnReceiveListener &l)
 	EnableRx();
 }
 
-void UartDevice::OnRxFull(Uart *uart)
+void UartDevice::DeliverRx(const Byte *data, const size_t size)
 {
-	size_t size;
-	const Byte *recv = uart->PeekBytes(&size);
-	if (!recv)
+	if (!m_rx_isr || !m_rx_isr(data, size))
+	{
+		PushRxBuffer(data, size);
+	}
+}
+
+void UartDevice::PushRxBuffer(const Byte *data, const size_t size)
+{
+	// One slot is always kept empty
+	const size_t space = RX_BUFFER_SIZE - 1 - m_rx_buf->GetSize();
+	const size_t copy_size = std::min(size, space);
+	if (copy_size == 0)
 	{
 		return;
 	}
 
-	if (!m_rx_isr || !m_rx_isr(recv, size))
+	// At most two pieces, split at the end of the buffer
+	const uint32_t end = m_rx_buf->end;
+	const size_t pos = end % RX_BUFFER_SIZE;
+	const size_t first_size = std::min<size_t>(copy_size, RX_BUFFER_SIZE - pos);
+	Byte *const buf = const_cast<Byte*>(m_rx_buf->data);
+	memcpy(buf + pos, data, first_size);
+	memcpy(buf, data + first_size, copy_size - first_size);
+	m_rx_buf->end = end + copy_size;
+}
+
+void UartDevice::FlushRxDma()
+{
+	// Reachable from both the DMA and the UART IRQ, which may nest. The
+	// listener is called with interrupts enabled, so instead of re-entering,
+	// have the ongoing flush go another round
 	{
-		for (size_t i = 0; i < size; ++i)
+		IrqLock lock;
+		if (m_is_rx_flushing)
 		{
-			if (m_rx_buf->GetSize() + 1 >= RX_BUFFER_SIZE)
-			{
-				break;
-			}
-			m_rx_buf->data[m_rx_buf->end++ % RX_BUFFER_SIZE] = recv[i];
+			m_is_rx_flush_pending = true;
+			return;
+		}
+		m_is_rx_flushing = true;
+	}
+
+	while (true)
+	{
+		size_t written;
+		size_t idle_size;
+		{
+			IrqLock lock;
+			m_is_rx_flush_pending = false;
+			// CITER counts down from the buffer size, and is reloaded on
+			// completion. The DMA is paused while the UART holds idle bytes,
+			// so they go right after this point
+			written = (m_rx_dma_buf_size - m_rx_dma->GetCurrentMajorCount())
+					% m_rx_dma_buf_size;
+			idle_size = m_uart.TakeRxIdleBytes(m_rx_idle_buf.get());
+		}
+
+		while (m_rx_dma_pos != written)
+		{
+			const size_t end = (written > m_rx_dma_pos) ? written
+					: m_rx_dma_buf_size;
+			DeliverRx(m_rx_dma_buf.get() + m_rx_dma_pos, end - m_rx_dma_pos);
+			m_rx_dma_pos = end % m_rx_dma_buf_size;
+		}
+		if (idle_size)
+		{
+			DeliverRx(m_rx_idle_buf.get(), idle_size);
+		}
+
+		IrqLock lock;
+		if (!m_is_rx_flush_pending)
+		{
+			m_is_rx_flushing = false;
+			return;
 		}
 	}
 }
 
+void UartDevice::OnRxFull(Uart *uart)
+{
+	size_t size;
+	const Byte *recv = uart->PeekBytes(&size);
+	if (!recv)
+	{
+		return;
+	}
+	DeliverRx(recv, size);
+}
+
+void UartDevice::OnRxDmaComplete(Dma*)
+{
+	FlushRxDma();
+}
+
+void UartDevice::OnRxIdle(Uart*)
+{
+	FlushRxDma();
+}
+
 #else /* LIBSC_USE_UART */
 
 struct UartDevice::RxBuffer
@@ -679,8 +1208,17 @@ bool UartDevice::SendStr(string&&) { return false; }
 bool UartDevice::SendBuffer(const Byte*, const size_t) { return false; }
 bool UartDevice::SendBuffer(unique_ptr<Byte[]>&&, const size_t) { return false; }
 bool UartDevice::SendBuffer(vector<Byte>&&) { return false; }
+bool UartDevice::SendBuffer(const Byte*, const size_t, const uint8_t)
+{
+	return false;
+}
+bool UartDevice::SendBufferNoCopy(const Byte*, const size_t) { return false; }
+Byte* UartDevice::ReserveTx(const size_t) { return nullptr; }
+void UartDevice::CommitTx(const size_t) {}
 bool UartDevice::PeekChar(char*) { return false; }
 void UartDevice::SetRxIsr(const OnReceiveListener&) {}
+UartDevice::TxStats UartDevice::GetTxStats() const { return {}; }
+void UartDevice::ResetTxStats() {}
 
 #endif /* LIBSC_USE_UART */
 
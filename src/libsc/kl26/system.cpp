@@ -6,9 +6,13 @@
  * Refer to LICENSE for details
  */
 
+#include "libbase/kl26/hardware.h"
+
 #include <cassert>
 #include <cstdint>
 
+#include "libbase/kl26/clock_utils.h"
+
 #include "libsc/config.h"
 #include "libsc/kl26/lptmr_timer.h"
 #include "libsc/system.h"
@@ -24,10 +28,45 @@ System::Impl *System::m_instance = nullptr;
 
 struct System::Impl
 {
+	Impl()
+			: ms_prev(0),
+			  ms_wrap(0)
+	{}
+
+	/**
+	 * Extend the 32-bit ms counter to 64-bit. There's no sub-ms timer
+	 * available (SysTick is occupied by SysTickDelay), wraps are detected
+	 * whenever the time is queried, i.e., at least once per ~49 days
+	 *
+	 * @return
+	 */
+	uint64_t GetTimeMs64();
+
 	SysTickDelay delay;
 	LptmrTimer timer;
+
+	uint32_t ms_prev;
+	uint32_t ms_wrap;
 };
 
+uint64_t System::Impl::GetTimeMs64()
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	const uint32_t ms = timer.Time();
+	if (ms < ms_prev)
+	{
+		++ms_wrap;
+	}
+	ms_prev = ms;
+	const uint32_t wrap = ms_wrap;
+	if (!primask)
+	{
+		__enable_irq();
+	}
+	return (static_cast<uint64_t>(wrap) << 32) | ms;
+}
+
 void System::Init()
 {
 	if (!m_instance)
@@ -60,4 +99,16 @@ Timer::TimerInt System::Time()
 	return m_instance->timer.Time();
 }
 
+uint64_t System::TimeUs()
+{
+	assert(m_instance);
+	return m_instance->GetTimeMs64() * 1000;
+}
+
+uint64_t System::TimeCycles()
+{
+	assert(m_instance);
+	return m_instance->GetTimeMs64() * ClockUtils::GetCoreTickPerMs();
+}
+
 }
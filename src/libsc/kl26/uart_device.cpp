@@ -487,6 +487,25 @@ bool UartDevice::SendStrLiteral(const char *str)
 	}
 }
 
+bool UartDevice::SendBufferNoCopy(const Byte *buf, const size_t len)
+{
+	if (len == 0)
+	{
+		return true;
+	}
+
+	if (m_tx_buf->PushBlock(TxBuffer::Block(const_cast<Byte*>(buf), len,
+			false)))
+	{
+		EnableTx();
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
 void UartDevice::OnTxEmpty(Uart *uart)
 {
 	TxBuffer::Block *block = m_tx_buf->GetActiveBlock();
@@ -567,6 +586,7 @@ bool UartDevice::SendStr(string&&) { return false; }
 bool UartDevice::SendBuffer(const Byte*, const size_t) { return false; }
 bool UartDevice::SendBuffer(unique_ptr<Byte[]>&&, const size_t) { return false; }
 bool UartDevice::SendBuffer(vector<Byte>&&) { return false; }
+bool UartDevice::SendBufferNoCopy(const Byte*, const size_t) { return false; }
 bool UartDevice::PeekChar(char*) { return false; }
 
 #endif /* LIBSC_USE_UART */
@@ -90,7 +90,7 @@ Gpo::Config GetDcConfig()
 }
 
 St7735r::St7735r(const Config &config)
-		: m_tx_buf(config.tx_buf_size),
+		: m_tx_buf_size(std::min<size_t>(config.tx_buf_size, kMaxTxBufSize)),
 		  m_is_tx_idle(true),
 		  m_buf_start(0),
 		  m_data_it(0),
@@ -260,6 +260,24 @@ inline void St7735r::DisableTx()
 	m_is_tx_idle = true;
 }
 
+void St7735r::Update()
+{
+	m_tx_done_buf.Consume(m_tx_done_buf.GetSize());
+}
+
+bool St7735r::PushCmd(unique_ptr<St7735rCmd> &&cmd)
+{
+	Update();
+	if (m_tx_buf.GetSize() >= m_tx_buf_size)
+	{
+		return false;
+	}
+	else
+	{
+		return m_tx_buf.Push(std::move(cmd));
+	}
+}
+
 void St7735r::FillColor(const uint16_t color)
 {
 	if (m_region.x >= kW || m_region.y >= kH)
@@ -267,7 +285,7 @@ void St7735r::FillColor(const uint16_t color)
 		return;
 	}
 
-	if (m_tx_buf.PushData(unique_ptr<St7735rCmd>(new St7735rFillColor(m_region,
+	if (PushCmd(unique_ptr<St7735rCmd>(new St7735rFillColor(m_region,
 			color))))
 	{
 		EnableTx();
@@ -288,7 +306,7 @@ void St7735r::FillGrayscalePixel(const uint8_t *pixel, const size_t length)
 
 	uint8_t *pixel_copy = new uint8_t[length];
 	memcpy(pixel_copy, pixel, length);
-	if (m_tx_buf.PushData(unique_ptr<St7735rCmd>(new St7735rFillGrayscalePixel(
+	if (PushCmd(unique_ptr<St7735rCmd>(new St7735rFillGrayscalePixel(
 			m_region, {pixel_copy, true}, length))))
 	{
 		EnableTx();
@@ -309,7 +327,7 @@ void St7735r::FillPixel(const uint16_t *pixel, const size_t length)
 
 	uint16_t *pixel_copy = new uint16_t[length];
 	memcpy(pixel_copy, pixel, sizeof(uint16_t) * length);
-	if (m_tx_buf.PushData(unique_ptr<St7735rCmd>(new St7735rFillPixel(m_region,
+	if (PushCmd(unique_ptr<St7735rCmd>(new St7735rFillPixel(m_region,
 			{pixel_copy, true}, length))))
 	{
 		EnableTx();
@@ -346,7 +364,7 @@ void St7735r::FillBits(const uint16_t color_t, const uint16_t color_f,
 			++byte_pos;
 		}
 	}
-	if (m_tx_buf.PushData(unique_ptr<St7735rCmd>(new St7735rFillBits(m_region,
+	if (PushCmd(unique_ptr<St7735rCmd>(new St7735rFillBits(m_region,
 			color_t, color_f, {data_copy, true}, length))))
 	{
 		EnableTx();
@@ -369,7 +387,7 @@ void St7735r::FillBits(const uint16_t color_t, const uint16_t color_f,
 	const size_t size = (bit_length + 7) / 8;
 	Byte *data_copy = new Byte[size];
 	memcpy(data_copy, data, size);
-	if (m_tx_buf.PushData(unique_ptr<St7735rCmd>(new St7735rFillBits(m_region,
+	if (PushCmd(unique_ptr<St7735rCmd>(new St7735rFillBits(m_region,
 			color_t, color_f, {data_copy, true}, bit_length))))
 	{
 		EnableTx();
@@ -395,7 +413,7 @@ void St7735r::Clear(const uint16_t color)
 
 void St7735r::SetInvertColor(const bool flag)
 {
-	if (m_tx_buf.PushData(unique_ptr<St7735rCmd>(new St7735rInvertColor(flag))))
+	if (PushCmd(unique_ptr<St7735rCmd>(new St7735rInvertColor(flag))))
 	{
 		EnableTx();
 		return;
@@ -439,7 +457,7 @@ void St7735r::OnTxComplete(SpiMaster *spi)
 	if (m_data_it >= m_data_size)
 	{
 		// Cache new data
-		unique_ptr<St7735rCmd> *cmd = m_tx_buf.GetActiveData();
+		unique_ptr<St7735rCmd> *cmd = m_tx_buf.Front();
 		size_t data_size = 0;
 		while (cmd && (data_size = (*cmd)->GetBytes(m_buf_start, sizeof(m_data),
 				m_data)) == 0)
@@ -448,7 +466,12 @@ void St7735r::OnTxComplete(SpiMaster *spi)
 			Byte cmd_code = (*cmd)->NextCmd();
 			if (cmd_code == ST7735R_NOP)
 			{
-				cmd = m_tx_buf.NextData();
+				// Never delete here, see m_tx_done_buf for why this always
+				// succeeds
+				unique_ptr<St7735rCmd> done = std::move(*cmd);
+				m_tx_buf.Pop();
+				m_tx_done_buf.Push(std::move(done));
+				cmd = m_tx_buf.Front();
 			}
 			else
 			{
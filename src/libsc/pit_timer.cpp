@@ -37,8 +37,9 @@ Pit::Config GetPitConfig(const uint8_t pit_channel,
 }
 
 PitTimer::PitTimer(const uint8_t pit_channel)
-		: m_pit(GetPitConfig(pit_channel, std::bind(&PitTimer::OnTick, this,
-				std::placeholders::_1))),
+		: m_pit(GetPitConfig(pit_channel,
+				Pit::OnPitTriggerListener::Bind<PitTimer,
+					&PitTimer::OnTick>(this))),
 		  m_ms(0)
 {}
 
@@ -11,9 +11,14 @@
 #include <functional>
 
 #include "libbase/helper.h"
+#include LIBBASE_H(hardware)
 #include LIBBASE_H(clock_utils)
 #include LIBBASE_H(sys_tick)
 
+#if MK60DZ10 || MK60D10 || MK60F15
+#include "libbase/k60/dwt.h"
+#endif
+
 #include "libsc/system.h"
 #include "libsc/sys_tick_timer.h"
 
@@ -49,7 +54,14 @@ SysTickTimer::SysTickTimer()
 #else
 		  m_125us(0)
 #endif
-{}
+{
+#if MK60DZ10 || MK60D10 || MK60F15
+	Dwt::EnableCycleCounter();
+	m_cycle_base = DWT->CYCCNT;
+	m_cycle_prev = m_cycle_base;
+	m_cycle_wrap = 0;
+#endif
+}
 
 void SysTickTimer::OnTick(SysTick*)
 {
@@ -58,6 +70,35 @@ void SysTickTimer::OnTick(SysTick*)
 #else
 	++m_125us;
 #endif
+
+#if MK60DZ10 || MK60D10 || MK60F15
+	const uint32_t cycle = DWT->CYCCNT;
+	if (cycle < m_cycle_prev)
+	{
+		++m_cycle_wrap;
+	}
+	m_cycle_prev = cycle;
+#endif
 }
 
+#if MK60DZ10 || MK60D10 || MK60F15
+uint64_t SysTickTimer::TimeCycles()
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	const uint32_t cycle = DWT->CYCCNT;
+	uint32_t wrap = m_cycle_wrap;
+	if (cycle < m_cycle_prev)
+	{
+		// Wrapped around after the last tick
+		++wrap;
+	}
+	if (!primask)
+	{
+		__enable_irq();
+	}
+	return ((static_cast<uint64_t>(wrap) << 32) | cycle) - m_cycle_base;
+}
+#endif
+
 }
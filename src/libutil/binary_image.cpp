@@ -0,0 +1,330 @@
+/*
+ * binary_image.cpp
+ * Bit-parallel kernels for 1bpp images
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+
+#include "libbase/misc_types.h"
+
+#include "libutil/binary_image.h"
+
+namespace libutil
+{
+
+namespace
+{
+
+constexpr Uint kWordBits = 32;
+
+inline Uint GetWordCount(const Uint w)
+{
+	return (w + kWordBits - 1) / kWordBits;
+}
+
+/**
+ * Return the mask of the pixels inside the image in word @a k of a row
+ */
+inline uint32_t GetValidMask(const Uint w, const Uint k)
+{
+	const Uint remain = w - k * kWordBits;
+	return (remain >= kWordBits) ? 0xFFFFFFFF : ~(0xFFFFFFFF >> remain);
+}
+
+/**
+ * Load word @a k of a row, the leftmost pixel being the MSB. Pixels beyond
+ * @a w are cleared
+ */
+inline uint32_t LoadWord(const Byte *row, const Uint w, const Uint k)
+{
+	const Byte *p = row + k * 4;
+	const Uint remain = w - k * kWordBits;
+	if (remain >= kWordBits)
+	{
+		// Compiles to a (possibly unaligned) LDR + REV
+		uint32_t word;
+		memcpy(&word, p, 4);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		return __builtin_bswap32(word);
+#else
+		return word;
+#endif
+	}
+
+	uint32_t word = 0;
+	for (Uint i = 0; i * 8 < remain; ++i)
+	{
+		word |= static_cast<uint32_t>(p[i]) << (24 - i * 8);
+	}
+	return word & GetValidMask(w, k);
+}
+
+/**
+ * Store word @a k of a row, the counterpart of LoadWord()
+ */
+inline void StoreWord(Byte *row, const Uint w, const Uint k, uint32_t word)
+{
+	Byte *p = row + k * 4;
+	const Uint remain = w - k * kWordBits;
+	if (remain >= kWordBits)
+	{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		word = __builtin_bswap32(word);
+#endif
+		memcpy(p, &word, 4);
+		return;
+	}
+
+	word &= GetValidMask(w, k);
+	for (Uint i = 0; i * 8 < remain; ++i)
+	{
+		p[i] = word >> (24 - i * 8);
+	}
+}
+
+/**
+ * SWAR population count. Cortex-M has no popcount instruction, and
+ * __builtin_popcount() would end up as a libgcc call
+ */
+inline Uint Popcount(uint32_t x)
+{
+	x = x - ((x >> 1) & 0x55555555);
+	x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+	x = (x + (x >> 4)) & 0x0F0F0F0F;
+	return (x * 0x01010101) >> 24;
+}
+
+template<bool kIsErode>
+void MorphH(const Byte *src, const Uint w, const Uint h, Byte *dst)
+{
+	const size_t row_bytes = BinaryImage::GetRowBytes(w);
+	const Uint words = GetWordCount(w);
+	for (Uint y = 0; y < h && w; ++y)
+	{
+		const Byte *s = src + y * row_bytes;
+		Byte *d = dst + y * row_bytes;
+		uint32_t prev = 0;
+		uint32_t curr = LoadWord(s, w, 0);
+		for (Uint k = 0; k < words; ++k)
+		{
+			const uint32_t next = (k + 1 < words) ? LoadWord(s, w, k + 1) : 0;
+			// Move the left/right neighbor of each pixel into its place
+			const uint32_t left = (curr >> 1) | (prev << 31);
+			const uint32_t right = (curr << 1) | (next >> 31);
+			StoreWord(d, w, k, kIsErode ? (curr & left & right)
+					: (curr | left | right));
+			prev = curr;
+			curr = next;
+		}
+	}
+}
+
+template<bool kIsErode>
+void MorphV(const Byte *src, const Uint w, const Uint h, Byte *dst)
+{
+	const size_t row_bytes = BinaryImage::GetRowBytes(w);
+	const Uint words = GetWordCount(w);
+	for (Uint y = 0; y < h; ++y)
+	{
+		const Byte *s = src + y * row_bytes;
+		const Byte *up = (y > 0) ? s - row_bytes : nullptr;
+		const Byte *down = (y + 1 < h) ? s + row_bytes : nullptr;
+		Byte *d = dst + y * row_bytes;
+		for (Uint k = 0; k < words; ++k)
+		{
+			const uint32_t u = up ? LoadWord(up, w, k) : 0;
+			const uint32_t c = LoadWord(s, w, k);
+			const uint32_t n = down ? LoadWord(down, w, k) : 0;
+			StoreWord(d, w, k, kIsErode ? (u & c & n) : (u | c | n));
+		}
+	}
+}
+
+}
+
+size_t BinaryImage::GetRuns(const Byte *row, const Uint w, Run *out_runs,
+		const size_t max_runs)
+{
+	size_t count = 0;
+	bool is_in_run = false;
+	Uint begin = 0;
+	const Uint words = GetWordCount(w);
+	for (Uint k = 0; k < words && count < max_runs; ++k)
+	{
+		const uint32_t word = LoadWord(row, w, k);
+		Uint bit = 0;
+		// Jump from one transition to the next with CLZ
+		while (bit < kWordBits)
+		{
+			const uint32_t rest = (is_in_run ? ~word : word) << bit;
+			if (!rest)
+			{
+				break;
+			}
+			bit += __builtin_clz(rest);
+			if (!is_in_run)
+			{
+				begin = k * kWordBits + bit;
+			}
+			else
+			{
+				out_runs[count].begin = begin;
+				out_runs[count].end = k * kWordBits + bit;
+				if (++count >= max_runs)
+				{
+					return count;
+				}
+			}
+			is_in_run = !is_in_run;
+		}
+	}
+
+	if (is_in_run && count < max_runs)
+	{
+		out_runs[count].begin = begin;
+		out_runs[count].end = w;
+		++count;
+	}
+	return count;
+}
+
+int BinaryImage::FindNext(const Byte *row, const Uint w, const Uint from,
+		const bool value)
+{
+	if (from >= w)
+	{
+		return -1;
+	}
+
+	const uint32_t flip = value ? 0 : 0xFFFFFFFF;
+	const Uint words = GetWordCount(w);
+	Uint k = from / kWordBits;
+	uint32_t word = (LoadWord(row, w, k) ^ flip)
+			& (0xFFFFFFFF >> (from % kWordBits));
+	while (!word)
+	{
+		if (++k >= words)
+		{
+			return -1;
+		}
+		word = LoadWord(row, w, k) ^ flip;
+	}
+	// Flipped padding bits could be found beyond the image
+	const Uint x = k * kWordBits + __builtin_clz(word);
+	return (x < w) ? static_cast<int>(x) : -1;
+}
+
+int BinaryImage::FindPrev(const Byte *row, const Uint w, const Uint from,
+		const bool value)
+{
+	if (!w)
+	{
+		return -1;
+	}
+
+	const Uint start = std::min<Uint>(from, w - 1);
+	const uint32_t flip = value ? 0 : 0xFFFFFFFF;
+	Uint k = start / kWordBits;
+	uint32_t word = (LoadWord(row, w, k) ^ flip)
+			& (0xFFFFFFFF << (kWordBits - 1 - start % kWordBits));
+	while (!word)
+	{
+		if (k-- == 0)
+		{
+			return -1;
+		}
+		word = LoadWord(row, w, k) ^ flip;
+	}
+	return k * kWordBits + kWordBits - 1 - __builtin_ctz(word);
+}
+
+void BinaryImage::ErodeH(const Byte *src, const Uint w, const Uint h,
+		Byte *dst)
+{
+	MorphH<true>(src, w, h, dst);
+}
+
+void BinaryImage::ErodeV(const Byte *src, const Uint w, const Uint h,
+		Byte *dst)
+{
+	MorphV<true>(src, w, h, dst);
+}
+
+void BinaryImage::DilateH(const Byte *src, const Uint w, const Uint h,
+		Byte *dst)
+{
+	MorphH<false>(src, w, h, dst);
+}
+
+void BinaryImage::DilateV(const Byte *src, const Uint w, const Uint h,
+		Byte *dst)
+{
+	MorphV<false>(src, w, h, dst);
+}
+
+Uint BinaryImage::CountRow(const Byte *row, const Uint w)
+{
+	Uint product = 0;
+	const Uint words = GetWordCount(w);
+	for (Uint k = 0; k < words; ++k)
+	{
+		product += Popcount(LoadWord(row, w, k));
+	}
+	return product;
+}
+
+void BinaryImage::CountRows(const Byte *data, const Uint w, const Uint h,
+		uint16_t *out_counts)
+{
+	const size_t row_bytes = GetRowBytes(w);
+	for (Uint y = 0; y < h; ++y)
+	{
+		out_counts[y] = CountRow(data + y * row_bytes, w);
+	}
+}
+
+void BinaryImage::ProjectColumns(const Byte *data, const Uint w, const Uint h,
+		uint16_t *out_counts)
+{
+	assert(h <= UINT16_MAX);
+	const size_t row_bytes = GetRowBytes(w);
+	const Uint words = GetWordCount(w);
+	const Uint plane_count = h ? kWordBits - __builtin_clz(h) : 0;
+	for (Uint k = 0; k < words; ++k)
+	{
+		// Bit p of the count of column i is bit (31 - i) of planes[p]
+		uint32_t planes[16] = {};
+		for (Uint y = 0; y < h; ++y)
+		{
+			uint32_t carry = LoadWord(data + y * row_bytes, w, k);
+			for (Uint p = 0; carry; ++p)
+			{
+				const uint32_t next_carry = planes[p] & carry;
+				planes[p] ^= carry;
+				carry = next_carry;
+			}
+		}
+
+		const Uint cols = std::min<Uint>(kWordBits, w - k * kWordBits);
+		for (Uint i = 0; i < cols; ++i)
+		{
+			uint16_t count = 0;
+			for (Uint p = 0; p < plane_count; ++p)
+			{
+				count |= ((planes[p] >> (kWordBits - 1 - i)) & 1) << p;
+			}
+			out_counts[k * kWordBits + i] = count;
+		}
+	}
+}
+
+}
@@ -0,0 +1,140 @@
+/*
+ * byte_ring_buffer.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+
+#include "libbase/misc_types.h"
+
+#include "libutil/byte_ring_buffer.h"
+
+namespace libutil
+{
+
+ByteRingBuffer::ByteRingBuffer(const size_t capacity)
+		: m_capacity(capacity),
+		  m_data(new Byte[capacity]),
+		  m_read(0),
+		  m_write(0),
+		  m_watermark(capacity),
+		  m_reserve_beg(0),
+		  m_reserve_size(0)
+{}
+
+Byte* ByteRingBuffer::Reserve(const size_t size)
+{
+	m_reserve_size = 0;
+	if (size == 0)
+	{
+		return nullptr;
+	}
+
+	const size_t read = m_read;
+	const size_t write = m_write;
+	if (write >= read)
+	{
+		if (m_capacity - write >= size)
+		{
+			m_reserve_beg = write;
+		}
+		// Wrap around, but never let m_write catch up with m_read
+		else if (read > size)
+		{
+			m_reserve_beg = 0;
+		}
+		else
+		{
+			return nullptr;
+		}
+	}
+	else if (read - write > size)
+	{
+		m_reserve_beg = write;
+	}
+	else
+	{
+		return nullptr;
+	}
+
+	m_reserve_size = size;
+	return m_data.get() + m_reserve_beg;
+}
+
+void ByteRingBuffer::Commit(const size_t size)
+{
+	assert(size <= m_reserve_size);
+	if (size == 0 || m_reserve_size == 0)
+	{
+		m_reserve_size = 0;
+		return;
+	}
+
+	// Data must land in memory before the consumer could see the new index
+	std::atomic_signal_fence(std::memory_order_release);
+	if (m_reserve_beg == 0 && m_write != 0)
+	{
+		m_watermark = m_write;
+		std::atomic_signal_fence(std::memory_order_release);
+	}
+	m_write = m_reserve_beg + size;
+	m_reserve_size = 0;
+}
+
+const Byte* ByteRingBuffer::GetReadable(size_t *out_size)
+{
+	size_t read = m_read;
+	const size_t write = m_write;
+	std::atomic_signal_fence(std::memory_order_acquire);
+	if (read > write && read >= m_watermark)
+	{
+		// Producer has wrapped around and the tail is drained
+		read = 0;
+		m_read = 0;
+	}
+
+	if (read == write)
+	{
+		*out_size = 0;
+		return nullptr;
+	}
+	else if (read < write)
+	{
+		*out_size = write - read;
+	}
+	else
+	{
+		*out_size = m_watermark - read;
+	}
+	return m_data.get() + read;
+}
+
+void ByteRingBuffer::Consume(const size_t size)
+{
+	std::atomic_signal_fence(std::memory_order_release);
+	m_read = m_read + size;
+}
+
+size_t ByteRingBuffer::GetSize() const
+{
+	const size_t read = m_read;
+	const size_t write = m_write;
+	if (write >= read)
+	{
+		return write - read;
+	}
+	else
+	{
+		return m_watermark - read + write;
+	}
+}
+
+}
@@ -0,0 +1,304 @@
+/*
+ * camera_codec.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <memory>
+#include <vector>
+
+#include "libbase/misc_types.h"
+
+#include "libutil/camera_codec.h"
+#include "libutil/varint_utils.h"
+
+#define FLAG_GRAY8 0x1
+#define FLAG_KEY_FRAME 0x2
+
+namespace libutil
+{
+
+CameraCodec::Encoder::Encoder(const Config &config)
+		: m_width(config.width),
+		  m_height(config.height),
+		  m_format(config.format),
+		  m_key_frame_interval(config.key_frame_interval),
+		  m_is_xor(config.is_xor),
+		  m_stride(GetStride(config.width, config.format)),
+		  m_out(new Byte[GetMaxEncodedSize()]),
+		  m_seq(0),
+		  m_is_key_requested(true)
+{
+	if (m_is_xor)
+	{
+		m_prev.reset(new Byte[m_stride * m_height]);
+		m_row.reset(new Byte[m_stride]);
+		m_tmp.reset(new Byte[m_stride]);
+	}
+}
+
+size_t CameraCodec::Encoder::GetMaxEncodedSize() const
+{
+	// Rows are sent raw if compression doesn't help
+	return VarintUtils::kMaxSize * 3 + 1 + (1 + m_stride) * m_height;
+}
+
+const Byte* CameraCodec::Encoder::Encode(const Byte *frame, size_t *out_size)
+{
+	const bool is_key = (m_is_key_requested || !m_is_xor
+			|| (m_key_frame_interval && m_seq % m_key_frame_interval == 0));
+	m_is_key_requested = false;
+
+	Byte *it = m_out.get();
+	it += VarintUtils::Encode(m_seq, it);
+	it += VarintUtils::Encode(m_width, it);
+	it += VarintUtils::Encode(m_height, it);
+	*it++ = ((m_format == Format::kGray8) ? FLAG_GRAY8 : 0)
+			| (is_key ? FLAG_KEY_FRAME : 0);
+
+	for (Uint y = 0; y < m_height; ++y)
+	{
+		const Byte *row = frame + y * m_stride;
+		Byte *mode = it++;
+		// Compressed rows must beat the raw one
+		size_t size = PackBits(row, m_stride, it, m_stride - 1);
+		*mode = static_cast<Byte>(RowMode::kRle);
+		if (!is_key)
+		{
+			const Byte *prev = m_prev.get() + y * m_stride;
+			for (size_t x = 0; x < m_stride; ++x)
+			{
+				m_row[x] = row[x] ^ prev[x];
+			}
+			const size_t xor_size = PackBits(m_row.get(), m_stride,
+					m_tmp.get(), (size ? size : m_stride) - 1);
+			if (xor_size)
+			{
+				memcpy(it, m_tmp.get(), xor_size);
+				size = xor_size;
+				*mode = static_cast<Byte>(RowMode::kXorRle);
+			}
+		}
+		if (!size)
+		{
+			memcpy(it, row, m_stride);
+			size = m_stride;
+			*mode = static_cast<Byte>(RowMode::kRaw);
+		}
+		it += size;
+	}
+
+	if (m_is_xor)
+	{
+		memcpy(m_prev.get(), frame, m_stride * m_height);
+	}
+	++m_seq;
+	*out_size = it - m_out.get();
+	return m_out.get();
+}
+
+CameraCodec::Decoder::Decoder()
+		: m_width(0),
+		  m_height(0),
+		  m_format(Format::kBinary),
+		  m_seq(0),
+		  m_is_valid(false),
+		  m_dropped_count(0)
+{}
+
+bool CameraCodec::Decoder::Decode(const Byte *data, const size_t size)
+{
+	const Byte *it = data;
+	const Byte *end = data + size;
+	uint32_t header[3];
+	size_t read;
+	for (Uint i = 0; i < 3; ++i)
+	{
+		if (!(read = VarintUtils::Decode(it, end - it, &header[i])))
+		{
+			return false;
+		}
+		it += read;
+	}
+	if (it == end)
+	{
+		return false;
+	}
+	const uint32_t seq = header[0];
+	const uint32_t width = header[1];
+	const uint32_t height = header[2];
+	const Byte flags = *it++;
+	const Format format = (flags & FLAG_GRAY8) ? Format::kGray8
+			: Format::kBinary;
+	const bool is_key = flags & FLAG_KEY_FRAME;
+
+	// Distance from the last frame, with wrap around. A repeated or older
+	// seq (e.g., the encoder restarted) means a resync instead of drops
+	const uint32_t seq_diff = seq - m_seq;
+	if (m_is_valid && seq_diff > 1 && seq_diff <= kMaxSeqGap)
+	{
+		m_dropped_count += seq_diff - 1;
+	}
+	if (!is_key && (!m_is_valid || seq != m_seq + 1))
+	{
+		m_is_valid = false;
+		return false;
+	}
+
+	if (width != m_width || height != m_height || format != m_format)
+	{
+		m_width = width;
+		m_height = height;
+		m_format = format;
+		m_frame.resize(GetStride(m_width, m_format) * m_height);
+		m_row.resize(GetStride(m_width, m_format));
+	}
+	m_seq = seq;
+	// Would only be valid again once fully decoded
+	m_is_valid = false;
+
+	const size_t stride = GetStride(m_width, m_format);
+	for (Uint y = 0; y < m_height; ++y)
+	{
+		Byte *row = m_frame.data() + y * stride;
+		if (it == end)
+		{
+			return false;
+		}
+		const RowMode mode = static_cast<RowMode>(*it++);
+		switch (mode)
+		{
+		case RowMode::kRaw:
+			if ((size_t)(end - it) < stride)
+			{
+				return false;
+			}
+			memcpy(row, it, stride);
+			it += stride;
+			break;
+
+		case RowMode::kRle:
+			if (!(read = UnpackBits(it, end - it, row, stride)))
+			{
+				return false;
+			}
+			it += read;
+			break;
+
+		case RowMode::kXorRle:
+			if (is_key || !(read = UnpackBits(it, end - it, m_row.data(),
+					stride)))
+			{
+				return false;
+			}
+			it += read;
+			for (size_t x = 0; x < stride; ++x)
+			{
+				row[x] ^= m_row[x];
+			}
+			break;
+
+		default:
+			return false;
+		}
+	}
+
+	m_is_valid = (it == end);
+	return m_is_valid;
+}
+
+size_t CameraCodec::PackBits(const Byte *data, const size_t size, Byte *out,
+		const size_t out_limit)
+{
+	size_t i = 0;
+	size_t o = 0;
+	while (i < size)
+	{
+		size_t run = 1;
+		while (i + run < size && run < 128 && data[i + run] == data[i])
+		{
+			++run;
+		}
+
+		if (run >= 3)
+		{
+			// Repeat the next byte 1 - n times
+			if (o + 2 > out_limit)
+			{
+				return 0;
+			}
+			out[o++] = static_cast<Byte>(1 - (int)run);
+			out[o++] = data[i];
+			i += run;
+		}
+		else
+		{
+			// Literal bytes until the next run begins
+			const size_t beg = i;
+			size_t len = 0;
+			while (i < size && len < 128)
+			{
+				if (i + 2 < size && data[i] == data[i + 1]
+						&& data[i] == data[i + 2])
+				{
+					break;
+				}
+				++i;
+				++len;
+			}
+			if (o + 1 + len > out_limit)
+			{
+				return 0;
+			}
+			out[o++] = static_cast<Byte>(len - 1);
+			memcpy(out + o, data + beg, len);
+			o += len;
+		}
+	}
+	return o;
+}
+
+size_t CameraCodec::UnpackBits(const Byte *data, const size_t size, Byte *out,
+		const size_t out_size)
+{
+	size_t i = 0;
+	size_t o = 0;
+	while (o < out_size)
+	{
+		if (i == size)
+		{
+			return 0;
+		}
+		const int8_t header = static_cast<int8_t>(data[i++]);
+		if (header >= 0)
+		{
+			const size_t len = header + 1;
+			if (o + len > out_size || i + len > size)
+			{
+				return 0;
+			}
+			memcpy(out + o, data + i, len);
+			i += len;
+			o += len;
+		}
+		else if (header != -128)
+		{
+			const size_t len = 1 - header;
+			if (o + len > out_size || i == size)
+			{
+				return 0;
+			}
+			memset(out + o, data[i++], len);
+			o += len;
+		}
+	}
+	return i;
+}
+
+}
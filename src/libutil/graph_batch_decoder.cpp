@@ -0,0 +1,136 @@
+/*
+ * graph_batch_decoder.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <functional>
+
+#include "libbase/misc_types.h"
+
+#include "libutil/graph_batch_decoder.h"
+#include "libutil/varint_utils.h"
+
+namespace libutil
+{
+
+namespace
+{
+
+class Reader
+{
+public:
+	Reader(const Byte *data, const size_t size)
+			: m_it(data),
+			  m_end(data + size)
+	{}
+
+	bool ReadVarint(uint32_t *out_value)
+	{
+		const size_t size = VarintUtils::Decode(m_it, m_end - m_it, out_value);
+		m_it += size;
+		return (size != 0);
+	}
+
+	bool ReadByte(Byte *out_value)
+	{
+		if (m_it == m_end)
+		{
+			return false;
+		}
+		*out_value = *m_it++;
+		return true;
+	}
+
+	bool ReadBe32(uint32_t *out_value)
+	{
+		if (m_end - m_it < 4)
+		{
+			return false;
+		}
+		*out_value = (uint32_t)m_it[0] << 24 | (uint32_t)m_it[1] << 16
+				| (uint32_t)m_it[2] << 8 | m_it[3];
+		m_it += 4;
+		return true;
+	}
+
+	bool IsEnd() const
+	{
+		return (m_it == m_end);
+	}
+
+private:
+	const Byte *m_it;
+	const Byte *m_end;
+};
+
+}
+
+bool GraphBatchDecoder::Decode(const Byte *data, const size_t size,
+		const OnSampleListener &listener)
+{
+	Reader reader(data, size);
+	uint32_t base_time, channel_count;
+	if (!reader.ReadVarint(&base_time) || !reader.ReadVarint(&channel_count))
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < channel_count; ++i)
+	{
+		Byte id, type;
+		uint32_t count, first_time, span;
+		if (!reader.ReadByte(&id) || !reader.ReadByte(&type)
+				|| !reader.ReadVarint(&count) || !reader.ReadVarint(&first_time)
+				|| !reader.ReadVarint(&span))
+		{
+			return false;
+		}
+		if (type > static_cast<Byte>(Sample::Type::kFloat))
+		{
+			return false;
+		}
+
+		Sample sample;
+		sample.id = id;
+		sample.type = static_cast<Sample::Type>(type);
+		uint32_t value = 0;
+		for (uint32_t j = 0; j < count; ++j)
+		{
+			if (sample.type == Sample::Type::kInt)
+			{
+				uint32_t delta;
+				if (!reader.ReadVarint(&delta))
+				{
+					return false;
+				}
+				// Deltas are calculated with wrap around
+				value += (uint32_t)VarintUtils::ZigzagDecode(delta);
+				sample.value.i = (int32_t)value;
+			}
+			else
+			{
+				if (!reader.ReadBe32(&value))
+				{
+					return false;
+				}
+				memcpy(&sample.value.f, &value, 4);
+			}
+			sample.time = base_time + first_time + ((count > 1)
+					? (uint32_t)((uint64_t)span * j / (count - 1)) : 0);
+			if (listener)
+			{
+				listener(sample);
+			}
+		}
+	}
+	return reader.IsEnd();
+}
+
+}
@@ -0,0 +1,441 @@
+/*
+ * gray_image.cpp
+ * Kernels for 8-bit grayscale images
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+
+#include "libbase/misc_types.h"
+
+#include "libutil/binary_image.h"
+#include "libutil/gray_image.h"
+
+#if LIBUTIL_GRAY_SIMD && defined(__ARM_FEATURE_SIMD32) && __ARM_FEATURE_SIMD32
+#include "libbase/k60/hardware.h"
+#define LIBUTIL_GRAY_NATIVE_SIMD 1
+#else
+#define LIBUTIL_GRAY_NATIVE_SIMD 0
+#endif
+
+namespace libutil
+{
+
+namespace
+{
+
+inline uint32_t Load32(const Byte *p)
+{
+	// Compiles to a (possibly unaligned) LDR
+	uint32_t word;
+	memcpy(&word, p, 4);
+	return word;
+}
+
+inline void Store32(Byte *p, const uint32_t word)
+{
+	memcpy(p, &word, 4);
+}
+
+#if LIBUTIL_GRAY_SIMD
+/*
+ * Thin wrappers of the SIMD instructions. Off target they are emulated with
+ * the exact same semantics, such that the code below could be verified on PC.
+ * Lanes are little-endian, i.e., byte 0 is the pixel with the lowest address
+ */
+
+/// Zero extend bytes 0 and 2 into two 16-bit lanes
+inline uint32_t Uxtb16(const uint32_t x)
+{
+#if LIBUTIL_GRAY_NATIVE_SIMD
+	return __UXTB16(x);
+#else
+	return x & 0x00FF00FF;
+#endif
+}
+
+/// Unsigned saturating subtraction of each 8-bit lane
+inline uint32_t Uqsub8(const uint32_t a, const uint32_t b)
+{
+#if LIBUTIL_GRAY_NATIVE_SIMD
+	return __UQSUB8(a, b);
+#else
+	uint32_t product = 0;
+	for (int i = 0; i < 32; i += 8)
+	{
+		const int d = static_cast<int>((a >> i) & 0xFF)
+				- static_cast<int>((b >> i) & 0xFF);
+		product |= static_cast<uint32_t>(std::max(d, 0)) << i;
+	}
+	return product;
+#endif
+}
+
+/// Unsigned saturating subtraction of each 16-bit lane
+inline uint32_t Uqsub16(const uint32_t a, const uint32_t b)
+{
+#if LIBUTIL_GRAY_NATIVE_SIMD
+	return __UQSUB16(a, b);
+#else
+	uint32_t product = 0;
+	for (int i = 0; i < 32; i += 16)
+	{
+		const int d = static_cast<int>((a >> i) & 0xFFFF)
+				- static_cast<int>((b >> i) & 0xFFFF);
+		product |= static_cast<uint32_t>(std::max(d, 0)) << i;
+	}
+	return product;
+#endif
+}
+
+/// Saturate each signed 16-bit lane to [0, 255]
+inline uint32_t Usat16To8(const uint32_t x)
+{
+#if LIBUTIL_GRAY_NATIVE_SIMD
+	return __USAT16(x, 8);
+#else
+	uint32_t product = 0;
+	for (int i = 0; i < 32; i += 16)
+	{
+		const int v = static_cast<int16_t>((x >> i) & 0xFFFF);
+		product |= static_cast<uint32_t>(std::min(std::max(v, 0), 255)) << i;
+	}
+	return product;
+#endif
+}
+
+/// Add the sum of absolute differences of the 8-bit lanes to @a acc
+inline uint32_t Usada8(const uint32_t a, const uint32_t b, const uint32_t acc)
+{
+#if LIBUTIL_GRAY_NATIVE_SIMD
+	return __USADA8(a, b, acc);
+#else
+	uint32_t product = acc;
+	for (int i = 0; i < 32; i += 8)
+	{
+		product += abs(static_cast<int>((a >> i) & 0xFF)
+				- static_cast<int>((b >> i) & 0xFF));
+	}
+	return product;
+#endif
+}
+
+/**
+ * Pick each 8-bit lane from @a x if the one in @a a >= @a b, otherwise from
+ * @a y. On target, USUB8 sets the GE flags consumed by SEL right after
+ */
+inline uint32_t SelectGe8(const uint32_t a, const uint32_t b,
+		const uint32_t x, const uint32_t y)
+{
+#if LIBUTIL_GRAY_NATIVE_SIMD
+	__USUB8(a, b);
+	return __SEL(x, y);
+#else
+	uint32_t product = 0;
+	for (int i = 0; i < 32; i += 8)
+	{
+		const bool is_ge = (((a >> i) & 0xFF) >= ((b >> i) & 0xFF));
+		product |= (((is_ge ? x : y) >> i) & 0xFF) << i;
+	}
+	return product;
+#endif
+}
+
+/// Rounded division by 9, exact for 0 <= x <= 2295 (9 * 255)
+inline uint32_t Div9(const uint32_t x)
+{
+	return ((x + 4) * 7282) >> 16;
+}
+#endif
+
+}
+
+void GrayImage::Histogram(const Byte *data, const size_t size,
+		uint32_t *out_hist)
+{
+	memset(out_hist, 0, 256 * sizeof(uint32_t));
+	// There's nothing to vectorize, but loading a word at a time still saves
+	// 3 loads per 4 pixels
+	size_t i = 0;
+	for (; i + 4 <= size; i += 4)
+	{
+		const uint32_t word = Load32(data + i);
+		++out_hist[word & 0xFF];
+		++out_hist[(word >> 8) & 0xFF];
+		++out_hist[(word >> 16) & 0xFF];
+		++out_hist[word >> 24];
+	}
+	for (; i < size; ++i)
+	{
+		++out_hist[data[i]];
+	}
+}
+
+uint8_t GrayImage::OtsuThreshold(const uint32_t *hist)
+{
+	uint64_t total = 0;
+	uint64_t sum = 0;
+	for (Uint i = 0; i < 256; ++i)
+	{
+		total += hist[i];
+		sum += static_cast<uint64_t>(i) * hist[i];
+	}
+	if (!total)
+	{
+		return 0;
+	}
+
+	// The between-class variance is proportional to d^2 / (w0 * w1), where
+	// d = sum * w0 - sum0 * total < 2^(8 + 2 * bits(total)). d is shifted
+	// such that d^2 fits in 64 bits
+	Uint total_bits = 0;
+	while (total >> total_bits)
+	{
+		++total_bits;
+	}
+	const Uint shift = std::max<int>(static_cast<int>(8 + 2 * total_bits) - 32,
+			0);
+
+	uint8_t product = 0;
+	uint64_t best_score = 0;
+	uint64_t w0 = 0;
+	uint64_t sum0 = 0;
+	for (Uint t = 0; t < 255; ++t)
+	{
+		w0 += hist[t];
+		sum0 += static_cast<uint64_t>(t) * hist[t];
+		const uint64_t w1 = total - w0;
+		if (!w0)
+		{
+			continue;
+		}
+		else if (!w1)
+		{
+			break;
+		}
+
+		const uint64_t a = sum * w0;
+		const uint64_t b = sum0 * total;
+		const uint64_t d = ((a > b) ? a - b : b - a) >> shift;
+		const uint64_t score = d * d / (w0 * w1);
+		if (score > best_score)
+		{
+			best_score = score;
+			product = t;
+		}
+	}
+	return product;
+}
+
+void GrayImage::Binarize(const Byte *src, const Uint w, const Uint h,
+		const uint8_t threshold, Byte *dst)
+{
+	const size_t row_bytes = BinaryImage::GetRowBytes(w);
+	memset(dst, 0, row_bytes * h);
+	for (Uint y = 0; y < h; ++y)
+	{
+		const Byte *s = src + y * w;
+		Byte *d = dst + y * row_bytes;
+		Uint x = 0;
+#if LIBUTIL_GRAY_SIMD
+		const uint32_t thresholds = threshold * 0x01010101u;
+		for (; x + 8 <= w; x += 8)
+		{
+			// Tag each dark pixel with its bit in the output nibble, then sum
+			// the 4 tags up with a multiplication
+			const uint32_t lo = SelectGe8(thresholds, Load32(s + x),
+					0x01020408, 0);
+			const uint32_t hi = SelectGe8(thresholds, Load32(s + x + 4),
+					0x01020408, 0);
+			d[x / 8] = (((lo * 0x01010101) >> 24) << 4)
+					| ((hi * 0x01010101) >> 24);
+		}
+#endif
+		for (; x < w; ++x)
+		{
+			if (s[x] <= threshold)
+			{
+				d[x / 8] |= 0x80 >> (x % 8);
+			}
+		}
+	}
+}
+
+void GrayImage::Sobel(const Byte *src, const Uint w, const Uint h, Byte *dst)
+{
+	memset(dst, 0, w * h);
+	if (w < 3 || h < 3)
+	{
+		return;
+	}
+
+	for (Uint y = 1; y + 1 < h; ++y)
+	{
+		const Byte *t = src + (y - 1) * w;
+		const Byte *m = t + w;
+		const Byte *b = m + w;
+		Byte *d = dst + y * w;
+		Uint x = 1;
+#if LIBUTIL_GRAY_SIMD
+		// 4 pixels at a time, even and odd ones are widened into two pairs of
+		// 16-bit lanes. Lanes never exceed 2040, so plain additions work
+		for (; x + 5 <= w; x += 4)
+		{
+			const uint32_t tl = Load32(t + x - 1);
+			const uint32_t tc = Load32(t + x);
+			const uint32_t tr = Load32(t + x + 1);
+			const uint32_t ml = Load32(m + x - 1);
+			const uint32_t mr = Load32(m + x + 1);
+			const uint32_t bl = Load32(b + x - 1);
+			const uint32_t bc = Load32(b + x);
+			const uint32_t br = Load32(b + x + 1);
+
+			uint32_t mags[2];
+			for (Uint i = 0; i < 2; ++i)
+			{
+				const Uint sh = i * 8;
+				const uint32_t tl_ = Uxtb16(tl >> sh);
+				const uint32_t tr_ = Uxtb16(tr >> sh);
+				const uint32_t bl_ = Uxtb16(bl >> sh);
+				const uint32_t br_ = Uxtb16(br >> sh);
+
+				const uint32_t left = tl_ + 2 * Uxtb16(ml >> sh) + bl_;
+				const uint32_t right = tr_ + 2 * Uxtb16(mr >> sh) + br_;
+				const uint32_t top = tl_ + 2 * Uxtb16(tc >> sh) + tr_;
+				const uint32_t bottom = bl_ + 2 * Uxtb16(bc >> sh) + br_;
+				// |a - b| = sat(a - b) | sat(b - a)
+				const uint32_t gx = Uqsub16(right, left) | Uqsub16(left, right);
+				const uint32_t gy = Uqsub16(bottom, top) | Uqsub16(top, bottom);
+				mags[i] = Usat16To8(gx + gy);
+			}
+			Store32(d + x, mags[0] | (mags[1] << 8));
+		}
+#endif
+		for (; x + 1 < w; ++x)
+		{
+			const int gx = (t[x + 1] + 2 * m[x + 1] + b[x + 1])
+					- (t[x - 1] + 2 * m[x - 1] + b[x - 1]);
+			const int gy = (b[x - 1] + 2 * b[x] + b[x + 1])
+					- (t[x - 1] + 2 * t[x] + t[x + 1]);
+			d[x] = std::min(abs(gx) + abs(gy), 255);
+		}
+	}
+}
+
+void GrayImage::BoxBlur(const Byte *src, const Uint w, const Uint h,
+		Byte *dst)
+{
+	memcpy(dst, src, w * h);
+	if (w < 3 || h < 3)
+	{
+		return;
+	}
+
+	for (Uint y = 1; y + 1 < h; ++y)
+	{
+		const Byte *t = src + (y - 1) * w;
+		const Byte *m = t + w;
+		const Byte *b = m + w;
+		Byte *d = dst + y * w;
+		Uint x = 1;
+#if LIBUTIL_GRAY_SIMD
+		for (; x + 5 <= w; x += 4)
+		{
+			const uint32_t words[9] = {Load32(t + x - 1), Load32(t + x),
+					Load32(t + x + 1), Load32(m + x - 1), Load32(m + x),
+					Load32(m + x + 1), Load32(b + x - 1), Load32(b + x),
+					Load32(b + x + 1)};
+			// Sums of even and odd pixels, in two pairs of 16-bit lanes
+			uint32_t even = 0;
+			uint32_t odd = 0;
+			for (Uint i = 0; i < 9; ++i)
+			{
+				even += Uxtb16(words[i]);
+				odd += Uxtb16(words[i] >> 8);
+			}
+			Store32(d + x, Div9(even & 0xFFFF) | (Div9(odd & 0xFFFF) << 8)
+					| (Div9(even >> 16) << 16) | (Div9(odd >> 16) << 24));
+		}
+#endif
+		for (; x + 1 < w; ++x)
+		{
+			const Uint sum = t[x - 1] + t[x] + t[x + 1] + m[x - 1] + m[x]
+					+ m[x + 1] + b[x - 1] + b[x] + b[x + 1];
+			d[x] = (sum + 4) / 9;
+		}
+	}
+}
+
+uint32_t GrayImage::AbsDiff(const Byte *a, const Byte *b, const size_t size,
+		Byte *dst)
+{
+	uint32_t product = 0;
+	size_t i = 0;
+#if LIBUTIL_GRAY_SIMD
+	for (; i + 4 <= size; i += 4)
+	{
+		const uint32_t wa = Load32(a + i);
+		const uint32_t wb = Load32(b + i);
+		product = Usada8(wa, wb, product);
+		if (dst)
+		{
+			Store32(dst + i, Uqsub8(wa, wb) | Uqsub8(wb, wa));
+		}
+	}
+#endif
+	for (; i < size; ++i)
+	{
+		const Byte diff = abs(a[i] - b[i]);
+		product += diff;
+		if (dst)
+		{
+			dst[i] = diff;
+		}
+	}
+	return product;
+}
+
+void GrayImage::Downscale2x(const Byte *src, const Uint w, const Uint h,
+		Byte *dst)
+{
+	const Uint dst_w = w / 2;
+	for (Uint y = 0; y < h / 2; ++y)
+	{
+		const Byte *s0 = src + y * 2 * w;
+		const Byte *s1 = s0 + w;
+		Byte *d = dst + y * dst_w;
+		Uint x = 0;
+#if LIBUTIL_GRAY_SIMD
+		for (; x + 4 <= dst_w; x += 4)
+		{
+			uint32_t halves[2];
+			for (Uint i = 0; i < 2; ++i)
+			{
+				const uint32_t u = Load32(s0 + x * 2 + i * 4);
+				const uint32_t v = Load32(s1 + x * 2 + i * 4);
+				// Two 2x2 sums (+ 2 for rounding) in 16-bit lanes
+				const uint32_t sum = Uxtb16(u) + Uxtb16(u >> 8) + Uxtb16(v)
+						+ Uxtb16(v >> 8) + 0x00020002;
+				const uint32_t mean = (sum >> 2) & 0x00FF00FF;
+				halves[i] = (mean & 0xFF) | ((mean >> 8) & 0xFF00);
+			}
+			Store32(d + x, halves[0] | (halves[1] << 16));
+		}
+#endif
+		for (; x < dst_w; ++x)
+		{
+			d[x] = (s0[x * 2] + s0[x * 2 + 1] + s1[x * 2] + s1[x * 2 + 1] + 2)
+					>> 2;
+		}
+	}
+}
+
+}
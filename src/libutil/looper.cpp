@@ -6,12 +6,30 @@
  * Refer to LICENSE for details
  */
 
-#include <functional>
-#include <list>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <memory>
+
+#include "libbase/misc_types.h"
+
+#if MK60D10 || MK60DZ10 || MK60F15
+#include "libbase/k60/hardware.h"
+#include "libbase/k60/dwt.h"
+#include "libsc/k60/uart_device.h"
+
+#elif MKL26Z4
+#include "libsc/kl26/uart_device.h"
+
+#endif
 
 #include "libsc/system.h"
 #include "libsc/timer.h"
+#include "libutil/crc_utils.h"
+#include "libutil/endian_utils.h"
 #include "libutil/looper.h"
+#include "libutil/task_scheduler.h"
 
 using namespace libsc;
 using namespace std;
@@ -19,16 +37,68 @@ using namespace std;
 namespace libutil
 {
 
-struct Looper::RunnerState
+namespace
+{
+
+uint32_t GetSystemTime()
+{
+#if (MK60DZ10 || MK60D10 || MK60F15) && defined(USE_TIME_IN_125US)
+	return System::TimeIn125us();
+#else
+	// Only ms resolution available
+	return System::Time() << 3;
+#endif
+}
+
+#if LIBUTIL_TASK_PROFILE && (MK60D10 || MK60DZ10 || MK60F15)
+uint32_t GetCycle()
+{
+	return DWT->CYCCNT;
+}
+
+#endif
+
+#if LIBUTIL_TASK_PROFILE
+template<typename T>
+Byte* PutLe(const T value, Byte *it)
+{
+	const T le = EndianUtils::HostToLe(value);
+	memcpy(it, &le, sizeof(T));
+	return it + sizeof(T);
+}
+
+Byte* PutLe64(const uint64_t value, Byte *it)
 {
-	Timer::TimerInt request;
-	Timer::TimerInt start;
-	Callback callback;
-	Looper::RepeatMode mode;
-};
+	it = PutLe<uint32_t>(static_cast<uint32_t>(value), it);
+	return PutLe<uint32_t>(static_cast<uint32_t>(value >> 32), it);
+}
+
+#endif
+
+}
+
+Looper::Looper(const Config &config)
+		: m_scheduler(config.task_capacity),
+		  m_clock(config.clock ? config.clock : &GetSystemTime),
+		  m_prev(0),
+		  m_is_timing_init(false),
+		  m_is_run(true)
+{
+#if LIBUTIL_TASK_PROFILE
+	TaskScheduler::CycleCounter counter = config.cycle_counter;
+#if MK60D10 || MK60DZ10 || MK60F15
+	if (!counter)
+	{
+		libbase::k60::Dwt::EnableCycleCounter();
+		counter = &GetCycle;
+	}
+#endif
+	m_scheduler.SetCycleCounter(counter);
+#endif
+}
 
 Looper::Looper()
-		: m_is_run(true)
+		: Looper(Config())
 {}
 
 Looper::~Looper()
@@ -45,67 +115,101 @@ void Looper::Loop()
 
 void Looper::Once()
 {
-	const Timer::TimerInt now = System::Time();
+	if (!m_is_timing_init)
+	{
+		ResetTiming();
+	}
+	const uint32_t now = m_clock();
 	if (now != m_prev)
 	{
-		Invoke();
 		m_prev = now;
+		if (m_scheduler.IsDue(now))
+		{
+			m_scheduler.Run(now);
+		}
 	}
 }
 
-void Looper::Invoke()
+void Looper::Break()
 {
-	list<RunnerState>::iterator it = m_states.begin();
-	while (it != m_states.end())
+	m_is_run = false;
+}
+
+Looper::TaskId Looper::Repeat(const Timer::TimerInt ms, const Callback &c,
+		const RepeatMode mode, const uint8_t priority)
+{
+	return m_scheduler.Add(m_clock(), ms << 3, c, mode, priority, 3);
+}
+
+Looper::TaskId Looper::RepeatIn125us(const uint32_t period, const Callback &c,
+		const RepeatMode mode, const uint8_t priority)
+{
+	return m_scheduler.Add(m_clock(), period, c, mode, priority, 0);
+}
+
+bool Looper::Cancel(const TaskId id)
+{
+	return m_scheduler.Cancel(id);
+}
+
+bool Looper::SendStats(UartDevice *uart) const
+{
+#if LIBUTIL_TASK_PROFILE
+	static constexpr size_t kHeaderSize = 4 + 4 + 8 + 8;
+	static constexpr size_t kRecordSize = 4 * 6
+			+ 2 * TaskScheduler::kLatenessBuckets;
+
+	const size_t capacity = m_scheduler.GetCapacity();
+	const size_t size = kHeaderSize + kRecordSize * m_scheduler.GetSize() + 2;
+	unique_ptr<Byte[]> data(new Byte[size]);
+	Byte *it = data.get() + 4;
+
+	const TaskScheduler::RunStats run_stats = m_scheduler.GetRunStats();
+	it = PutLe<uint32_t>(run_stats.run_count, it);
+	it = PutLe64(run_stats.busy_cycles, it);
+	it = PutLe64(run_stats.elapsed_cycles, it);
+
+	uint8_t count = 0;
+	for (size_t i = 0; i < capacity && count < UINT8_MAX; ++i)
 	{
-		const Timer::TimerInt now = System::Time();
-		const Timer::TimerInt duration = Timer::TimeDiff(now, it->start);
-		if (duration >= it->request)
+		TaskId id;
+		TaskScheduler::TaskStats stats;
+		if (!m_scheduler.GetTaskStats(i, &id, &stats))
 		{
-			it->callback(it->request, duration);
-			switch (it->mode)
-			{
-			case RepeatMode::kOnce:
-				it = m_states.erase(it);
-				break;
-
-			case RepeatMode::kPrecise:
-				it->start += it->request;
-				++it;
-				break;
-
-			case RepeatMode::kLoose:
-				it->start = now;
-				++it;
-				break;
-			}
+			continue;
 		}
-		else
+		it = PutLe<int32_t>(id, it);
+		it = PutLe<uint32_t>(stats.count, it);
+		it = PutLe<uint32_t>(stats.count ? stats.min_cycles : 0, it);
+		it = PutLe<uint32_t>(stats.max_cycles, it);
+		it = PutLe<uint32_t>(stats.GetMeanCycles(), it);
+		it = PutLe<uint32_t>(stats.deadline_misses, it);
+		for (size_t j = 0; j < TaskScheduler::kLatenessBuckets; ++j)
 		{
-			++it;
+			it = PutLe<uint16_t>(stats.lateness_hist[j], it);
 		}
+		++count;
 	}
-}
 
-void Looper::Break()
-{
-	m_is_run = false;
-}
+	data[0] = 'L';
+	data[1] = 'P';
+	data[2] = 1;
+	data[3] = count;
+	const size_t crc_offset = it - data.get();
+	PutLe<uint16_t>(CrcUtils::Crc16(data.get(), crc_offset), it);
+	return uart->SendBuffer(std::move(data), crc_offset + 2);
 
-void Looper::Repeat(const Timer::TimerInt ms, const Callback &c,
-		const RepeatMode mode)
-{
-	RunnerState rs;
-	rs.request = ms;
-	rs.start = System::Time();
-	rs.callback = c;
-	rs.mode = mode;
-	m_states.push_back(std::move(rs));
+#else
+	(void)uart;
+	return false;
+
+#endif
 }
 
 void Looper::ResetTiming()
 {
-	m_prev = System::Time();
+	m_prev = m_clock();
+	m_is_timing_init = true;
 }
 
 }
@@ -9,6 +9,7 @@
 
 #include <cstdint>
 
+#include "libbase/deferred_log.h"
 #include "libbase/helper.h"
 #include "libbase/syscall.h"
 
@@ -61,4 +62,19 @@ void UninitDefaultFwriteHandler()
 	g_fwrite_handler = nullptr;
 }
 
+void DrainDeferredLog(UartDevice *uart)
+{
+	Byte buf[128];
+	size_t size;
+	while ((size = libbase::DeferredLog::Peek(buf, sizeof(buf))) > 0)
+	{
+		if (!uart->SendBuffer(buf, size))
+		{
+			// Keep them for the next call
+			break;
+		}
+		libbase::DeferredLog::Consume();
+	}
+}
+
 }
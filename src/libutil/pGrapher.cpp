@@ -10,6 +10,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <utility>
 
@@ -71,7 +72,11 @@ pGrapher::pGrapher(void)
 :
 	isStarted(false),
 	rx_threshold(7),
-	m_uart(get106UartConfig(0))
+	m_uart(get106UartConfig(0)),
+	isWatchLayoutDirty(true),
+	isSendChangedOnly(false),
+	isLastWatchDataValid(false),
+	watchDataSize(0)
 {
 	m_pd_instance = this;
 	System::Init();
@@ -100,6 +105,7 @@ bool pGrapher::listener(const Byte *data, const size_t size)
 			{
 			case 's':
 				m_pd_instance->isStarted = true;
+				m_pd_instance->isLastWatchDataValid = false;
 				break;
 
 			case 'e':
@@ -129,9 +135,75 @@ bool pGrapher::listener(const Byte *data, const size_t size)
 
 void pGrapher::sendWatchData(void)
 {
-	if (isStarted)
-		for (Byte i = 0; i < watchedObjMng.size(); i++)
-			m_uart.SendBuffer((Byte *)((ObjMng)watchedObjMng.at(i)).obj, ((ObjMng)watchedObjMng.at(i)).len);
+	if (!isStarted)
+		return;
+
+	if (isWatchLayoutDirty)
+		prepareWatchLayout();
+
+	if (isSendChangedOnly)
+	{
+		sendChangedWatchData();
+		return;
+	}
+
+	Byte *it = watchFrame.data();
+	for (const ObjMng &obj : watchedObjMng)
+	{
+		memcpy(it, obj.obj, obj.len);
+		it += obj.len;
+	}
+	m_uart.SendBuffer(watchFrame.data(), watchDataSize);
+}
+
+void pGrapher::sendChangedWatchData(void)
+{
+	// The full frames share the buffer and overwrite the header
+	watchFrame[0] = '*';
+	const size_t maskSize = (watchedObjMng.size() + 7) / 8;
+	Byte *mask = watchFrame.data() + 1;
+	memset(mask, 0, maskSize);
+
+	Byte *it = mask + maskSize;
+	for (size_t i = 0; i < watchedObjMng.size(); i++)
+	{
+		const ObjMng &obj = watchedObjMng[i];
+		Byte *last = lastWatchData.data() + watchOffsets[i];
+		if (isLastWatchDataValid && !memcmp(last, obj.obj, obj.len))
+			continue;
+
+		memcpy(last, obj.obj, obj.len);
+		memcpy(it, last, obj.len);
+		it += obj.len;
+		mask[i / 8] |= 1 << (i % 8);
+	}
+	isLastWatchDataValid = true;
+
+	if (it != mask + maskSize)
+		m_uart.SendBuffer(watchFrame.data(), it - watchFrame.data());
+}
+
+void pGrapher::setSendChangedOnly(const bool flag)
+{
+	isSendChangedOnly = flag;
+	isLastWatchDataValid = false;
+}
+
+void pGrapher::prepareWatchLayout(void)
+{
+	watchOffsets.resize(watchedObjMng.size());
+	watchDataSize = 0;
+	for (size_t i = 0; i < watchedObjMng.size(); i++)
+	{
+		watchOffsets[i] = watchDataSize;
+		watchDataSize += watchedObjMng[i].len;
+	}
+
+	// Large enough for both modes
+	watchFrame.resize(1 + (watchedObjMng.size() + 7) / 8 + watchDataSize);
+	lastWatchData.resize(watchDataSize);
+	isLastWatchDataValid = false;
+	isWatchLayoutDirty = false;
 }
 
 void pGrapher::sendWatchedVarInfo(void)
@@ -141,7 +213,7 @@ void pGrapher::sendWatchedVarInfo(void)
 	m_uart.SendBuffer((Byte *)&n, 1);
 	for (Byte i = 0; i < watchedObjMng.size(); i++)
 	{
-		ObjMng temp = watchedObjMng.at(i);
+		const ObjMng &temp = watchedObjMng[i];
 		m_uart.SendBuffer((Byte *)temp.typeName.data(), temp.typeName.size() + 1);
 		m_uart.SendBuffer((Byte *)temp.varName.data(), temp.varName.size() + 1);
 		m_uart.SendBuffer((Byte *)",", 1);
@@ -156,7 +228,7 @@ void pGrapher::sendSharedVarInfo(void)
 	m_uart.SendBuffer((Byte *)&n, 1);
 	for (Byte i = 0; i < sharedObjMng.size(); i++)
 	{
-		ObjMng temp = sharedObjMng.at(i);
+		const ObjMng &temp = sharedObjMng[i];
 		m_uart.SendBuffer((Byte *)temp.typeName.data(), temp.typeName.size() + 1);
 		m_uart.SendBuffer((Byte *)temp.varName.data(), temp.varName.size() + 1);
 		m_uart.SendBuffer((Byte *)temp.obj, temp.len);
@@ -208,6 +280,7 @@ void pGrapher::removeAllListeners(void)
 void pGrapher::removeAllWatchedVar(void)
 {
 	watchedObjMng.erase(watchedObjMng.begin(), watchedObjMng.end());
+	isWatchLayoutDirty = true;
 }
 
 #else
@@ -7,28 +7,35 @@
  */
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "libbase/log.h"
 
 #if MK60D10 || MK60DZ10 || MK60F15
+#include "libbase/k60/hardware.h"
 #include "libbase/k60/misc_utils.h"
 #include "libsc/k60/uart_device.h"
 using namespace libsc::k60;
 
 #elif MKL26Z4
+#include "libbase/kl26/hardware.h"
 #include "libbase/kl26/misc_utils.h"
 #include "libsc/kl26/uart_device.h"
 using namespace libsc::kl26;
 
 #endif
 
-#include "libutil/endian_utils.h"
+#include "libutil/crc_utils.h"
 #include "libutil/remote_var_manager.h"
-#include "libutil/string.h"
+#include "libutil/string_builder.h"
+#include "libutil/varint_utils.h"
 
 
 using namespace std;
@@ -36,20 +43,10 @@ using namespace std;
 namespace libutil
 {
 
-namespace
-{
-
-float AsFloat(const uint32_t val)
-{
-	return *reinterpret_cast<const float*>(&val);
-}
-
-}
-
 RemoteVarManager::Var::Var()
 		: m_type(Type::kInt),
 		  m_id(0),
-		  m_val(0)
+		  m_manager(nullptr)
 {}
 
 RemoteVarManager::Var::Var(Var &&rhs)
@@ -65,15 +62,24 @@ RemoteVarManager::Var& RemoteVarManager::Var::operator=(Var &&rhs)
 		m_name = std::move(rhs.m_name);
 		m_type = rhs.m_type;
 		m_id = rhs.m_id;
-		m_val = rhs.m_val;
+		m_manager = rhs.m_manager;
 	}
 	return *this;
 }
 
 RemoteVarManager::RemoteVarManager(const size_t var_count)
-		: m_buffer_it(0)
+		: m_buffer_it(0),
+		  m_tables(new uint32_t[var_count * 2]),
+		  m_live(m_tables.get()),
+		  m_staging(m_tables.get() + var_count),
+		  m_is_staged(false),
+		  m_is_staging_synced(true),
+		  // Enough for updating every variable in one frame
+		  m_rx_frame(new Byte[var_count * 5]),
+		  m_rx_frame_capacity(var_count * 5)
 {
 	m_vars.reserve(var_count);
+	ResetRx();
 }
 
 RemoteVarManager::~RemoteVarManager()
@@ -93,6 +99,9 @@ RemoteVarManager::Var* RemoteVarManager::Register(const string &name,
 	var.m_name = name;
 	var.m_type = type;
 	var.m_id = m_vars.size();
+	var.m_manager = this;
+	m_live[var.m_id] = 0;
+	m_staging[var.m_id] = 0;
 	m_vars.push_back(std::move(var));
 	return &m_vars.back();
 }
@@ -111,6 +120,9 @@ RemoteVarManager::Var* RemoteVarManager::Register(string &&name,
 	var.m_name = std::move(name);
 	var.m_type = type;
 	var.m_id = m_vars.size();
+	var.m_manager = this;
+	m_live[var.m_id] = 0;
+	m_staging[var.m_id] = 0;
 	m_vars.push_back(std::move(var));
 	return &m_vars.back();
 }
@@ -121,19 +133,122 @@ void RemoteVarManager::Broadcast(UartDevice *uart)
 	{
 		if (m_vars[i].m_type == Var::Type::kInt)
 		{
-			uart->SendStr(String::Format("%s,int,%d,%d\n",
-					m_vars[i].m_name.c_str(), m_vars[i].m_id,
-					EndianUtils::HostToBe(m_vars[i].m_val)));
+			StringBuilder::SendFormat(uart, m_vars[i].m_name.size() + 40,
+					"%s,int,%d,%d\n", m_vars[i].m_name, m_vars[i].m_id,
+					static_cast<int32_t>(m_vars[i].GetInt()));
 		}
 		else
 		{
-			uart->SendStr(String::Format("%s,real,%d,%.3f\n",
-					m_vars[i].m_name.c_str(), m_vars[i].m_id,
-					AsFloat(EndianUtils::HostToBe(m_vars[i].m_val))));
+			StringBuilder::SendFormat(uart, m_vars[i].m_name.size() + 40,
+					"%s,real,%d,%.3f\n", m_vars[i].m_name, m_vars[i].m_id,
+					m_vars[i].GetReal());
 		}
 	}
 }
 
+void RemoteVarManager::BroadcastTable(UartDevice *uart)
+{
+	size_t payload_size = VarintUtils::GetSize(m_vars.size());
+	for (const Var &v : m_vars)
+	{
+		payload_size += 2 + VarintUtils::GetSize(v.m_name.size())
+				+ v.m_name.size();
+	}
+
+	const size_t frame_size = GetFrameSize(payload_size);
+	unique_ptr<Byte[]> owned;
+	Byte *const beg = BeginFrame(uart, frame_size, &owned);
+	if (!beg)
+	{
+		return;
+	}
+	Byte *it = beg;
+	it += PutFrameHeader(FrameToken::kTable, payload_size, it);
+	it += VarintUtils::Encode(m_vars.size(), it);
+	for (const Var &v : m_vars)
+	{
+		*it++ = v.m_id;
+		*it++ = static_cast<Byte>(v.m_type);
+		it += VarintUtils::Encode(v.m_name.size(), it);
+		memcpy(it, v.m_name.data(), v.m_name.size());
+		it += v.m_name.size();
+	}
+	*it++ = kFrameEnd;
+	EndFrame(uart, std::move(owned), frame_size);
+}
+
+void RemoteVarManager::BroadcastValues(UartDevice *uart)
+{
+	const size_t payload_size = VarintUtils::GetSize(m_vars.size())
+			+ m_vars.size() * 4;
+	const size_t frame_size = GetFrameSize(payload_size);
+	unique_ptr<Byte[]> owned;
+	Byte *const beg = BeginFrame(uart, frame_size, &owned);
+	if (!beg)
+	{
+		return;
+	}
+	Byte *it = beg;
+	it += PutFrameHeader(FrameToken::kValues, payload_size, it);
+	it += VarintUtils::Encode(m_vars.size(), it);
+	for (const Var &v : m_vars)
+	{
+		const uint32_t val = m_live[v.m_id];
+		*it++ = val >> 24;
+		*it++ = val >> 16;
+		*it++ = val >> 8;
+		*it++ = val;
+	}
+	*it++ = kFrameEnd;
+	EndFrame(uart, std::move(owned), frame_size);
+}
+
+size_t RemoteVarManager::GetFrameSize(const size_t payload_size)
+{
+	return 2 + VarintUtils::GetSize(payload_size) + payload_size + 1;
+}
+
+Byte* RemoteVarManager::BeginFrame(UartDevice *uart, const size_t size,
+		unique_ptr<Byte[]> *out_owned)
+{
+#if MK60DZ10 || MK60D10 || MK60F15
+	if (uart->IsTxRingEnabled())
+	{
+		// Straight into the Tx ring, nullptr if it's full
+		return uart->ReserveTx(size);
+	}
+
+#else
+	(void)uart;
+
+#endif
+	out_owned->reset(new Byte[size]);
+	return out_owned->get();
+}
+
+void RemoteVarManager::EndFrame(UartDevice *uart, unique_ptr<Byte[]> &&owned,
+		const size_t size)
+{
+	if (owned)
+	{
+		uart->SendBuffer(std::move(owned), size);
+	}
+#if MK60DZ10 || MK60D10 || MK60F15
+	else
+	{
+		uart->CommitTx(size);
+	}
+#endif
+}
+
+size_t RemoteVarManager::PutFrameHeader(const FrameToken token,
+		const size_t payload_size, Byte *out)
+{
+	out[0] = kFrameBegin;
+	out[1] = static_cast<Byte>(token);
+	return 2 + VarintUtils::Encode(payload_size, out + 2);
+}
+
 bool RemoteVarManager::OnUartReceiveChar(const Byte *data, const size_t size)
 {
 	for (size_t i = 0; i < size; ++i)
@@ -150,10 +265,166 @@ bool RemoteVarManager::OnUartReceiveSingleChar(const Byte data)
 	{
 		const uint32_t val = m_buffer[1] << 24 | m_buffer[2] << 16
 				| m_buffer[3] << 8 | m_buffer[4];
-		m_vars[(size_t)m_buffer[0]].m_val = val;
+		if (m_buffer[0] < m_vars.size())
+		{
+			SetVal(m_buffer[0], val);
+		}
 		m_buffer_it = 0;
 	}
 	return true;
 }
 
+bool RemoteVarManager::OnUartReceiveFrame(const Byte *data, const size_t size)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		OnRxFrameByte(data[i]);
+	}
+	return true;
+}
+
+void RemoteVarManager::OnRxFrameByte(const Byte data)
+{
+	switch (m_rx_state)
+	{
+	case RxState::kBegin:
+		if (data == kFrameBegin)
+		{
+			m_rx_state = RxState::kToken;
+		}
+		break;
+
+	case RxState::kToken:
+		if (data == static_cast<Byte>(FrameToken::kUpdate))
+		{
+			m_rx_crc = CrcUtils::Crc16(&data, 1, m_rx_crc);
+			m_rx_state = RxState::kSize;
+		}
+		else
+		{
+			ResetRx();
+			// Could be the beginning of the actual frame
+			OnRxFrameByte(data);
+		}
+		break;
+
+	case RxState::kSize:
+		m_rx_size |= (uint32_t)(data & 0x7F) << (7 * m_rx_size_it++);
+		if (!(data & 0x80))
+		{
+			if (m_rx_size > m_rx_frame_capacity || m_rx_size % 5)
+			{
+				LOG_EL("Bad update frame size");
+				ResetRx();
+			}
+			else
+			{
+				m_rx_state = m_rx_size ? RxState::kPayload : RxState::kCrc;
+			}
+		}
+		else if (m_rx_size_it >= VarintUtils::kMaxSize)
+		{
+			ResetRx();
+		}
+		break;
+
+	case RxState::kPayload:
+		m_rx_frame[m_rx_it++] = data;
+		m_rx_crc = CrcUtils::Crc16(&data, 1, m_rx_crc);
+		if (m_rx_it == m_rx_size)
+		{
+			m_rx_state = RxState::kCrc;
+			m_rx_it = 0;
+		}
+		break;
+
+	case RxState::kCrc:
+		m_rx_expected_crc = (m_rx_expected_crc << 8) | data;
+		if (++m_rx_it == 2)
+		{
+			m_rx_state = RxState::kEnd;
+		}
+		break;
+
+	case RxState::kEnd:
+		if (data == kFrameEnd && m_rx_crc == m_rx_expected_crc)
+		{
+			StageRxFrame();
+		}
+		else
+		{
+			LOG_EL("Bad update frame");
+		}
+		ResetRx();
+		break;
+	}
+}
+
+void RemoteVarManager::StageRxFrame()
+{
+	if (!m_is_staging_synced)
+	{
+		// Commit() could not preempt us here
+		copy(m_live, m_live + m_vars.size(), m_staging);
+		m_is_staging_synced = true;
+	}
+
+	for (size_t i = 0; i < m_rx_size; i += 5)
+	{
+		const Byte *it = m_rx_frame.get() + i;
+		if (it[0] < m_vars.size())
+		{
+			m_staging[it[0]] = it[1] << 24 | it[2] << 16 | it[3] << 8 | it[4];
+		}
+	}
+	m_is_staged = true;
+}
+
+void RemoteVarManager::ResetRx()
+{
+	m_rx_state = RxState::kBegin;
+	m_rx_size = 0;
+	m_rx_size_it = 0;
+	m_rx_it = 0;
+	m_rx_crc = CrcUtils::kCrc16Init;
+	m_rx_expected_crc = 0;
+}
+
+bool RemoteVarManager::Commit()
+{
+	if (!m_is_staged)
+	{
+		return false;
+	}
+
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	volatile uint32_t *const live = m_live;
+	m_live = m_staging;
+	m_staging = live;
+	m_is_staged = false;
+	// The new staging table is outdated, it'll be synced on the next update
+	m_is_staging_synced = false;
+	if (!primask)
+	{
+		__enable_irq();
+	}
+	return true;
+}
+
+void RemoteVarManager::SetVal(const uint8_t id, const uint32_t val)
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	m_live[id] = val;
+	if (m_is_staging_synced)
+	{
+		m_staging[id] = val;
+	}
+	if (!primask)
+	{
+		__enable_irq();
+	}
+}
+
 }
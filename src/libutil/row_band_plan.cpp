@@ -0,0 +1,98 @@
+/*
+ * row_band_plan.cpp
+ * Split a camera frame into kept and discarded bands of rows
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
+
+#include "libbase/misc_types.h"
+
+#include "libutil/row_band_plan.h"
+
+using namespace std;
+
+namespace libutil
+{
+
+RowBandPlan::RowBandPlan()
+		: m_w(0)
+{}
+
+bool RowBandPlan::Build(const Uint w, const Uint h, const Range *ranges,
+		const size_t range_count, const Uint stride)
+{
+	m_w = w;
+	m_rows.clear();
+	m_bands.clear();
+
+	vector<bool> is_keep(h, !ranges || !range_count);
+	for (size_t i = 0; ranges && i < range_count; ++i)
+	{
+		const Uint end = std::min<Uint>(ranges[i].start + ranges[i].count, h);
+		for (Uint y = ranges[i].start; y < end; y += std::max<Uint>(stride, 1))
+		{
+			is_keep[y] = true;
+		}
+	}
+
+	for (Uint y = 0; y < h; ++y)
+	{
+		if (is_keep[y])
+		{
+			m_rows.push_back(y);
+		}
+	}
+	if (m_rows.empty())
+	{
+		if (!h)
+		{
+			return false;
+		}
+		Build(w, h, nullptr, 0);
+		return false;
+	}
+
+	// Group the rows in the window into runs of kept/discarded rows
+	uint32_t dst_offset = 0;
+	Uint run_begin = m_rows.front();
+	for (Uint y = run_begin + 1; y <= m_rows.back(); ++y)
+	{
+		if (is_keep[y] != is_keep[run_begin])
+		{
+			AppendBand((y - run_begin) * w, is_keep[run_begin], &dst_offset);
+			run_begin = y;
+		}
+	}
+	AppendBand((m_rows.back() + 1 - run_begin) * w, true, &dst_offset);
+	return true;
+}
+
+void RowBandPlan::AppendBand(size_t size, const bool is_keep,
+		uint32_t *io_dst_offset)
+{
+	// Split the band if it's too large for a single TCD
+	while (size)
+	{
+		Band band;
+		band.size = std::min<size_t>(size, kMaxBandSize);
+		band.is_keep = is_keep;
+		band.dst_offset = is_keep ? *io_dst_offset : 0;
+		m_bands.push_back(band);
+
+		if (is_keep)
+		{
+			*io_dst_offset += band.size;
+		}
+		size -= band.size;
+	}
+}
+
+}
@@ -10,8 +10,10 @@
 #include <cstdint>
 #include <cstring>
 
+#include <algorithm>
 #include <array>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -20,10 +22,14 @@
 #include "libbase/misc_types.h"
 #include LIBBASE_H(uart)
 
+#include "libsc/system.h"
+#include "libsc/timer.h"
 #include "libsc/tsl1401cl.h"
 #include LIBSC_H(uart_device)
+#include "libutil/camera_codec.h"
 #include "libutil/endian_utils.h"
 #include "libutil/sc_studio.h"
+#include "libutil/varint_utils.h"
 
 using namespace LIBBASE_NS;
 using namespace libsc;
@@ -68,8 +74,176 @@ void ScStudio::GraphPack::PackF(const uint8_t id, const float value)
 	m_it += 4;
 }
 
+ScStudio::GraphBatcher::GraphBatcher(ScStudio *studio, const Config &config)
+		: m_studio(studio),
+		  m_window_ms(config.window_ms),
+		  m_channel_capacity(config.channel_count),
+		  m_channel_buf_size(config.channel_buf_size),
+		  m_channels(new Channel[config.channel_count]),
+		  m_channel_size(0),
+		  m_data(new Byte[config.channel_count * config.channel_buf_size]),
+		  m_is_window_open(false),
+		  m_base_time(0)
+{
+	// Worst case: full buffers plus the headers
+	const size_t channel_header_size = 2 + VarintUtils::kMaxSize * 3;
+	m_payload.reset(new Byte[VarintUtils::kMaxSize * 2 + config.channel_count
+			* (channel_header_size + config.channel_buf_size)]);
+}
+
+bool ScStudio::GraphBatcher::Add(const uint8_t id, const int32_t value)
+{
+	Byte data[VarintUtils::kMaxSize];
+	Channel *channel = GetChannel(id, static_cast<int>(GraphType::kInt),
+			sizeof(data));
+	if (!channel)
+	{
+		return false;
+	}
+	// Deltas are calculated with wrap around
+	const uint32_t delta = (channel->count ? (uint32_t)value
+			- channel->last_value : (uint32_t)value);
+	const size_t size = VarintUtils::Encode(
+			VarintUtils::ZigzagEncode((int32_t)delta), data);
+	channel->last_value = (uint32_t)value;
+	AddSample(channel, data, size);
+	return true;
+}
+
+bool ScStudio::GraphBatcher::AddF(const uint8_t id, const float value)
+{
+	Byte data[4];
+	Channel *channel = GetChannel(id, static_cast<int>(GraphType::kFloat),
+			sizeof(data));
+	if (!channel)
+	{
+		return false;
+	}
+	const uint32_t value_ = EndianUtils::HostToBe(*(const uint32_t*)&value);
+	memcpy(data, &value_, 4);
+	AddSample(channel, data, sizeof(data));
+	return true;
+}
+
+void ScStudio::GraphBatcher::Update()
+{
+	if (m_is_window_open && Timer::TimeDiff(System::Time(), m_base_time)
+			>= m_window_ms)
+	{
+		Flush();
+	}
+}
+
+void ScStudio::GraphBatcher::Flush()
+{
+	if (!m_is_window_open)
+	{
+		return;
+	}
+
+	Byte *it = m_payload.get();
+	it += VarintUtils::Encode(m_base_time, it);
+	uint8_t count = 0;
+	for (Uint i = 0; i < m_channel_size; ++i)
+	{
+		count += (m_channels[i].count ? 1 : 0);
+	}
+	it += VarintUtils::Encode(count, it);
+
+	for (Uint i = 0; i < m_channel_size; ++i)
+	{
+		Channel &channel = m_channels[i];
+		if (!channel.count)
+		{
+			continue;
+		}
+		*it++ = channel.id;
+		*it++ = channel.type;
+		it += VarintUtils::Encode(channel.count, it);
+		it += VarintUtils::Encode(channel.first_time, it);
+		it += VarintUtils::Encode(channel.last_time - channel.first_time, it);
+		memcpy(it, channel.buf, channel.buf_size);
+		it += channel.buf_size;
+
+		channel.count = 0;
+		channel.buf_size = 0;
+	}
+	m_is_window_open = false;
+
+	m_studio->SendRaw(MessageToken::kGraphBatch, it - m_payload.get(),
+			m_payload.get());
+}
+
+ScStudio::GraphBatcher::Channel* ScStudio::GraphBatcher::GetChannel(
+		const uint8_t id, const uint8_t type, const size_t sample_size)
+{
+	// Reject before a slot is taken up, or a window flushed, for nothing
+	if (sample_size > m_channel_buf_size)
+	{
+		return nullptr;
+	}
+
+	Update();
+
+	Channel *channel = nullptr;
+	for (Uint i = 0; i < m_channel_size; ++i)
+	{
+		if (m_channels[i].id == id && m_channels[i].type == type)
+		{
+			channel = &m_channels[i];
+			break;
+		}
+	}
+	if (!channel)
+	{
+		if (m_channel_size == m_channel_capacity)
+		{
+			return nullptr;
+		}
+		channel = &m_channels[m_channel_size];
+		channel->id = id;
+		channel->type = type;
+		channel->count = 0;
+		channel->buf = m_data.get() + m_channel_size * m_channel_buf_size;
+		channel->buf_size = 0;
+		++m_channel_size;
+	}
+	else if (channel->buf_size + sample_size > m_channel_buf_size
+			|| channel->count == UINT16_MAX)
+	{
+		Flush();
+	}
+	return channel;
+}
+
+void ScStudio::GraphBatcher::AddSample(Channel *channel, const Byte *data,
+		const size_t size)
+{
+	const Timer::TimerInt now = System::Time();
+	if (!m_is_window_open)
+	{
+		m_is_window_open = true;
+		m_base_time = now;
+	}
+	const Timer::TimerInt time = Timer::TimeDiff(now, m_base_time);
+	if (!channel->count)
+	{
+		channel->first_time = time;
+	}
+	channel->last_time = time;
+
+	memcpy(channel->buf + channel->buf_size, data, size);
+	channel->buf_size += size;
+	++channel->count;
+}
+
 ScStudio::ScStudio()
-		: m_uart(nullptr)
+		: m_rx_buf(m_buf),
+		  m_rx_buf_capacity(sizeof(m_buf)),
+		  m_tx_pool(m_tx_buf),
+		  m_tx_pool_capacity(sizeof(m_tx_buf)),
+		  m_tx_pool_it(0),
+		  m_uart(nullptr)
 {
 	Reset();
 }
@@ -102,6 +276,14 @@ void ScStudio::SendCamera(const Byte *data, const size_t size)
 	SendRaw(MessageToken::kCamera, size, data);
 }
 
+void ScStudio::SendCameraFrame(CameraCodec::Encoder *encoder,
+		const Byte *frame)
+{
+	size_t size;
+	const Byte *data = encoder->Encode(frame, &size);
+	SendRaw(MessageToken::kCameraFrame, size, data);
+}
+
 void ScStudio::SendGraph(const uint8_t id, const int32_t value)
 {
 	Byte data[6];
@@ -129,69 +311,194 @@ void ScStudio::SendGraph(const GraphPack &pack)
 
 void ScStudio::SendRaw(const MessageToken token, const uint32_t size,
 		const Byte *data)
+{
+	if (!m_uart)
+	{
+		return;
+	}
+
+	const size_t frame_size = GetFrameSize(size);
+#if MK60DZ10 || MK60D10 || MK60F15
+	if (m_uart->IsTxRingEnabled())
+	{
+		// Build the frame directly inside the Tx ring
+		Byte *frame = m_uart->ReserveTx(frame_size);
+		if (frame)
+		{
+			FillFrame(token, size, data, frame);
+			m_uart->CommitTx(frame_size);
+		}
+		return;
+	}
+#endif
+
+	// Frames are built in the pool and queued without copying. There's no
+	// telling which of them are sent until the whole queue is, so the pool is
+	// only rewound then
+	if (m_uart->IsTxIdle())
+	{
+		m_tx_pool_it = 0;
+	}
+	if (frame_size <= m_tx_pool_capacity - m_tx_pool_it)
+	{
+		Byte *frame = m_tx_pool + m_tx_pool_it;
+		FillFrame(token, size, data, frame);
+		if (m_uart->SendBufferNoCopy(frame, frame_size))
+		{
+			m_tx_pool_it += frame_size;
+		}
+	}
+	else if (frame_size > m_tx_pool_capacity)
+	{
+		// Would never fit, the block queue takes ownership of the buffer
+		unique_ptr<Byte[]> frame(new Byte[frame_size]);
+		FillFrame(token, size, data, frame.get());
+		m_uart->SendBuffer(std::move(frame), frame_size);
+	}
+}
+
+void ScStudio::FillFrame(const MessageToken token, const uint32_t size,
+		const Byte *data, Byte *frame)
 {
 	// zz zzzz zzyy yyyy yxxx xxxx => 1xxx xxxx 1yyy yyyy zzzz zzzz
-	const size_t size_count = ((size >> 7) ? ((size >> 14) ? 3 : 2) : 1);
-	vector<Byte> send(size + 3 + size_count);
-	send[0] = kBegin;
-	send[1] = static_cast<uint8_t>(token);
-	int pos = 1;
+	Byte *it = frame;
+	*it++ = kBegin;
+	*it++ = static_cast<uint8_t>(token);
 	for (int i = 0; i < 3; ++i)
 	{
-		send[++pos] = size >> (7 * i);
+		*it = size >> (7 * i);
 		if (!(size >> (7 * (i + 1))))
 		{
+			++it;
 			break;
 		}
 		else if (i < 2)
 		{
-			send[pos] |= 0x80;
+			*it |= 0x80;
 		}
+		++it;
 	}
-	memcpy(&send[++pos], data, size);
-	send[send.size() - 1] = kEnd;
+	memcpy(it, data, size);
+	it += size;
+	*it = kEnd;
+}
 
-	if (m_uart)
+size_t ScStudio::GetFrameSize(const uint32_t size)
+{
+	const size_t size_count = ((size >> 7) ? ((size >> 14) ? 3 : 2) : 1);
+	return size + 3 + size_count;
+}
+
+void ScStudio::SetMessageListener(const MessageToken token,
+		const OnMessageListener &listener)
+{
+	if (token == MessageToken::kNull || token >= MessageToken::kSize)
 	{
-		m_uart->SendBuffer(std::move(send));
+		assert(false);
+		return;
 	}
+	m_listeners[static_cast<size_t>(token)] = listener;
+}
+
+void ScStudio::SetRxBuffer(Byte *buf, const size_t size)
+{
+	Reset();
+	m_rx_buf = buf;
+	m_rx_buf_capacity = size;
+}
+
+void ScStudio::SetTxPool(Byte *buf, const size_t size)
+{
+	if (m_tx_pool_it && m_uart && !m_uart->IsTxIdle())
+	{
+		// Frames in the old pool are still being sent
+		assert(false);
+		return;
+	}
+	m_tx_pool = buf;
+	m_tx_pool_capacity = size;
+	m_tx_pool_it = 0;
 }
 
 bool ScStudio::OnRx(const Byte *data, const size_t size)
 {
 	for (size_t i = 0; i < size; ++i)
 	{
-		if (!m_is_start && data[i] != kBegin)
-		{
-			continue;
-		}
-		else if (!m_is_start)
-		{
-			// b == kBegin
-			m_is_start = true;
-		}
-		else if (m_token == MessageToken::kNull)
+		switch (m_rx_state)
 		{
+		case RxState::kBegin:
+			if (data[i] == kBegin)
+			{
+				m_rx_state = RxState::kToken;
+			}
+			break;
+
+		case RxState::kToken:
 			if (data[i] < static_cast<Uint>(MessageToken::kSize))
 			{
 				m_token = static_cast<MessageToken>(data[i]);
+				m_rx_state = RxState::kSize;
 			}
 			else
 			{
 				LOG_EL("Unknown msg token");
 				Reset();
 			}
-		}
-		else if (m_size == -1)
-		{
-			m_size = data[i];
-		}
-		else if (m_buf_it < m_size)
-		{
-			m_buf[m_buf_it++] = data[i];
-		}
-		else
-		{
+			break;
+
+		case RxState::kSize:
+			// 1xxx xxxx 1yyy yyyy zzzz zzzz => zz zzzz zzyy yyyy yxxx xxxx
+			if (m_size_it < 2)
+			{
+				m_size |= (uint32_t)(data[i] & 0x7F) << (7 * m_size_it);
+			}
+			else
+			{
+				m_size |= (uint32_t)data[i] << 14;
+			}
+			if (m_size_it < 2 && (data[i] & 0x80))
+			{
+				++m_size_it;
+				break;
+			}
+
+			if (m_size == 0)
+			{
+				m_rx_state = RxState::kEnd;
+			}
+			else if (size - i - 1 > m_size)
+			{
+				// The whole payload is here already, no need to copy
+				m_rx_data = data + i + 1;
+				i += m_size;
+				m_rx_state = RxState::kEnd;
+			}
+			else if (m_size > m_rx_buf_capacity)
+			{
+				LOG_EL("Msg too large");
+				Reset();
+			}
+			else
+			{
+				m_rx_state = RxState::kData;
+			}
+			break;
+
+		case RxState::kData:
+			{
+				const size_t copy_size = std::min<size_t>(size - i,
+						m_size - m_rx_buf_it);
+				memcpy(m_rx_buf + m_rx_buf_it, data + i, copy_size);
+				m_rx_buf_it += copy_size;
+				i += copy_size - 1;
+				if (m_rx_buf_it == m_size)
+				{
+					m_rx_state = RxState::kEnd;
+				}
+			}
+			break;
+
+		case RxState::kEnd:
 			if (data[i] == kEnd)
 			{
 				OnNewMessage();
@@ -199,8 +506,9 @@ bool ScStudio::OnRx(const Byte *data, const size_t size)
 			else
 			{
 				LOG_EL("End byte mismatch");
-				Reset();
 			}
+			Reset();
+			break;
 		}
 	}
 	return true;
@@ -208,15 +516,22 @@ bool ScStudio::OnRx(const Byte *data, const size_t size)
 
 void ScStudio::OnNewMessage()
 {
-	// :)
+	const OnMessageListener &listener =
+			m_listeners[static_cast<size_t>(m_token)];
+	if (listener)
+	{
+		listener(m_rx_data ? m_rx_data : m_rx_buf, m_size);
+	}
 }
 
 void ScStudio::Reset()
 {
-	m_is_start = false;
+	m_rx_state = RxState::kBegin;
 	m_token = MessageToken::kNull;
-	m_size = -1;
-	m_buf_it = 0;
+	m_size = 0;
+	m_size_it = 0;
+	m_rx_buf_it = 0;
+	m_rx_data = nullptr;
 }
 
 }
@@ -32,10 +32,26 @@ string String::Format(const char *format, ...)
 
 string String::Format(const char *format, va_list *vl)
 {
-	static char product[64];
-	vsnprintf(product, 64 * sizeof(char), format, *vl);
-	product[63] = '\0';
-	return product;
+	// Keep the buffer on stack such that it's safe to be called from ISRs
+	char buf[64];
+	va_list vl_copy;
+	va_copy(vl_copy, *vl);
+	const int size = vsnprintf(buf, sizeof(buf), format, vl_copy);
+	va_end(vl_copy);
+	if (size < 0)
+	{
+		return string();
+	}
+	else if (static_cast<size_t>(size) < sizeof(buf))
+	{
+		return string(buf, size);
+	}
+
+	// Too long for the stack buffer, format again with the exact size instead
+	// of truncating it
+	unique_ptr<char[]> long_buf(new char[size + 1]);
+	vsnprintf(long_buf.get(), size + 1, format, *vl);
+	return string(long_buf.get(), size);
 }
 
 }
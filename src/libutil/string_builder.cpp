@@ -0,0 +1,419 @@
+/*
+ * string_builder.cpp
+ * Allocation free text formatting
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+
+#include "libutil/string_builder.h"
+
+namespace libutil
+{
+
+namespace
+{
+
+/// Enough for a 64-bit integer in octal plus the sign/prefix
+constexpr size_t kNumBufSize = 24;
+
+constexpr uint32_t kPow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000,
+		10000000, 100000000, 1000000000};
+
+/**
+ * Write the decimal digits of @a value backward, ending right before @a end
+ *
+ * @param value
+ * @param end
+ * @return Pointer to the first digit
+ */
+char* PutDecBackward(uint32_t value, char *end)
+{
+	do
+	{
+		*--end = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	return end;
+}
+
+char* PutDecBackward(uint64_t value, char *end)
+{
+	// Stay with 32-bit arithmetic as much as possible, 64-bit division is done
+	// in software
+	while (value > UINT32_MAX)
+	{
+		const uint64_t q = value / 1000000000;
+		uint32_t r = static_cast<uint32_t>(value - q * 1000000000);
+		for (int i = 0; i < 9; ++i)
+		{
+			*--end = '0' + r % 10;
+			r /= 10;
+		}
+		value = q;
+	}
+	return PutDecBackward(static_cast<uint32_t>(value), end);
+}
+
+char* PutRadixBackward(uint64_t value, const char conv, char *end)
+{
+	const char *digits = (conv == 'X') ? "0123456789ABCDEF"
+			: "0123456789abcdef";
+	const int shift = (conv == 'o') ? 3 : 4;
+	const uint32_t mask = (1 << shift) - 1;
+	do
+	{
+		*--end = digits[value & mask];
+		value >>= shift;
+	} while (value);
+	return end;
+}
+
+inline bool IsRadixConv(const char conv)
+{
+	return (conv == 'x' || conv == 'X' || conv == 'o');
+}
+
+}
+
+StringBuilder::StringBuilder(char *buf, const size_t capacity)
+		: m_buf(buf),
+		  m_capacity(capacity),
+		  m_required(0)
+{
+	if (m_capacity)
+	{
+		m_buf[0] = '\0';
+	}
+}
+
+void StringBuilder::Clear()
+{
+	m_required = 0;
+	if (m_capacity)
+	{
+		m_buf[0] = '\0';
+	}
+}
+
+StringBuilder& StringBuilder::Append(const char c)
+{
+	if (m_required + 1 < m_capacity)
+	{
+		m_buf[m_required] = c;
+		m_buf[m_required + 1] = '\0';
+	}
+	++m_required;
+	return *this;
+}
+
+StringBuilder& StringBuilder::Append(const char *str)
+{
+	return Append(str, strlen(str));
+}
+
+StringBuilder& StringBuilder::Append(const char *str, const size_t size)
+{
+	if (m_required + 1 < m_capacity)
+	{
+		const size_t copy_size = std::min(size, m_capacity - 1 - m_required);
+		memcpy(m_buf + m_required, str, copy_size);
+		m_buf[m_required + copy_size] = '\0';
+	}
+	m_required += size;
+	return *this;
+}
+
+void StringBuilder::AppendFill(const char c, size_t count)
+{
+	if (m_required + 1 < m_capacity)
+	{
+		const size_t fill_size = std::min(count, m_capacity - 1 - m_required);
+		memset(m_buf + m_required, c, fill_size);
+		m_buf[m_required + fill_size] = '\0';
+	}
+	m_required += count;
+}
+
+void StringBuilder::AppendPadded(const char *str, const size_t size,
+		const Spec &spec, const size_t prefix_size, const bool is_numeric)
+{
+	const size_t pad = (spec.width > size) ? spec.width - size : 0;
+	if (!pad)
+	{
+		Append(str, size);
+	}
+	else if (spec.is_left_align)
+	{
+		Append(str, size);
+		AppendFill(' ', pad);
+	}
+	else if (spec.is_zero_pad && is_numeric)
+	{
+		Append(str, prefix_size);
+		AppendFill('0', pad);
+		Append(str + prefix_size, size - prefix_size);
+	}
+	else
+	{
+		AppendFill(' ', pad);
+		Append(str, size);
+	}
+}
+
+StringBuilder& StringBuilder::AppendInt(const int32_t value, const Spec &spec)
+{
+	char buf[kNumBufSize];
+	char *const end = buf + kNumBufSize;
+	// Negate in unsigned to survive INT32_MIN
+	const uint32_t abs_value = (value < 0) ? 0u - static_cast<uint32_t>(value)
+			: static_cast<uint32_t>(value);
+	char *it = PutDecBackward(abs_value, end);
+	if (value < 0)
+	{
+		*--it = '-';
+	}
+	else if (spec.is_plus)
+	{
+		*--it = '+';
+	}
+	AppendPadded(it, end - it, spec, (*it == '-' || *it == '+') ? 1 : 0, true);
+	return *this;
+}
+
+StringBuilder& StringBuilder::AppendInt(const int64_t value, const Spec &spec)
+{
+	if (value >= INT32_MIN && value <= INT32_MAX)
+	{
+		return AppendInt(static_cast<int32_t>(value), spec);
+	}
+
+	char buf[kNumBufSize];
+	char *const end = buf + kNumBufSize;
+	const uint64_t abs_value = (value < 0) ? 0u - static_cast<uint64_t>(value)
+			: static_cast<uint64_t>(value);
+	char *it = PutDecBackward(abs_value, end);
+	if (value < 0)
+	{
+		*--it = '-';
+	}
+	else if (spec.is_plus)
+	{
+		*--it = '+';
+	}
+	AppendPadded(it, end - it, spec, (*it == '-' || *it == '+') ? 1 : 0, true);
+	return *this;
+}
+
+StringBuilder& StringBuilder::AppendUint(const uint32_t value,
+		const Spec &spec)
+{
+	char buf[kNumBufSize];
+	char *const end = buf + kNumBufSize;
+	char *it = IsRadixConv(spec.conv) ? PutRadixBackward(value, spec.conv, end)
+			: PutDecBackward(value, end);
+	AppendPadded(it, end - it, spec, 0, true);
+	return *this;
+}
+
+StringBuilder& StringBuilder::AppendUint(const uint64_t value,
+		const Spec &spec)
+{
+	char buf[kNumBufSize];
+	char *const end = buf + kNumBufSize;
+	char *it = IsRadixConv(spec.conv) ? PutRadixBackward(value, spec.conv, end)
+			: PutDecBackward(value, end);
+	AppendPadded(it, end - it, spec, 0, true);
+	return *this;
+}
+
+StringBuilder& StringBuilder::AppendFloat(const double value, const Spec &spec)
+{
+	const int precision = std::min<int>((spec.precision < 0) ? 6
+			: spec.precision, 9);
+	if (std::isnan(value))
+	{
+		AppendPadded("nan", 3, spec, 0, false);
+		return *this;
+	}
+
+	const bool is_neg = std::signbit(value);
+	const double abs_value = is_neg ? -value : value;
+	if (std::isinf(value) || abs_value >= 4294967295.0)
+	{
+		char buf[kNumBufSize + 320];
+		const int size = std::isinf(value)
+				? snprintf(buf, sizeof(buf), is_neg ? "-inf"
+						: (spec.is_plus ? "+inf" : "inf"))
+				: snprintf(buf, sizeof(buf), spec.is_plus ? "%+.*f" : "%.*f",
+						precision, value);
+		AppendPadded(buf, std::min<size_t>(std::max(size, 0), sizeof(buf) - 1),
+				spec, 1, !std::isinf(value));
+		return *this;
+	}
+
+	uint32_t int_part = static_cast<uint32_t>(abs_value);
+	const uint32_t scale = kPow10[precision];
+	// Round half away from zero at the last digit
+	uint32_t frac_part = static_cast<uint32_t>((abs_value - int_part) * scale
+			+ 0.5);
+	if (frac_part >= scale)
+	{
+		frac_part -= scale;
+		if (int_part == UINT32_MAX)
+		{
+			// Carried into the 33rd bit, let the slow path deal with it
+			Spec slow_spec = spec;
+			slow_spec.precision = precision;
+			return AppendFloat(is_neg ? -4294967296.0 : 4294967296.0,
+					slow_spec);
+		}
+		++int_part;
+	}
+
+	char buf[kNumBufSize];
+	char *const end = buf + kNumBufSize;
+	char *it = end;
+	if (precision > 0)
+	{
+		char *const frac_beg = end - precision;
+		it = PutDecBackward(frac_part, end);
+		while (it > frac_beg)
+		{
+			*--it = '0';
+		}
+		*--it = '.';
+	}
+	it = PutDecBackward(int_part, it);
+	if (is_neg)
+	{
+		*--it = '-';
+	}
+	else if (spec.is_plus)
+	{
+		*--it = '+';
+	}
+	AppendPadded(it, end - it, spec, (*it == '-' || *it == '+') ? 1 : 0, true);
+	return *this;
+}
+
+StringBuilder& StringBuilder::AppendStr(const char *str, const Spec &spec)
+{
+	if (!str)
+	{
+		str = "(null)";
+	}
+	size_t size;
+	if (spec.precision >= 0)
+	{
+		const void *nul = memchr(str, '\0', spec.precision);
+		size = nul ? static_cast<const char*>(nul) - str : spec.precision;
+	}
+	else
+	{
+		size = strlen(str);
+	}
+	AppendPadded(str, size, spec, 0, false);
+	return *this;
+}
+
+StringBuilder& StringBuilder::AppendPtr(const void *ptr, const Spec &spec)
+{
+	char buf[kNumBufSize];
+	char *const end = buf + kNumBufSize;
+	char *it = PutRadixBackward(reinterpret_cast<uintptr_t>(ptr), 'x', end);
+	*--it = 'x';
+	*--it = '0';
+	AppendPadded(it, end - it, spec, 2, true);
+	return *this;
+}
+
+const char* StringBuilder::ParseNext(const char *format, Spec *out_spec)
+{
+	while (true)
+	{
+		const char *percent = strchr(format, '%');
+		if (!percent)
+		{
+			Append(format);
+			return nullptr;
+		}
+		Append(format, percent - format);
+		format = percent + 1;
+		if (*format == '%')
+		{
+			Append('%');
+			++format;
+			continue;
+		}
+
+		*out_spec = Spec();
+		for (;; ++format)
+		{
+			if (*format == '0')
+			{
+				out_spec->is_zero_pad = true;
+			}
+			else if (*format == '-')
+			{
+				out_spec->is_left_align = true;
+			}
+			else if (*format == '+')
+			{
+				out_spec->is_plus = true;
+			}
+			else if (*format != ' ' && *format != '#')
+			{
+				break;
+			}
+		}
+		unsigned width = 0;
+		while (*format >= '0' && *format <= '9')
+		{
+			width = width * 10 + (*format++ - '0');
+		}
+		out_spec->width = std::min<unsigned>(width, UINT8_MAX);
+		if (*format == '.')
+		{
+			++format;
+			unsigned precision = 0;
+			while (*format >= '0' && *format <= '9')
+			{
+				precision = precision * 10 + (*format++ - '0');
+			}
+			out_spec->precision = std::min<unsigned>(precision, INT8_MAX);
+		}
+		while (*format == 'h' || *format == 'l' || *format == 'L'
+				|| *format == 'j' || *format == 'z' || *format == 't')
+		{
+			++format;
+		}
+		if (*format == '\0')
+		{
+			return nullptr;
+		}
+		out_spec->conv = *format;
+		return format + 1;
+	}
+}
+
+void StringBuilder::FormatImpl(const char *format)
+{
+	// No more argument, drop all the remaining conversions
+	Spec spec;
+	while (format)
+	{
+		format = ParseNext(format, &spec);
+	}
+}
+
+}
@@ -0,0 +1,430 @@
+/*
+ * task_scheduler.cpp
+ * Min-heap based timer task scheduler
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+
+#include "libutil/task_scheduler.h"
+
+namespace libutil
+{
+
+namespace
+{
+
+constexpr uint16_t kGenerationMask = 0x7FFF;
+
+}
+
+TaskScheduler::TaskScheduler(const size_t capacity)
+		: m_capacity(capacity),
+		  m_tasks(new Task[capacity]),
+		  m_heap(new uint16_t[capacity]),
+		  m_heap_size(0),
+		  m_ready(new uint16_t[capacity]),
+		  m_free(new uint16_t[capacity]),
+		  m_free_size(capacity),
+		  m_size(0),
+		  m_seq(0)
+#if LIBUTIL_TASK_PROFILE
+		  , m_cycle_counter(nullptr),
+		  m_stats(new TaskStats[capacity]),
+		  m_prev_run_cycle(0)
+#endif
+{
+	assert(capacity <= UINT16_MAX);
+	for (size_t i = 0; i < capacity; ++i)
+	{
+		Task &task = m_tasks[i];
+		task.generation = 0;
+		task.state = State::kFree;
+		// Hand out the lower slots first
+		m_free[i] = capacity - i - 1;
+	}
+}
+
+TaskScheduler::TaskId TaskScheduler::Add(const Tick now, const Tick period,
+		const Callback &callback, const RepeatMode mode, const uint8_t priority,
+		const uint8_t unit_shift)
+{
+	if (!m_free_size)
+	{
+		assert(false);
+		return kInvalidTask;
+	}
+
+	const uint16_t slot = m_free[--m_free_size];
+	Task &task = m_tasks[slot];
+	task.callback = callback;
+	task.due = now + period;
+	task.period = period;
+	task.seq = m_seq++;
+	task.priority = priority;
+	task.mode = mode;
+	task.unit_shift = unit_shift;
+	task.state = State::kQueued;
+	Push(slot);
+	++m_size;
+#if LIBUTIL_TASK_PROFILE
+	m_stats[slot] = TaskStats();
+#endif
+	return (static_cast<TaskId>(task.generation) << 16) | slot;
+}
+
+bool TaskScheduler::Cancel(const TaskId id)
+{
+	if (id < 0)
+	{
+		return false;
+	}
+	const uint16_t slot = id & 0xFFFF;
+	if (slot >= m_capacity)
+	{
+		return false;
+	}
+	Task &task = m_tasks[slot];
+	if (task.generation != (id >> 16) || task.state == State::kFree)
+	{
+		return false;
+	}
+
+	switch (task.state)
+	{
+	case State::kQueued:
+		Remove(slot);
+		Free(slot);
+		break;
+
+	case State::kReady:
+		// Still referenced by m_ready, Run() will skip it
+		Free(slot);
+		break;
+
+	case State::kRunning:
+		// The callback is being executed, defer releasing the slot until it
+		// returns
+		task.state = State::kFree;
+		task.generation = (task.generation + 1) & kGenerationMask;
+		--m_size;
+		break;
+
+	default:
+		break;
+	}
+	return true;
+}
+
+void TaskScheduler::Run(const Tick now)
+{
+#if LIBUTIL_TASK_PROFILE
+	const uint32_t run_begin = ReadCycle();
+#endif
+
+	// Collect the due tasks first, such that tasks rescheduled below won't be
+	// picked up again in the same run
+	size_t ready_size = 0;
+	while (m_heap_size && !IsBefore(now, m_tasks[m_heap[0]].due))
+	{
+		const uint16_t slot = PopTop();
+		m_tasks[slot].state = State::kReady;
+		// Typically only a few are due at once, insertion sort is good enough
+		size_t i = ready_size++;
+		for (; i > 0 && IsReadyLess(slot, m_ready[i - 1]); --i)
+		{
+			m_ready[i] = m_ready[i - 1];
+		}
+		m_ready[i] = slot;
+	}
+
+	for (size_t i = 0; i < ready_size; ++i)
+	{
+		const uint16_t slot = m_ready[i];
+		Task &task = m_tasks[slot];
+		if (task.state != State::kReady)
+		{
+			// Cancelled by a previous callback
+			continue;
+		}
+
+		task.state = State::kRunning;
+		const Tick actual = now - (task.due - task.period);
+#if LIBUTIL_TASK_PROFILE
+		const Tick lateness = now - task.due;
+		const uint32_t begin = ReadCycle();
+#endif
+		task.callback(task.period >> task.unit_shift,
+				actual >> task.unit_shift);
+#if LIBUTIL_TASK_PROFILE
+		RecordTask(slot, lateness, ReadCycle() - begin);
+#endif
+
+		if (task.state != State::kRunning)
+		{
+			// Cancelled by the callback itself
+			task.callback = nullptr;
+			m_free[m_free_size++] = slot;
+			continue;
+		}
+
+		switch (task.mode)
+		{
+		case RepeatMode::kOnce:
+			Free(slot);
+			break;
+
+		case RepeatMode::kPrecise:
+			task.due += task.period;
+			task.seq = m_seq++;
+			task.state = State::kQueued;
+			Push(slot);
+			break;
+
+		case RepeatMode::kLoose:
+			task.due = now + task.period;
+			task.seq = m_seq++;
+			task.state = State::kQueued;
+			Push(slot);
+			break;
+		}
+	}
+
+#if LIBUTIL_TASK_PROFILE
+	if (ready_size)
+	{
+		if (m_run_stats.run_count)
+		{
+			m_run_stats.elapsed_cycles += run_begin - m_prev_run_cycle;
+		}
+		m_prev_run_cycle = run_begin;
+		m_run_stats.busy_cycles += ReadCycle() - run_begin;
+		++m_run_stats.run_count;
+	}
+#endif
+}
+
+bool TaskScheduler::IsDue(const Tick now) const
+{
+	return (m_heap_size && !IsBefore(now, m_tasks[m_heap[0]].due));
+}
+
+void TaskScheduler::SetCycleCounter(const CycleCounter counter)
+{
+#if LIBUTIL_TASK_PROFILE
+	m_cycle_counter = counter;
+#else
+	(void)counter;
+#endif
+}
+
+bool TaskScheduler::GetTaskStats(const size_t slot, TaskId *out_id,
+		TaskStats *out_stats) const
+{
+#if LIBUTIL_TASK_PROFILE
+	if (slot >= m_capacity || m_tasks[slot].state == State::kFree)
+	{
+		return false;
+	}
+	if (out_id)
+	{
+		*out_id = (static_cast<TaskId>(m_tasks[slot].generation) << 16) | slot;
+	}
+	if (out_stats)
+	{
+		*out_stats = m_stats[slot];
+	}
+	return true;
+#else
+	(void)slot;
+	(void)out_id;
+	(void)out_stats;
+	return false;
+#endif
+}
+
+TaskScheduler::RunStats TaskScheduler::GetRunStats() const
+{
+#if LIBUTIL_TASK_PROFILE
+	return m_run_stats;
+#else
+	return {};
+#endif
+}
+
+void TaskScheduler::ResetStats()
+{
+#if LIBUTIL_TASK_PROFILE
+	for (size_t i = 0; i < m_capacity; ++i)
+	{
+		m_stats[i] = TaskStats();
+	}
+	m_run_stats = RunStats();
+#endif
+}
+
+#if LIBUTIL_TASK_PROFILE
+void TaskScheduler::RecordTask(const uint16_t slot, const Tick lateness,
+		const uint32_t cycles)
+{
+	TaskStats &stats = m_stats[slot];
+	++stats.count;
+	stats.total_cycles += cycles;
+	if (cycles < stats.min_cycles)
+	{
+		stats.min_cycles = cycles;
+	}
+	if (cycles > stats.max_cycles)
+	{
+		stats.max_cycles = cycles;
+	}
+
+	const size_t bucket = lateness ? std::min<size_t>(32 - __builtin_clz(
+			lateness), kLatenessBuckets - 1) : 0;
+	if (stats.lateness_hist[bucket] != UINT16_MAX)
+	{
+		++stats.lateness_hist[bucket];
+	}
+	const Tick period = m_tasks[slot].period;
+	if (period && lateness >= period)
+	{
+		++stats.deadline_misses;
+	}
+}
+#endif
+
+bool TaskScheduler::IsHeapLess(const uint16_t a, const uint16_t b) const
+{
+	const Task &ta = m_tasks[a];
+	const Task &tb = m_tasks[b];
+	if (ta.due != tb.due)
+	{
+		return IsBefore(ta.due, tb.due);
+	}
+	else if (ta.priority != tb.priority)
+	{
+		return (ta.priority < tb.priority);
+	}
+	else
+	{
+		return (static_cast<int32_t>(ta.seq - tb.seq) < 0);
+	}
+}
+
+bool TaskScheduler::IsReadyLess(const uint16_t a, const uint16_t b) const
+{
+	const Task &ta = m_tasks[a];
+	const Task &tb = m_tasks[b];
+	if (ta.priority != tb.priority)
+	{
+		return (ta.priority < tb.priority);
+	}
+	else if (ta.due != tb.due)
+	{
+		return IsBefore(ta.due, tb.due);
+	}
+	else
+	{
+		return (static_cast<int32_t>(ta.seq - tb.seq) < 0);
+	}
+}
+
+void TaskScheduler::Push(const uint16_t slot)
+{
+	const size_t pos = m_heap_size++;
+	Place(pos, slot);
+	SiftUp(pos);
+}
+
+uint16_t TaskScheduler::PopTop()
+{
+	const uint16_t top = m_heap[0];
+	Remove(top);
+	return top;
+}
+
+void TaskScheduler::Remove(const uint16_t slot)
+{
+	const size_t pos = m_tasks[slot].heap_pos;
+	const uint16_t last = m_heap[--m_heap_size];
+	if (pos == m_heap_size)
+	{
+		return;
+	}
+
+	Place(pos, last);
+	if (pos > 0 && IsHeapLess(last, m_heap[(pos - 1) / 2]))
+	{
+		SiftUp(pos);
+	}
+	else
+	{
+		SiftDown(pos);
+	}
+}
+
+void TaskScheduler::SiftUp(size_t pos)
+{
+	const uint16_t slot = m_heap[pos];
+	while (pos > 0)
+	{
+		const size_t parent = (pos - 1) / 2;
+		if (!IsHeapLess(slot, m_heap[parent]))
+		{
+			break;
+		}
+		Place(pos, m_heap[parent]);
+		pos = parent;
+	}
+	Place(pos, slot);
+}
+
+void TaskScheduler::SiftDown(size_t pos)
+{
+	const uint16_t slot = m_heap[pos];
+	while (true)
+	{
+		size_t child = pos * 2 + 1;
+		if (child >= m_heap_size)
+		{
+			break;
+		}
+		if (child + 1 < m_heap_size
+				&& IsHeapLess(m_heap[child + 1], m_heap[child]))
+		{
+			++child;
+		}
+		if (!IsHeapLess(m_heap[child], slot))
+		{
+			break;
+		}
+		Place(pos, m_heap[child]);
+		pos = child;
+	}
+	Place(pos, slot);
+}
+
+void TaskScheduler::Place(const size_t pos, const uint16_t slot)
+{
+	m_heap[pos] = slot;
+	m_tasks[slot].heap_pos = pos;
+}
+
+void TaskScheduler::Free(const uint16_t slot)
+{
+	Task &task = m_tasks[slot];
+	task.callback = nullptr;
+	task.state = State::kFree;
+	task.generation = (task.generation + 1) & kGenerationMask;
+	m_free[m_free_size++] = slot;
+	--m_size;
+}
+
+}
@@ -0,0 +1,51 @@
+/*
+ * triple_buffer.cpp
+ * Lock-free triple buffer index rotation
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstdint>
+
+#include <atomic>
+
+#include "libutil/triple_buffer.h"
+
+namespace libutil
+{
+
+TripleBuffer::TripleBuffer()
+		: m_write(0),
+		  m_latest(1),
+		  m_read(2)
+{}
+
+bool TripleBuffer::Publish()
+{
+	const uint8_t prev = m_latest.exchange(m_write | kNewBit,
+			std::memory_order_acq_rel);
+	m_write = prev & kIndexMask;
+	return (prev & kNewBit);
+}
+
+uint8_t TripleBuffer::Acquire()
+{
+	if (HasNew())
+	{
+		const uint8_t prev = m_latest.exchange(m_read,
+				std::memory_order_acq_rel);
+		m_read = prev & kIndexMask;
+	}
+	return m_read;
+}
+
+void TripleBuffer::Reset()
+{
+	m_write = 0;
+	m_latest.store(1, std::memory_order_release);
+	m_read = 2;
+}
+
+}
@@ -0,0 +1,58 @@
+/*
+ * varint_utils.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libbase/misc_types.h"
+
+#include "libutil/varint_utils.h"
+
+namespace libutil
+{
+
+size_t VarintUtils::GetSize(const uint32_t value)
+{
+	size_t product = 1;
+	for (uint32_t v = value >> 7; v; v >>= 7)
+	{
+		++product;
+	}
+	return product;
+}
+
+size_t VarintUtils::Encode(const uint32_t value, Byte *out)
+{
+	uint32_t v = value;
+	size_t i = 0;
+	while (v >= 0x80)
+	{
+		out[i++] = (Byte)(v | 0x80);
+		v >>= 7;
+	}
+	out[i++] = (Byte)v;
+	return i;
+}
+
+size_t VarintUtils::Decode(const Byte *data, const size_t size,
+		uint32_t *out_value)
+{
+	uint32_t value = 0;
+	for (size_t i = 0; i < size && i < kMaxSize; ++i)
+	{
+		value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+		if (!(data[i] & 0x80))
+		{
+			*out_value = value;
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+}
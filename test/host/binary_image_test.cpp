@@ -0,0 +1,283 @@
+/*
+ * binary_image_test.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include "libbase/misc_types.h"
+#include "libutil/binary_image.h"
+
+#include "test.h"
+
+using libutil::BinaryImage;
+using std::vector;
+
+namespace
+{
+
+/**
+ * A random 1bpp image, one byte off word alignment to exercise the unaligned
+ * loads. The padding bits are random too, kernels must not depend on them
+ */
+class Image
+{
+public:
+	Image(const Uint w, const Uint h, const Uint density)
+			: m_w(w),
+			  m_h(h),
+			  m_row_bytes(BinaryImage::GetRowBytes(w)),
+			  m_buf(m_row_bytes * h + 8)
+	{
+		for (Uint y = 0; y < h; ++y)
+		{
+			for (Uint x = 0; x < m_row_bytes * 8; ++x)
+			{
+				if (test::Rand() % 100 < density)
+				{
+					GetRow(y)[x / 8] |= 0x80 >> (x % 8);
+				}
+			}
+		}
+	}
+
+	Byte* GetRow(const Uint y)
+	{
+		return m_buf.data() + 1 + y * m_row_bytes;
+	}
+
+	const Byte* GetRow(const Uint y) const
+	{
+		return m_buf.data() + 1 + y * m_row_bytes;
+	}
+
+	/// Pixels outside the image are clear
+	bool Get(const int x, const int y) const
+	{
+		if (x < 0 || y < 0 || x >= static_cast<int>(m_w)
+				|| y >= static_cast<int>(m_h))
+		{
+			return false;
+		}
+		return GetRow(y)[x / 8] & (0x80 >> (x % 8));
+	}
+
+	Uint GetW() const
+	{
+		return m_w;
+	}
+
+	Uint GetH() const
+	{
+		return m_h;
+	}
+
+	size_t GetRowBytes() const
+	{
+		return m_row_bytes;
+	}
+
+private:
+	Uint m_w;
+	Uint m_h;
+	size_t m_row_bytes;
+	vector<Byte> m_buf;
+};
+
+bool GetBit(const Byte *row, const Uint x)
+{
+	return row[x / 8] & (0x80 >> (x % 8));
+}
+
+typedef void (*MorphFunc)(const Byte*, const Uint, const Uint, Byte*);
+
+/**
+ * Compare a morphology kernel against the per-pixel definition
+ *
+ * @return # mismatching pixels, including padding bits not cleared
+ */
+int CheckMorph(const Image &img, const MorphFunc func, const bool is_h,
+		const bool is_erode)
+{
+	const Uint w = img.GetW();
+	const Uint h = img.GetH();
+	const size_t row_bytes = img.GetRowBytes();
+	vector<Byte> dst(row_bytes * h + 8, 0xA5);
+	func(img.GetRow(0), w, h, dst.data() + 1);
+
+	int fail_count = 0;
+	for (Uint y = 0; y < h; ++y)
+	{
+		const Byte *row = dst.data() + 1 + y * row_bytes;
+		for (Uint x = 0; x < row_bytes * 8; ++x)
+		{
+			bool expect = false;
+			if (x < w)
+			{
+				const bool a = is_h ? img.Get(x - 1, y) : img.Get(x, y - 1);
+				const bool b = is_h ? img.Get(x + 1, y) : img.Get(x, y + 1);
+				const bool c = img.Get(x, y);
+				expect = is_erode ? (a && b && c) : (a || b || c);
+			}
+			fail_count += (GetBit(row, x) != expect);
+		}
+	}
+	// Nothing written past the image
+	fail_count += (dst[0] != 0xA5 || dst[1 + row_bytes * h] != 0xA5);
+	return fail_count;
+}
+
+}
+
+TEST(BinaryImageRuns)
+{
+	test::SeedRand(24);
+	int fail_count = 0;
+	for (int round = 0; round < 1000; ++round)
+	{
+		const Image img(1 + test::Rand() % 150, 1, test::Rand() % 101);
+		const Uint w = img.GetW();
+
+		vector<BinaryImage::Run> expect;
+		for (Uint x = 0; x < w;)
+		{
+			if (img.Get(x, 0))
+			{
+				const Uint begin = x;
+				while (x < w && img.Get(x, 0))
+				{
+					++x;
+				}
+				expect.push_back({static_cast<uint16_t>(begin),
+						static_cast<uint16_t>(x)});
+			}
+			else
+			{
+				++x;
+			}
+		}
+
+		BinaryImage::Run runs[80];
+		const size_t count = BinaryImage::GetRuns(img.GetRow(0), w, runs, 80);
+		fail_count += (count != expect.size());
+		for (size_t i = 0; i < std::min(count, expect.size()); ++i)
+		{
+			fail_count += (runs[i].begin != expect[i].begin
+					|| runs[i].end != expect[i].end);
+		}
+
+		// Extra runs are dropped
+		const size_t max_runs = test::Rand() % 4;
+		fail_count += (BinaryImage::GetRuns(img.GetRow(0), w, runs, max_runs)
+				!= std::min(max_runs, expect.size()));
+	}
+	EXPECT_EQ(fail_count, 0);
+}
+
+TEST(BinaryImageFind)
+{
+	test::SeedRand(24);
+	int fail_count = 0;
+	for (int round = 0; round < 300; ++round)
+	{
+		const Image img(1 + test::Rand() % 150, 1, test::Rand() % 101);
+		const int w = img.GetW();
+		for (int from = 0; from < w + 3; ++from)
+		{
+			for (int value = 0; value < 2; ++value)
+			{
+				int next = -1;
+				for (int x = from; x < w; ++x)
+				{
+					if (img.Get(x, 0) == value)
+					{
+						next = x;
+						break;
+					}
+				}
+				fail_count += (BinaryImage::FindNext(img.GetRow(0), w, from,
+						value) != next);
+
+				int prev = -1;
+				for (int x = std::min(from, w - 1); x >= 0; --x)
+				{
+					if (img.Get(x, 0) == value)
+					{
+						prev = x;
+						break;
+					}
+				}
+				fail_count += (BinaryImage::FindPrev(img.GetRow(0), w, from,
+						value) != prev);
+			}
+		}
+	}
+	EXPECT_EQ(fail_count, 0);
+}
+
+TEST(BinaryImageMorphology)
+{
+	test::SeedRand(24);
+	int fail_count = 0;
+	for (int round = 0; round < 300; ++round)
+	{
+		const Image img(1 + test::Rand() % 150, 1 + test::Rand() % 20,
+				test::Rand() % 101);
+		fail_count += CheckMorph(img, BinaryImage::ErodeH, true, true);
+		fail_count += CheckMorph(img, BinaryImage::DilateH, true, false);
+		fail_count += CheckMorph(img, BinaryImage::ErodeV, false, true);
+		fail_count += CheckMorph(img, BinaryImage::DilateV, false, false);
+	}
+	EXPECT_EQ(fail_count, 0);
+}
+
+TEST(BinaryImageCount)
+{
+	test::SeedRand(24);
+	int fail_count = 0;
+	for (int round = 0; round < 300; ++round)
+	{
+		const Image img(1 + test::Rand() % 200, 1 + test::Rand() % 40,
+				test::Rand() % 101);
+		const Uint w = img.GetW();
+		const Uint h = img.GetH();
+
+		vector<uint16_t> rows(h);
+		BinaryImage::CountRows(img.GetRow(0), w, h, rows.data());
+		vector<uint16_t> columns(w);
+		BinaryImage::ProjectColumns(img.GetRow(0), w, h, columns.data());
+
+		vector<uint16_t> expect_columns(w, 0);
+		for (Uint y = 0; y < h; ++y)
+		{
+			Uint expect = 0;
+			for (Uint x = 0; x < w; ++x)
+			{
+				expect += img.Get(x, y);
+				expect_columns[x] += img.Get(x, y);
+			}
+			fail_count += (BinaryImage::CountRow(img.GetRow(y), w) != expect);
+			fail_count += (rows[y] != expect);
+		}
+		fail_count += (columns != expect_columns);
+	}
+	EXPECT_EQ(fail_count, 0);
+}
+
+TEST(BinaryImageProjectTall)
+{
+	// Enough rows to carry through every bit of the bit-sliced counters
+	const Image img(70, 1000, 100);
+	vector<uint16_t> columns(70);
+	BinaryImage::ProjectColumns(img.GetRow(0), 70, 1000, columns.data());
+	EXPECT(std::all_of(columns.begin(), columns.end(),
+			[](const uint16_t c){return c == 1000;}));
+}
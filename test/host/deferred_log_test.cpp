@@ -0,0 +1,147 @@
+/*
+ * deferred_log_test.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "libbase/deferred_log.h"
+#include "libbase/misc_types.h"
+#include "libsc/k60/uart_device.h"
+#include "libutil/misc.h"
+
+#include "test.h"
+
+using libbase::DeferredLog;
+using libsc::k60::UartDevice;
+
+namespace
+{
+
+const char kFmtA[] = "a %d";
+const char kFmtB[] = "b %d %d";
+
+/**
+ * Discard whatever is left by other cases, including the dropped count
+ */
+void ResetLog()
+{
+	Byte buf[256];
+	while (DeferredLog::Drain(buf, sizeof(buf)))
+	{}
+}
+
+uint32_t GetLe32(const Byte *data)
+{
+	return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+/**
+ * Check that the record at @a data is of @a fmt with @a arg0, and return the
+ * pointer past it
+ */
+const Byte* ExpectRecord(const Byte *data, const char *fmt,
+		const uint32_t arg0)
+{
+	EXPECT_EQ(data[0], DeferredLog::kSync);
+	EXPECT_EQ(GetLe32(data + 1), (uint32_t)reinterpret_cast<uintptr_t>(fmt));
+	const size_t size = data[5] & 0x7F;
+	EXPECT(size >= 4);
+	EXPECT_EQ(GetLe32(data + 6), arg0);
+	return data + 6 + size;
+}
+
+}
+
+TEST(DeferredLogPeekKeepsRecords)
+{
+	ResetLog();
+	DeferredLog::Write(kFmtA, 1);
+	DeferredLog::Write(kFmtB, 2, 3);
+
+	Byte first[128];
+	const size_t size = DeferredLog::Peek(first, sizeof(first));
+	ASSERT(size == 10 + 14);
+	const Byte *it = ExpectRecord(first, kFmtA, 1);
+	it = ExpectRecord(it, kFmtB, 2);
+	EXPECT_EQ(GetLe32(it - 4), 3u);
+
+	// Not consumed, so the same records again
+	Byte second[128];
+	EXPECT_EQ(DeferredLog::Peek(second, sizeof(second)), size);
+	EXPECT(memcmp(first, second, size) == 0);
+
+	DeferredLog::Consume();
+	EXPECT_EQ(DeferredLog::Peek(second, sizeof(second)), 0u);
+}
+
+TEST(DeferredLogPeekPartial)
+{
+	ResetLog();
+	DeferredLog::Write(kFmtA, 1);
+	DeferredLog::Write(kFmtA, 2);
+
+	// Room for one record only
+	Byte buf[16];
+	ASSERT(DeferredLog::Peek(buf, sizeof(buf)) == 10);
+	ExpectRecord(buf, kFmtA, 1);
+	DeferredLog::Consume();
+	ASSERT(DeferredLog::Peek(buf, sizeof(buf)) == 10);
+	ExpectRecord(buf, kFmtA, 2);
+	DeferredLog::Consume();
+	EXPECT_EQ(DeferredLog::Peek(buf, sizeof(buf)), 0u);
+}
+
+TEST(DeferredLogDroppedKeptUntilConsumed)
+{
+	ResetLog();
+	for (size_t i = 0; i < DeferredLog::kSlotCount + 3; ++i)
+	{
+		DeferredLog::Write(kFmtA, i);
+	}
+
+	Byte buf[32];
+	ASSERT(DeferredLog::Peek(buf, sizeof(buf)) >= 10);
+	EXPECT_EQ(buf[0], DeferredLog::kSync);
+	EXPECT_EQ(GetLe32(buf + 1), 0u);
+	EXPECT_EQ(buf[5], 4);
+	EXPECT_EQ(GetLe32(buf + 6), 3u);
+
+	// Still reported if the first attempt was not consumed
+	ASSERT(DeferredLog::Peek(buf, sizeof(buf)) >= 10);
+	EXPECT_EQ(GetLe32(buf + 1), 0u);
+	EXPECT_EQ(GetLe32(buf + 6), 3u);
+	DeferredLog::Consume();
+
+	ASSERT(DeferredLog::Peek(buf, sizeof(buf)) >= 10);
+	EXPECT(GetLe32(buf + 1) != 0u);
+	ResetLog();
+}
+
+TEST(DrainDeferredLogKeepsUnsent)
+{
+	ResetLog();
+	UartDevice uart;
+	DeferredLog::Write(kFmtA, 10);
+	DeferredLog::Write(kFmtA, 20);
+	DeferredLog::Write(kFmtB, 30, 40);
+
+	uart.is_tx_full = true;
+	libutil::DrainDeferredLog(&uart);
+	EXPECT_EQ(uart.log_size, 0u);
+
+	uart.is_tx_full = false;
+	libutil::DrainDeferredLog(&uart);
+	ASSERT(uart.log_size == 10 + 10 + 14);
+	const Byte *it = ExpectRecord(uart.log, kFmtA, 10);
+	it = ExpectRecord(it, kFmtA, 20);
+	ExpectRecord(it, kFmtB, 30);
+
+	libutil::DrainDeferredLog(&uart);
+	EXPECT_EQ(uart.log_size, 10u + 10 + 14);
+}
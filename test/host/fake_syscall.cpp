@@ -0,0 +1,14 @@
+/*
+ * fake_syscall.cpp
+ * Host stand-in of the newlib syscall hooks
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+
+#include "libbase/syscall.h"
+
+FwriteHandler g_fwrite_handler = NULL;
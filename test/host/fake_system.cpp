@@ -0,0 +1,46 @@
+/*
+ * fake_system.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include "libsc/system.h"
+#include "libsc/timer.h"
+
+#include "fake_system.h"
+
+namespace
+{
+
+libsc::Timer::TimerInt g_time = 0;
+
+}
+
+namespace test
+{
+
+void SetSystemTime(const libsc::Timer::TimerInt time)
+{
+	g_time = time;
+}
+
+}
+
+namespace libsc
+{
+
+Timer::TimerInt System::Time()
+{
+	return g_time;
+}
+
+#ifdef USE_TIME_IN_125US
+Timer::TimerInt System::TimeIn125us()
+{
+	return g_time << 3;
+}
+#endif
+
+}
@@ -0,0 +1,24 @@
+/*
+ * fake_system.h
+ * Host stand-in of libsc::System, whose time only advances when told to
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include "libsc/timer.h"
+
+namespace test
+{
+
+/**
+ * Set the value returned by libsc::System::Time(), in ms
+ *
+ * @param time
+ */
+void SetSystemTime(const libsc::Timer::TimerInt time);
+
+}
@@ -0,0 +1,56 @@
+/*
+ * gray_image_simd.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libbase/misc_types.h"
+#include "libutil/gray_image.h"
+
+#include "gray_image_simd.h"
+
+#if !LIBUTIL_GRAY_SIMD
+#error Must be built with LIBUTIL_GRAY_SIMD=1
+#endif
+
+// libutil is defined as libutil_simd for this file
+using libutil::GrayImage;
+
+namespace test
+{
+namespace gray_simd
+{
+
+void Binarize(const Byte *src, const Uint w, const Uint h,
+		const uint8_t threshold, Byte *dst)
+{
+	GrayImage::Binarize(src, w, h, threshold, dst);
+}
+
+void Sobel(const Byte *src, const Uint w, const Uint h, Byte *dst)
+{
+	GrayImage::Sobel(src, w, h, dst);
+}
+
+void BoxBlur(const Byte *src, const Uint w, const Uint h, Byte *dst)
+{
+	GrayImage::BoxBlur(src, w, h, dst);
+}
+
+uint32_t AbsDiff(const Byte *a, const Byte *b, const size_t size, Byte *dst)
+{
+	return GrayImage::AbsDiff(a, b, size, dst);
+}
+
+void Downscale2x(const Byte *src, const Uint w, const Uint h, Byte *dst)
+{
+	GrayImage::Downscale2x(src, w, h, dst);
+}
+
+}
+}
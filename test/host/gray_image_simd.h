@@ -0,0 +1,38 @@
+/*
+ * gray_image_simd.h
+ * GrayImage built a second time with LIBUTIL_GRAY_SIMD=1, i.e., the SIMD
+ * path with the instructions emulated, to be compared with the plain one
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libbase/misc_types.h"
+
+namespace test
+{
+
+/**
+ * Forward to the GrayImage methods of the same names. That copy lives in
+ * namespace libutil_simd (see Makefile), which can't be declared here along
+ * with the plain one
+ */
+namespace gray_simd
+{
+
+void Binarize(const Byte *src, const Uint w, const Uint h,
+		const uint8_t threshold, Byte *dst);
+void Sobel(const Byte *src, const Uint w, const Uint h, Byte *dst);
+void BoxBlur(const Byte *src, const Uint w, const Uint h, Byte *dst);
+uint32_t AbsDiff(const Byte *a, const Byte *b, const size_t size, Byte *dst);
+void Downscale2x(const Byte *src, const Uint w, const Uint h, Byte *dst);
+
+}
+
+}
@@ -0,0 +1,364 @@
+/*
+ * gray_image_test.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <vector>
+
+#include "libbase/misc_types.h"
+#include "libutil/binary_image.h"
+#include "libutil/gray_image.h"
+
+#include "gray_image_simd.h"
+#include "test.h"
+
+using libutil::BinaryImage;
+using libutil::GrayImage;
+using std::vector;
+
+namespace
+{
+
+/**
+ * A random frame at a random offset off word alignment. Besides noise, also
+ * generate pure black and white and smooth gradients, which hit the
+ * saturation and rounding corners of the kernels
+ */
+class Image
+{
+public:
+	Image(const Uint w, const Uint h)
+			: m_w(w),
+			  m_h(h),
+			  m_offset(test::Rand() % 4),
+			  m_buf(w * h + 8)
+	{
+		const Uint type = test::Rand() % 3;
+		for (Uint i = 0; i < w * h; ++i)
+		{
+			switch (type)
+			{
+			case 0:
+				GetData()[i] = test::Rand();
+				break;
+
+			case 1:
+				GetData()[i] = (test::Rand() & 1) ? 0xFF : 0;
+				break;
+
+			case 2:
+				GetData()[i] = (i % w) * 7 + (i / w) * 3;
+				break;
+			}
+		}
+	}
+
+	Byte* GetData()
+	{
+		return m_buf.data() + m_offset;
+	}
+
+	const Byte* GetData() const
+	{
+		return m_buf.data() + m_offset;
+	}
+
+	int Get(const Uint x, const Uint y) const
+	{
+		return GetData()[y * m_w + x];
+	}
+
+	Uint GetW() const
+	{
+		return m_w;
+	}
+
+	Uint GetH() const
+	{
+		return m_h;
+	}
+
+	size_t GetSize() const
+	{
+		return m_w * m_h;
+	}
+
+private:
+	Uint m_w;
+	Uint m_h;
+	Uint m_offset;
+	vector<Byte> m_buf;
+};
+
+Image RandImage()
+{
+	return Image(1 + test::Rand() % 100, 1 + test::Rand() % 20);
+}
+
+bool IsBorder(const Image &img, const Uint x, const Uint y)
+{
+	return (x == 0 || y == 0 || x + 1 >= img.GetW() || y + 1 >= img.GetH());
+}
+
+Byte RefSobel(const Image &img, const Uint x, const Uint y)
+{
+	if (IsBorder(img, x, y))
+	{
+		return 0;
+	}
+	const int gx = img.Get(x + 1, y - 1) + 2 * img.Get(x + 1, y)
+			+ img.Get(x + 1, y + 1) - img.Get(x - 1, y - 1)
+			- 2 * img.Get(x - 1, y) - img.Get(x - 1, y + 1);
+	const int gy = img.Get(x - 1, y + 1) + 2 * img.Get(x, y + 1)
+			+ img.Get(x + 1, y + 1) - img.Get(x - 1, y - 1)
+			- 2 * img.Get(x, y - 1) - img.Get(x + 1, y - 1);
+	return std::min(abs(gx) + abs(gy), 255);
+}
+
+Byte RefBoxBlur(const Image &img, const Uint x, const Uint y)
+{
+	if (IsBorder(img, x, y))
+	{
+		return img.Get(x, y);
+	}
+	int sum = 0;
+	for (Uint yy = y - 1; yy <= y + 1; ++yy)
+	{
+		for (Uint xx = x - 1; xx <= x + 1; ++xx)
+		{
+			sum += img.Get(xx, yy);
+		}
+	}
+	return (sum + 4) / 9;
+}
+
+/// The output of every kernel for one frame
+struct Results
+{
+	vector<Byte> binary;
+	vector<Byte> sobel;
+	vector<Byte> blur;
+	vector<Byte> diff;
+	uint32_t sad;
+	vector<Byte> down;
+};
+
+template<typename BinarizeFunc, typename SobelFunc, typename BoxBlurFunc,
+		typename AbsDiffFunc, typename DownscaleFunc>
+Results Run(const Image &img, const Image &other, const uint8_t threshold,
+		BinarizeFunc binarize, SobelFunc sobel, BoxBlurFunc box_blur,
+		AbsDiffFunc abs_diff, DownscaleFunc downscale)
+{
+	const Uint w = img.GetW();
+	const Uint h = img.GetH();
+	Results r;
+	r.binary.resize(BinaryImage::GetRowBytes(w) * h);
+	binarize(img.GetData(), w, h, threshold, r.binary.data());
+	r.sobel.resize(img.GetSize());
+	sobel(img.GetData(), w, h, r.sobel.data());
+	r.blur.resize(img.GetSize());
+	box_blur(img.GetData(), w, h, r.blur.data());
+	r.diff.resize(img.GetSize());
+	r.sad = abs_diff(img.GetData(), other.GetData(), img.GetSize(),
+			r.diff.data());
+	r.down.resize((w / 2) * (h / 2));
+	downscale(img.GetData(), w, h, r.down.data());
+	return r;
+}
+
+Results RunPlain(const Image &img, const Image &other, const uint8_t threshold)
+{
+	return Run(img, other, threshold, GrayImage::Binarize, GrayImage::Sobel,
+			GrayImage::BoxBlur, GrayImage::AbsDiff, GrayImage::Downscale2x);
+}
+
+Results RunSimd(const Image &img, const Image &other, const uint8_t threshold)
+{
+	return Run(img, other, threshold, test::gray_simd::Binarize,
+			test::gray_simd::Sobel, test::gray_simd::BoxBlur,
+			test::gray_simd::AbsDiff, test::gray_simd::Downscale2x);
+}
+
+}
+
+TEST(GrayImageHistogram)
+{
+	test::SeedRand(25);
+	for (int round = 0; round < 50; ++round)
+	{
+		const Image img = RandImage();
+		uint32_t hist[256];
+		GrayImage::Histogram(img.GetData(), img.GetSize(), hist);
+		uint32_t expect[256] = {};
+		for (size_t i = 0; i < img.GetSize(); ++i)
+		{
+			++expect[img.GetData()[i]];
+		}
+		EXPECT(std::equal(hist, hist + 256, expect));
+	}
+}
+
+TEST(GrayImageOtsuThreshold)
+{
+	test::SeedRand(25);
+	uint32_t hist[256] = {};
+	EXPECT_EQ(GrayImage::OtsuThreshold(hist), 0);
+
+	int fail_count = 0;
+	for (int round = 0; round < 500; ++round)
+	{
+		// Two narrow modes separated by a wider gap, every threshold in the
+		// gap splits them the same, the first one wins
+		std::fill(hist, hist + 256, 0);
+		const Uint low_end = 8 + test::Rand() % 100;
+		const Uint high_begin = low_end + 16 + test::Rand() % 100;
+		const Uint n = 1 + test::Rand() % 20000;
+		for (Uint i = 0; i < n; ++i)
+		{
+			++hist[low_end - test::Rand() % 8];
+			++hist[high_begin + test::Rand() % 8];
+		}
+		hist[low_end] += 1;
+		fail_count += (GrayImage::OtsuThreshold(hist) != low_end);
+
+		// Random histograms, the chosen threshold must be as good as the
+		// best one up to the precision of the integer math
+		for (Uint i = 0; i < 256; ++i)
+		{
+			hist[i] = (test::Rand() % 3) ? test::Rand() % 1000 : 0;
+		}
+		double total = 0;
+		double sum = 0;
+		for (Uint i = 0; i < 256; ++i)
+		{
+			total += hist[i];
+			sum += static_cast<double>(i) * hist[i];
+		}
+		vector<double> scores(256, 0);
+		double w0 = 0;
+		double sum0 = 0;
+		for (Uint t = 0; t < 255; ++t)
+		{
+			w0 += hist[t];
+			sum0 += static_cast<double>(t) * hist[t];
+			const double w1 = total - w0;
+			if (w0 && w1)
+			{
+				const double d = sum0 / w0 - (sum - sum0) / w1;
+				scores[t] = w0 * w1 * d * d;
+			}
+		}
+		const double best = *std::max_element(scores.begin(), scores.end());
+		fail_count += (scores[GrayImage::OtsuThreshold(hist)]
+				< best * (1 - 1e-6));
+	}
+	EXPECT_EQ(fail_count, 0);
+}
+
+TEST(GrayImageKernels)
+{
+	test::SeedRand(25);
+	int fail_count = 0;
+	for (int round = 0; round < 500; ++round)
+	{
+		const Image img = RandImage();
+		const Image other(img.GetW(), img.GetH());
+		const Uint w = img.GetW();
+		const Uint h = img.GetH();
+		const uint8_t threshold = test::Rand();
+		const Results r = RunPlain(img, other, threshold);
+
+		const size_t row_bytes = BinaryImage::GetRowBytes(w);
+		uint32_t sad = 0;
+		for (Uint y = 0; y < h; ++y)
+		{
+			const Byte *binary_row = r.binary.data() + y * row_bytes;
+			for (Uint x = 0; x < row_bytes * 8; ++x)
+			{
+				const bool bit = binary_row[x / 8] & (0x80 >> (x % 8));
+				fail_count += (bit != (x < w && img.Get(x, y) <= threshold));
+			}
+			for (Uint x = 0; x < w; ++x)
+			{
+				const size_t i = y * w + x;
+				fail_count += (r.sobel[i] != RefSobel(img, x, y));
+				fail_count += (r.blur[i] != RefBoxBlur(img, x, y));
+				const int diff = abs(img.Get(x, y) - other.Get(x, y));
+				fail_count += (r.diff[i] != diff);
+				sad += diff;
+			}
+		}
+		fail_count += (r.sad != sad);
+
+		for (Uint y = 0; y < h / 2; ++y)
+		{
+			for (Uint x = 0; x < w / 2; ++x)
+			{
+				const int expect = (img.Get(x * 2, y * 2)
+						+ img.Get(x * 2 + 1, y * 2) + img.Get(x * 2, y * 2 + 1)
+						+ img.Get(x * 2 + 1, y * 2 + 1) + 2) >> 2;
+				fail_count += (r.down[y * (w / 2) + x] != expect);
+			}
+		}
+	}
+	EXPECT_EQ(fail_count, 0);
+}
+
+TEST(GrayImageInPlace)
+{
+	test::SeedRand(25);
+	for (int round = 0; round < 50; ++round)
+	{
+		Image img = RandImage();
+		const Image other(img.GetW(), img.GetH());
+		const Results r = RunPlain(img, other, 0);
+
+		EXPECT_EQ(GrayImage::AbsDiff(img.GetData(), other.GetData(),
+				img.GetSize(), nullptr), r.sad);
+
+		Image down = img;
+		GrayImage::Downscale2x(down.GetData(), img.GetW(), img.GetH(),
+				down.GetData());
+		EXPECT(std::equal(r.down.begin(), r.down.end(), down.GetData()));
+
+		GrayImage::AbsDiff(img.GetData(), other.GetData(), img.GetSize(),
+				img.GetData());
+		EXPECT(std::equal(r.diff.begin(), r.diff.end(), img.GetData()));
+	}
+}
+
+TEST(GrayImageSimdMatchesPlain)
+{
+	// The SIMD path, with the instructions emulated, must be bit-identical
+	test::SeedRand(25);
+	int fail_count = 0;
+	for (int round = 0; round < 500; ++round)
+	{
+		const Image img = RandImage();
+		const Image other(img.GetW(), img.GetH());
+		const uint8_t threshold = test::Rand();
+		const Results plain = RunPlain(img, other, threshold);
+		const Results simd = RunSimd(img, other, threshold);
+		fail_count += (plain.binary != simd.binary);
+		fail_count += (plain.sobel != simd.sobel);
+		fail_count += (plain.blur != simd.blur);
+		fail_count += (plain.diff != simd.diff);
+		fail_count += (plain.sad != simd.sad);
+		fail_count += (plain.down != simd.down);
+
+		Image down = img;
+		test::gray_simd::Downscale2x(down.GetData(), img.GetW(), img.GetH(),
+				down.GetData());
+		fail_count += !std::equal(plain.down.begin(), plain.down.end(),
+				down.GetData());
+	}
+	EXPECT_EQ(fail_count, 0);
+}
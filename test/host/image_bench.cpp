@@ -0,0 +1,311 @@
+/*
+ * image_bench.cpp
+ * Host side timing of the image kernels against plain per-pixel loops. The
+ * figures only hint at the relative cost, the target has a different
+ * pipeline and memory system
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <vector>
+
+#include "libbase/misc_types.h"
+#include "libutil/binary_image.h"
+#include "libutil/gray_image.h"
+
+#include "gray_image_simd.h"
+
+using libutil::BinaryImage;
+using libutil::GrayImage;
+using std::vector;
+
+namespace
+{
+
+/// Ov7725 binary frame
+constexpr Uint kBinaryW = 80;
+constexpr Uint kBinaryH = 60;
+
+/// MT9V034 frame, binned 4x
+constexpr Uint kGrayW = 188;
+constexpr Uint kGrayH = 120;
+
+/// Keep the results alive
+volatile uint32_t g_sink;
+
+template<typename Func>
+void Bench(const char *name, Func func)
+{
+	using namespace std::chrono;
+	// Warm up and size the run to about 0.2s
+	int iterations = 1;
+	double ns = 0;
+	while (true)
+	{
+		const auto begin = steady_clock::now();
+		for (int i = 0; i < iterations; ++i)
+		{
+			func();
+		}
+		ns = duration_cast<nanoseconds>(steady_clock::now() - begin).count();
+		if (ns > 2e8 || iterations >= (1 << 24))
+		{
+			break;
+		}
+		iterations *= 2;
+	}
+	printf("%-28s %10.1f ns\n", name, ns / iterations);
+}
+
+bool GetBit(const Byte *row, const Uint x)
+{
+	return row[x / 8] & (0x80 >> (x % 8));
+}
+
+void SetBit(Byte *row, const Uint x, const bool value)
+{
+	if (value)
+	{
+		row[x / 8] |= 0x80 >> (x % 8);
+	}
+	else
+	{
+		row[x / 8] &= ~(0x80 >> (x % 8));
+	}
+}
+
+void BenchBinary()
+{
+	const size_t row_bytes = BinaryImage::GetRowBytes(kBinaryW);
+	vector<Byte> src(row_bytes * kBinaryH);
+	for (Byte &b : src)
+	{
+		// Mostly white with a few dark runs, like a track
+		b = (rand() % 4) ? 0x00 : rand();
+	}
+	vector<Byte> dst(src.size());
+	vector<uint16_t> counts(kBinaryW);
+
+	printf("BinaryImage %ux%u\n", kBinaryW, kBinaryH);
+	Bench("ErodeH", [&]()
+			{
+				BinaryImage::ErodeH(src.data(), kBinaryW, kBinaryH,
+						dst.data());
+				g_sink = dst[0];
+			});
+	Bench("  per-pixel", [&]()
+			{
+				for (Uint y = 0; y < kBinaryH; ++y)
+				{
+					const Byte *s = src.data() + y * row_bytes;
+					Byte *d = dst.data() + y * row_bytes;
+					for (Uint x = 0; x < kBinaryW; ++x)
+					{
+						SetBit(d, x, x > 0 && x + 1 < kBinaryW
+								&& GetBit(s, x - 1) && GetBit(s, x)
+								&& GetBit(s, x + 1));
+					}
+				}
+				g_sink = dst[0];
+			});
+	Bench("ErodeV", [&]()
+			{
+				BinaryImage::ErodeV(src.data(), kBinaryW, kBinaryH,
+						dst.data());
+				g_sink = dst[0];
+			});
+	Bench("  per-pixel", [&]()
+			{
+				for (Uint y = 0; y < kBinaryH; ++y)
+				{
+					const Byte *s = src.data() + y * row_bytes;
+					Byte *d = dst.data() + y * row_bytes;
+					for (Uint x = 0; x < kBinaryW; ++x)
+					{
+						SetBit(d, x, y > 0 && y + 1 < kBinaryH
+								&& GetBit(s - row_bytes, x) && GetBit(s, x)
+								&& GetBit(s + row_bytes, x));
+					}
+				}
+				g_sink = dst[0];
+			});
+	Bench("GetRuns", [&]()
+			{
+				BinaryImage::Run runs[kBinaryW / 2 + 1];
+				uint32_t sum = 0;
+				for (Uint y = 0; y < kBinaryH; ++y)
+				{
+					sum += BinaryImage::GetRuns(src.data() + y * row_bytes,
+							kBinaryW, runs, kBinaryW / 2 + 1);
+				}
+				g_sink = sum;
+			});
+	Bench("  per-pixel", [&]()
+			{
+				uint32_t sum = 0;
+				for (Uint y = 0; y < kBinaryH; ++y)
+				{
+					const Byte *s = src.data() + y * row_bytes;
+					bool prev = false;
+					for (Uint x = 0; x < kBinaryW; ++x)
+					{
+						const bool bit = GetBit(s, x);
+						sum += (bit && !prev);
+						prev = bit;
+					}
+				}
+				g_sink = sum;
+			});
+	Bench("FindNext (from 0)", [&]()
+			{
+				uint32_t sum = 0;
+				for (Uint y = 0; y < kBinaryH; ++y)
+				{
+					sum += BinaryImage::FindNext(src.data() + y * row_bytes,
+							kBinaryW, 0, true);
+				}
+				g_sink = sum;
+			});
+	Bench("  per-pixel", [&]()
+			{
+				uint32_t sum = 0;
+				for (Uint y = 0; y < kBinaryH; ++y)
+				{
+					const Byte *s = src.data() + y * row_bytes;
+					Uint x = 0;
+					while (x < kBinaryW && !GetBit(s, x))
+					{
+						++x;
+					}
+					sum += x;
+				}
+				g_sink = sum;
+			});
+	Bench("ProjectColumns", [&]()
+			{
+				BinaryImage::ProjectColumns(src.data(), kBinaryW, kBinaryH,
+						counts.data());
+				g_sink = counts[0];
+			});
+	Bench("  per-pixel", [&]()
+			{
+				for (Uint x = 0; x < kBinaryW; ++x)
+				{
+					uint16_t count = 0;
+					for (Uint y = 0; y < kBinaryH; ++y)
+					{
+						count += GetBit(src.data() + y * row_bytes, x);
+					}
+					counts[x] = count;
+				}
+				g_sink = counts[0];
+			});
+}
+
+void BenchGray()
+{
+	vector<Byte> src(kGrayW * kGrayH);
+	vector<Byte> other(src.size());
+	for (size_t i = 0; i < src.size(); ++i)
+	{
+		src[i] = rand();
+		other[i] = rand();
+	}
+	vector<Byte> dst(src.size());
+	vector<Byte> binary(BinaryImage::GetRowBytes(kGrayW) * kGrayH);
+
+	// The SIMD path is timed with the instructions emulated, it's only there
+	// to show the cost of the emulation, not the gain on target
+	printf("GrayImage %ux%u\n", kGrayW, kGrayH);
+	Bench("Binarize", [&]()
+			{
+				GrayImage::Binarize(src.data(), kGrayW, kGrayH, 128,
+						binary.data());
+				g_sink = binary[0];
+			});
+	Bench("  emulated SIMD", [&]()
+			{
+				test::gray_simd::Binarize(src.data(), kGrayW, kGrayH, 128,
+						binary.data());
+				g_sink = binary[0];
+			});
+	Bench("  per-pixel", [&]()
+			{
+				for (Uint y = 0; y < kGrayH; ++y)
+				{
+					Byte *d = binary.data()
+							+ y * BinaryImage::GetRowBytes(kGrayW);
+					for (Uint x = 0; x < kGrayW; ++x)
+					{
+						SetBit(d, x, src[y * kGrayW + x] <= 128);
+					}
+				}
+				g_sink = binary[0];
+			});
+	Bench("Sobel", [&]()
+			{
+				GrayImage::Sobel(src.data(), kGrayW, kGrayH, dst.data());
+				g_sink = dst[kGrayW + 1];
+			});
+	Bench("  emulated SIMD", [&]()
+			{
+				test::gray_simd::Sobel(src.data(), kGrayW, kGrayH, dst.data());
+				g_sink = dst[kGrayW + 1];
+			});
+	Bench("BoxBlur", [&]()
+			{
+				GrayImage::BoxBlur(src.data(), kGrayW, kGrayH, dst.data());
+				g_sink = dst[kGrayW + 1];
+			});
+	Bench("  emulated SIMD", [&]()
+			{
+				test::gray_simd::BoxBlur(src.data(), kGrayW, kGrayH,
+						dst.data());
+				g_sink = dst[kGrayW + 1];
+			});
+	Bench("AbsDiff", [&]()
+			{
+				g_sink = GrayImage::AbsDiff(src.data(), other.data(),
+						src.size(), dst.data());
+			});
+	Bench("  emulated SIMD", [&]()
+			{
+				g_sink = test::gray_simd::AbsDiff(src.data(), other.data(),
+						src.size(), dst.data());
+			});
+	Bench("Downscale2x", [&]()
+			{
+				GrayImage::Downscale2x(src.data(), kGrayW, kGrayH, dst.data());
+				g_sink = dst[0];
+			});
+	Bench("  emulated SIMD", [&]()
+			{
+				test::gray_simd::Downscale2x(src.data(), kGrayW, kGrayH,
+						dst.data());
+				g_sink = dst[0];
+			});
+	Bench("Histogram + OtsuThreshold", [&]()
+			{
+				uint32_t hist[256];
+				GrayImage::Histogram(src.data(), src.size(), hist);
+				g_sink = GrayImage::OtsuThreshold(hist);
+			});
+}
+
+}
+
+int main()
+{
+	srand(1);
+	BenchBinary();
+	BenchGray();
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * looper_test.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libutil/looper.h"
+
+#include "test.h"
+
+using libutil::Looper;
+
+namespace
+{
+
+uint32_t g_now = 0;
+/// Advance g_now on each read if set, to drive Loop()
+bool g_is_auto_advance = false;
+
+uint32_t VirtualClock()
+{
+	return g_is_auto_advance ? g_now++ : g_now;
+}
+
+Looper::Config MakeConfig(const uint32_t now)
+{
+	g_now = now;
+	g_is_auto_advance = false;
+	Looper::Config config;
+	config.task_capacity = 8;
+	config.clock = &VirtualClock;
+	return config;
+}
+
+/**
+ * Step the clock by one tick at a time, calling Once() at each
+ */
+void Step(Looper *looper, const uint32_t ticks)
+{
+	for (uint32_t i = 0; i < ticks; ++i)
+	{
+		++g_now;
+		looper->Once();
+	}
+}
+
+}
+
+TEST(LooperRepeatInMs)
+{
+	Looper looper(MakeConfig(1000));
+	int count = 0;
+	uint32_t request = 0;
+	uint32_t actual = 0;
+	looper.Repeat(2, [&](const uint32_t r, const uint32_t a)
+			{
+				++count;
+				request = r;
+				actual = a;
+			}, Looper::RepeatMode::kPrecise);
+
+	// 2ms is 16 ticks
+	Step(&looper, 15);
+	EXPECT_EQ(count, 0);
+	Step(&looper, 1);
+	EXPECT_EQ(count, 1);
+	EXPECT_EQ(request, 2u);
+	EXPECT_EQ(actual, 2u);
+	Step(&looper, 16 * 9);
+	EXPECT_EQ(count, 10);
+}
+
+TEST(LooperPriority)
+{
+	Looper looper(MakeConfig(0));
+	int order[3] = {};
+	int it = 0;
+	int *o = order;
+	int *i = &it;
+	looper.RepeatIn125us(4, [o, i](const uint32_t, const uint32_t)
+			{
+				o[(*i)++] = 3;
+			}, Looper::RepeatMode::kOnce, 30);
+	looper.RepeatIn125us(4, [o, i](const uint32_t, const uint32_t)
+			{
+				o[(*i)++] = 1;
+			}, Looper::RepeatMode::kOnce, 10);
+	looper.RepeatIn125us(4, [o, i](const uint32_t, const uint32_t)
+			{
+				o[(*i)++] = 2;
+			}, Looper::RepeatMode::kOnce, 20);
+
+	Step(&looper, 4);
+	ASSERT(it == 3);
+	EXPECT_EQ(order[0], 1);
+	EXPECT_EQ(order[1], 2);
+	EXPECT_EQ(order[2], 3);
+}
+
+TEST(LooperLateOnce)
+{
+	Looper looper(MakeConfig(0));
+	int precise = 0;
+	int loose = 0;
+	looper.RepeatIn125us(10, [&precise](const uint32_t, const uint32_t)
+			{
+				++precise;
+			}, Looper::RepeatMode::kPrecise);
+	looper.RepeatIn125us(10, [&loose](const uint32_t, const uint32_t)
+			{
+				++loose;
+			}, Looper::RepeatMode::kLoose);
+
+	looper.Once();
+	// The main loop stalls for 35 ticks
+	g_now = 35;
+	looper.Once();
+	EXPECT_EQ(precise, 1);
+	EXPECT_EQ(loose, 1);
+	// kPrecise catches up one call per tick, kLoose waits a whole period
+	Step(&looper, 2);
+	EXPECT_EQ(precise, 3);
+	EXPECT_EQ(loose, 1);
+	Step(&looper, 8);
+	EXPECT_EQ(precise, 4);
+	EXPECT_EQ(loose, 2);
+}
+
+TEST(LooperCancelInCallback)
+{
+	Looper looper(MakeConfig(0));
+	int count = 0;
+	Looper::TaskId id = 0;
+	Looper *l = &looper;
+	id = looper.RepeatIn125us(1, [l, &id, &count](const uint32_t,
+			const uint32_t)
+			{
+				if (++count == 5)
+				{
+					l->Cancel(id);
+				}
+			}, Looper::RepeatMode::kPrecise);
+
+	Step(&looper, 20);
+	EXPECT_EQ(count, 5);
+	EXPECT_EQ(looper.GetScheduler().GetSize(), 0u);
+}
+
+TEST(LooperTickWrap)
+{
+	Looper looper(MakeConfig(0xFFFFFFF0));
+	int count = 0;
+	looper.RepeatIn125us(8, [&count](const uint32_t, const uint32_t actual)
+			{
+				EXPECT_EQ(actual, 8u);
+				++count;
+			}, Looper::RepeatMode::kPrecise);
+
+	Step(&looper, 0x40);
+	EXPECT_EQ(count, 8);
+}
+
+TEST(LooperLoopBreak)
+{
+	Looper looper(MakeConfig(0));
+	g_is_auto_advance = true;
+	int count = 0;
+	Looper *l = &looper;
+	looper.RepeatIn125us(3, [l, &count](const uint32_t, const uint32_t)
+			{
+				if (++count == 4)
+				{
+					l->Break();
+				}
+			}, Looper::RepeatMode::kLoose);
+
+	looper.Loop();
+	EXPECT(looper.IsBreak());
+	EXPECT_EQ(count, 4);
+	g_is_auto_advance = false;
+}
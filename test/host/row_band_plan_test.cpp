@@ -0,0 +1,256 @@
+/*
+ * row_band_plan_test.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include "libutil/row_band_plan.h"
+
+#include "test.h"
+
+using libutil::RowBandPlan;
+using std::vector;
+
+namespace
+{
+
+/**
+ * Check the invariants every plan must hold: the bands cover exactly the
+ * window, start and end with a kept band, the kept bands are laid out back
+ * to back in the buffer and map to the kept rows in order
+ *
+ * @return # failed checks
+ */
+int CheckBands(const RowBandPlan &plan, const Uint w)
+{
+	int fail_count = 0;
+	const vector<RowBandPlan::Band> &bands = plan.GetBands();
+	if (bands.empty())
+	{
+		return (plan.GetRowCount() != 0);
+	}
+	fail_count += !bands.front().is_keep;
+	fail_count += !bands.back().is_keep;
+
+	size_t total = 0;
+	size_t kept = 0;
+	for (const RowBandPlan::Band &b : bands)
+	{
+		fail_count += (b.size == 0 || b.size > RowBandPlan::kMaxBandSize);
+		if (b.is_keep)
+		{
+			fail_count += (b.dst_offset != kept);
+			// Each row read out lands where its kept row is in the buffer
+			for (size_t i = 0; i < b.size; i += w)
+			{
+				const Uint src_row = plan.GetWindowStart() + (total + i) / w;
+				const Uint dst_row = (kept + i) / w;
+				fail_count += (dst_row >= plan.GetRowCount()
+						|| plan.GetSourceRow(dst_row) != src_row);
+			}
+			kept += b.size;
+		}
+		total += b.size;
+	}
+	fail_count += (kept != plan.GetBufferSize());
+	fail_count += (total != plan.GetWindowSize() * w);
+	return fail_count;
+}
+
+/**
+ * Per row reference of Build(), as documented
+ */
+vector<Uint> RefRows(const Uint h, const vector<RowBandPlan::Range> &ranges,
+		const Uint stride)
+{
+	vector<Uint> rows;
+	for (Uint y = 0; y < h; ++y)
+	{
+		bool is_keep = false;
+		for (const RowBandPlan::Range &r : ranges)
+		{
+			is_keep |= (y >= r.start && y < r.start + r.count
+					&& (y - r.start) % stride == 0);
+		}
+		if (is_keep)
+		{
+			rows.push_back(y);
+		}
+	}
+	return rows;
+}
+
+}
+
+TEST(RowBandPlanWholeFrame)
+{
+	RowBandPlan plan;
+	EXPECT(plan.Build(188, 120, nullptr, 0));
+	EXPECT_EQ(plan.GetWindowStart(), 0u);
+	EXPECT_EQ(plan.GetWindowSize(), 120u);
+	EXPECT_EQ(plan.GetRowCount(), 120u);
+	EXPECT_EQ(plan.GetBufferSize(), 188u * 120);
+	EXPECT_EQ(CheckBands(plan, 188), 0);
+}
+
+TEST(RowBandPlanOverlapUnsorted)
+{
+	const RowBandPlan::Range ranges[] = {{50, 10}, {10, 5}, {12, 8}, {55, 2}};
+	RowBandPlan plan;
+	EXPECT(plan.Build(100, 120, ranges, 4));
+	// 10..19 and 50..59, each row once, in order
+	ASSERT(plan.GetRowCount() == 20);
+	for (Uint i = 0; i < 10; ++i)
+	{
+		EXPECT_EQ(plan.GetSourceRow(i), 10 + i);
+		EXPECT_EQ(plan.GetSourceRow(10 + i), 50 + i);
+	}
+	EXPECT_EQ(plan.GetWindowStart(), 10u);
+	EXPECT_EQ(plan.GetWindowSize(), 50u);
+
+	const vector<RowBandPlan::Band> &bands = plan.GetBands();
+	ASSERT(bands.size() == 3);
+	EXPECT(bands[0].is_keep);
+	EXPECT_EQ(bands[0].size, 1000u);
+	EXPECT(!bands[1].is_keep);
+	EXPECT_EQ(bands[1].size, 3000u);
+	EXPECT(bands[2].is_keep);
+	EXPECT_EQ(bands[2].dst_offset, 1000u);
+	EXPECT_EQ(CheckBands(plan, 100), 0);
+}
+
+TEST(RowBandPlanStride)
+{
+	// Stride counts from the start of each range, not from row 0
+	const RowBandPlan::Range ranges[] = {{3, 7}, {20, 4}};
+	RowBandPlan plan;
+	EXPECT(plan.Build(10, 30, ranges, 2, 3));
+	const Uint expect[] = {3, 6, 9, 20, 23};
+	ASSERT(plan.GetRowCount() == 5);
+	for (Uint i = 0; i < 5; ++i)
+	{
+		EXPECT_EQ(plan.GetSourceRow(i), expect[i]);
+	}
+	EXPECT_EQ(plan.GetWindowStart(), 3u);
+	EXPECT_EQ(plan.GetWindowSize(), 21u);
+	// Alternating single kept rows and gaps
+	EXPECT_EQ(plan.GetBands().size(), 9u);
+	EXPECT_EQ(CheckBands(plan, 10), 0);
+
+	// 0 behaves as 1
+	RowBandPlan plan0;
+	EXPECT(plan0.Build(10, 30, ranges, 2, 0));
+	EXPECT_EQ(plan0.GetRowCount(), 11u);
+	EXPECT_EQ(CheckBands(plan0, 10), 0);
+}
+
+TEST(RowBandPlanRangePastFrame)
+{
+	const RowBandPlan::Range ranges[] = {{110, 50}, {200, 10}};
+	RowBandPlan plan;
+	EXPECT(plan.Build(64, 120, ranges, 2));
+	EXPECT_EQ(plan.GetWindowStart(), 110u);
+	EXPECT_EQ(plan.GetWindowSize(), 10u);
+	EXPECT_EQ(plan.GetRowCount(), 10u);
+	EXPECT_EQ(plan.GetSourceRow(9), 119u);
+	EXPECT_EQ(CheckBands(plan, 64), 0);
+}
+
+TEST(RowBandPlanFallback)
+{
+	// Nothing inside the frame, the whole frame is kept instead
+	const RowBandPlan::Range ranges[] = {{120, 10}, {5, 0}};
+	RowBandPlan plan;
+	EXPECT(!plan.Build(32, 120, ranges, 2));
+	EXPECT_EQ(plan.GetWindowStart(), 0u);
+	EXPECT_EQ(plan.GetRowCount(), 120u);
+	EXPECT_EQ(plan.GetBufferSize(), 32u * 120);
+	EXPECT_EQ(CheckBands(plan, 32), 0);
+
+	// Nor for an empty frame, where nothing could be kept at all
+	EXPECT(!plan.Build(32, 0, ranges, 2));
+	EXPECT_EQ(plan.GetRowCount(), 0u);
+	EXPECT_EQ(plan.GetBufferSize(), 0u);
+	EXPECT(plan.GetBands().empty());
+}
+
+TEST(RowBandPlanSplitLargeBand)
+{
+	// 752 * 480 bytes kept in one run, far beyond a single TCD
+	RowBandPlan plan;
+	EXPECT(plan.Build(752, 480, nullptr, 0));
+	const size_t size = 752u * 480;
+	const vector<RowBandPlan::Band> &bands = plan.GetBands();
+	const size_t expect_count = (size + RowBandPlan::kMaxBandSize - 1)
+			/ RowBandPlan::kMaxBandSize;
+	ASSERT(bands.size() == expect_count);
+	for (size_t i = 0; i + 1 < bands.size(); ++i)
+	{
+		EXPECT_EQ(bands[i].size, RowBandPlan::kMaxBandSize);
+	}
+	EXPECT_EQ(bands.back().size, size % RowBandPlan::kMaxBandSize);
+	EXPECT_EQ(CheckBands(plan, 752), 0);
+
+	// A large discarded run is split as well
+	const RowBandPlan::Range ranges[] = {{0, 1}, {479, 1}};
+	EXPECT(plan.Build(752, 480, ranges, 2));
+	size_t discard_count = 0;
+	for (const RowBandPlan::Band &b : plan.GetBands())
+	{
+		discard_count += !b.is_keep;
+	}
+	EXPECT_EQ(discard_count, (752u * 478 + RowBandPlan::kMaxBandSize - 1)
+			/ RowBandPlan::kMaxBandSize);
+	EXPECT_EQ(plan.GetBufferSize(), 752u * 2);
+	EXPECT_EQ(CheckBands(plan, 752), 0);
+}
+
+TEST(RowBandPlanRandom)
+{
+	test::SeedRand(23);
+	RowBandPlan plan;
+	int fail_count = 0;
+	for (int round = 0; round < 500; ++round)
+	{
+		const Uint w = 1 + test::Rand() % 400;
+		const Uint h = 1 + test::Rand() % 200;
+		const Uint stride = 1 + test::Rand() % 4;
+		vector<RowBandPlan::Range> ranges(test::Rand() % 5);
+		for (RowBandPlan::Range &r : ranges)
+		{
+			r.start = test::Rand() % (h + 20);
+			r.count = test::Rand() % 60;
+		}
+
+		const bool is_kept = plan.Build(w, h, ranges.data(), ranges.size(),
+				stride);
+		const vector<RowBandPlan::Range> whole{{0, static_cast<uint16_t>(h)}};
+		vector<Uint> rows = RefRows(h, ranges.empty() ? whole : ranges,
+				ranges.empty() ? 1 : stride);
+		if (rows.empty())
+		{
+			fail_count += is_kept;
+			rows = RefRows(h, whole, 1);
+		}
+		else
+		{
+			fail_count += !is_kept;
+		}
+
+		fail_count += (plan.GetRowCount() != rows.size());
+		for (Uint i = 0; i < rows.size() && i < plan.GetRowCount(); ++i)
+		{
+			fail_count += (plan.GetSourceRow(i) != rows[i]);
+		}
+		fail_count += (plan.GetBufferSize() != w * rows.size());
+		fail_count += CheckBands(plan, w);
+	}
+	EXPECT_EQ(fail_count, 0);
+}
@@ -0,0 +1,209 @@
+/*
+ * sc_studio_test.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <atomic>
+#include <new>
+
+#include "libbase/misc_types.h"
+#include "libsc/k60/uart_device.h"
+#include "libutil/sc_studio.h"
+
+#include "test.h"
+
+using libsc::k60::UartDevice;
+using libutil::ScStudio;
+
+namespace
+{
+
+std::atomic<size_t> g_alloc_count(0);
+
+}
+
+// Count every heap allocation made in the process
+void* operator new(size_t size)
+{
+	++g_alloc_count;
+	void *product = malloc(size ? size : 1);
+	if (!product)
+	{
+		throw std::bad_alloc();
+	}
+	return product;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+namespace
+{
+
+constexpr Byte kBegin = 0xDC;
+constexpr Byte kEnd = 0xCD;
+constexpr Byte kGraphToken = 4;
+constexpr Byte kStringToken = 1;
+
+/**
+ * Check that the frame at @a frame is a kGraph message of @a id and @a value,
+ * and return the pointer past it
+ */
+const Byte* ExpectGraphFrame(const Byte *frame, const uint8_t id,
+		const int32_t value)
+{
+	EXPECT_EQ(frame[0], kBegin);
+	EXPECT_EQ(frame[1], kGraphToken);
+	EXPECT_EQ(frame[2], 6);
+	EXPECT_EQ(frame[3], id);
+	EXPECT_EQ(frame[4], 0);
+	const uint32_t v = static_cast<uint32_t>(value);
+	EXPECT_EQ(frame[5], (Byte)(v >> 24));
+	EXPECT_EQ(frame[6], (Byte)(v >> 16));
+	EXPECT_EQ(frame[7], (Byte)(v >> 8));
+	EXPECT_EQ(frame[8], (Byte)v);
+	EXPECT_EQ(frame[9], kEnd);
+	return frame + 10;
+}
+
+}
+
+TEST(ScStudioPoolNoAllocation)
+{
+	UartDevice uart;
+	ScStudio studio;
+	studio.SetUart(&uart);
+	// Warm up
+	studio.SendGraph(0, 0);
+	uart.FinishTx();
+	uart.log_size = 0;
+
+	const size_t begin_count = g_alloc_count;
+	for (int i = 0; i < 300; ++i)
+	{
+		studio.SendGraph(i % 4, i);
+		if (i % 4 == 3)
+		{
+			uart.FinishTx();
+		}
+	}
+	studio.SendString("hello", 5);
+	uart.FinishTx();
+	EXPECT_EQ(g_alloc_count - begin_count, 0u);
+
+	const Byte *it = uart.log;
+	for (int i = 0; i < 300; ++i)
+	{
+		it = ExpectGraphFrame(it, i % 4, i);
+	}
+	EXPECT_EQ(it[0], kBegin);
+	EXPECT_EQ(it[1], kStringToken);
+	EXPECT_EQ(it[2], 5);
+	EXPECT(memcmp(it + 3, "hello", 5) == 0);
+	EXPECT_EQ(it[8], kEnd);
+	EXPECT_EQ(uart.log_size, (size_t)(it + 9 - uart.log));
+}
+
+TEST(ScStudioPoolDropWhileBusy)
+{
+	UartDevice uart;
+	ScStudio studio;
+	studio.SetUart(&uart);
+	Byte pool[25];
+	studio.SetTxPool(pool, sizeof(pool));
+
+	// Only two 10-byte frames fit, and the pool must not be rewound before
+	// Tx turns idle
+	studio.SendGraph(1, 100);
+	studio.SendGraph(2, 200);
+	studio.SendGraph(3, 300);
+	uart.FinishTx();
+	EXPECT_EQ(uart.send_count, 2u);
+	const Byte *it = ExpectGraphFrame(uart.log, 1, 100);
+	it = ExpectGraphFrame(it, 2, 200);
+
+	studio.SendGraph(4, -400);
+	uart.FinishTx();
+	EXPECT_EQ(uart.send_count, 3u);
+	ExpectGraphFrame(it, 4, -400);
+}
+
+TEST(ScStudioPoolLargeFrame)
+{
+	UartDevice uart;
+	ScStudio studio;
+	studio.SetUart(&uart);
+	Byte pool[16];
+	studio.SetTxPool(pool, sizeof(pool));
+
+	// Larger than the whole pool, sent from a one-off buffer
+	char str[200];
+	for (size_t i = 0; i < sizeof(str); ++i)
+	{
+		str[i] = 'a' + i % 26;
+	}
+	const size_t begin_count = g_alloc_count;
+	studio.SendString(str, sizeof(str));
+	EXPECT_EQ(g_alloc_count - begin_count, 1u);
+	EXPECT_EQ(uart.send_count, 1u);
+	// 200 takes two bytes in varint
+	ASSERT(uart.log_size == sizeof(str) + 5);
+	EXPECT_EQ(uart.log[0], kBegin);
+	EXPECT_EQ(uart.log[1], kStringToken);
+	EXPECT_EQ(uart.log[2], (200 & 0x7F) | 0x80);
+	EXPECT_EQ(uart.log[3], 200 >> 7);
+	EXPECT(memcmp(uart.log + 4, str, sizeof(str)) == 0);
+	EXPECT_EQ(uart.log[sizeof(str) + 4], kEnd);
+}
+
+TEST(ScStudioRingNoAllocation)
+{
+	UartDevice uart;
+	uart.is_tx_ring = true;
+	ScStudio studio;
+	studio.SetUart(&uart);
+
+	const size_t begin_count = g_alloc_count;
+	for (int i = 0; i < 100; ++i)
+	{
+		studio.SendGraph(i % 8, -i);
+	}
+	EXPECT_EQ(g_alloc_count - begin_count, 0u);
+	EXPECT_EQ(uart.send_count, 100u);
+
+	const Byte *it = uart.log;
+	for (int i = 0; i < 100; ++i)
+	{
+		it = ExpectGraphFrame(it, i % 8, -i);
+	}
+}
@@ -0,0 +1,324 @@
+/*
+ * spsc_ring_buffer_test.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "libutil/spsc_ring_buffer.h"
+
+#include "test.h"
+
+using libutil::SpscRingBuffer;
+
+namespace
+{
+
+/**
+ * Not default constructible, keeps count of the live objects such that leaks
+ * and double destructions are visible
+ */
+class Item
+{
+public:
+	explicit Item(const uint32_t val)
+			: m_val(val),
+			  m_check(~val)
+	{
+		++g_live;
+	}
+
+	Item(const Item &rhs)
+			: m_val(rhs.m_val),
+			  m_check(rhs.m_check)
+	{
+		++g_live;
+	}
+
+	Item& operator=(const Item&) = default;
+
+	~Item()
+	{
+		--g_live;
+		// Poison such that a use after destruction fails IsValid()
+		m_check = m_val;
+	}
+
+	uint32_t GetVal() const
+	{
+		return m_val;
+	}
+
+	bool IsValid() const
+	{
+		return (m_check == ~m_val);
+	}
+
+	static std::atomic<int> g_live;
+
+private:
+	uint32_t m_val;
+	uint32_t m_check;
+};
+
+std::atomic<int> Item::g_live(0);
+
+/// Per thread generator, test::Rand() is not meant to be shared
+uint32_t NextRand(uint32_t *state)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+}
+
+TEST(SpscRingBufferPushPop)
+{
+	SpscRingBuffer<int, 4> rb;
+	EXPECT(rb.IsEmpty());
+	EXPECT(rb.Front() == nullptr);
+	EXPECT(!rb.Pop());
+	for (int i = 0; i < 4; ++i)
+	{
+		EXPECT(rb.Push(i));
+	}
+	EXPECT(rb.IsFull());
+	EXPECT(!rb.Push(4));
+	int val = -1;
+	EXPECT(rb.Pop(&val));
+	EXPECT_EQ(val, 0);
+	EXPECT_EQ(*rb.Front(), 1);
+	EXPECT_EQ(rb.GetSize(), 3u);
+}
+
+TEST(SpscRingBufferPushNPopNWrap)
+{
+	SpscRingBuffer<int, 8> rb;
+	int next_push = 0;
+	int next_pop = 0;
+	// Odd sized chunks move the indices across the end of the storage in
+	// every possible phase
+	for (int round = 0; round < 64; ++round)
+	{
+		const size_t push_size = 1 + round % 5;
+		int data[5];
+		for (size_t i = 0; i < push_size; ++i)
+		{
+			data[i] = next_push + i;
+		}
+		const size_t space = rb.GetCapacity() - rb.GetSize();
+		const size_t pushed = rb.PushN(data, push_size);
+		EXPECT_EQ(pushed, (push_size < space) ? push_size : space);
+		next_push += pushed;
+
+		int out[3];
+		const size_t popped = rb.PopN(out, 1 + round % 3);
+		for (size_t i = 0; i < popped; ++i)
+		{
+			EXPECT_EQ(out[i], next_pop);
+			++next_pop;
+		}
+		EXPECT_EQ(rb.GetSize(), static_cast<size_t>(next_push - next_pop));
+	}
+	int out[8];
+	const size_t popped = rb.PopN(out, 8);
+	for (size_t i = 0; i < popped; ++i)
+	{
+		EXPECT_EQ(out[i], next_pop);
+		++next_pop;
+	}
+	EXPECT_EQ(next_pop, next_push);
+	EXPECT(rb.IsEmpty());
+	EXPECT_EQ(rb.PopN(out, 8), 0u);
+}
+
+TEST(SpscRingBufferReadableSplitsAtWrap)
+{
+	SpscRingBuffer<int, 8> rb;
+	for (int i = 0; i < 6; ++i)
+	{
+		rb.Push(i);
+	}
+	rb.Consume(6);
+	const int data[] = {10, 11, 12, 13, 14};
+	EXPECT_EQ(rb.PushN(data, 5), 5u);
+
+	// 2 elements before the end of the storage, the other 3 after
+	size_t size = 0;
+	const int *span = rb.GetReadable(&size);
+	ASSERT(size == 2);
+	EXPECT_EQ(span[0], 10);
+	EXPECT_EQ(span[1], 11);
+	rb.Consume(size);
+
+	span = rb.GetReadable(&size);
+	ASSERT(size == 3);
+	EXPECT_EQ(span[0], 12);
+	EXPECT_EQ(span[2], 14);
+	rb.Consume(1);
+	span = rb.GetReadable(&size);
+	EXPECT_EQ(size, 2u);
+	EXPECT_EQ(span[0], 13);
+	rb.Consume(size);
+
+	rb.GetReadable(&size);
+	EXPECT_EQ(size, 0u);
+}
+
+TEST(SpscRingBufferNonDefaultConstructible)
+{
+	{
+		SpscRingBuffer<Item, 4> rb;
+		EXPECT_EQ(Item::g_live.load(), 0);
+		EXPECT(rb.Emplace(1u));
+		EXPECT(rb.Push(Item(2)));
+		const Item items[] = {Item(3), Item(4), Item(5)};
+		EXPECT_EQ(rb.PushN(items, 3), 2u);
+		// 3 locals + 4 in the buffer
+		EXPECT_EQ(Item::g_live.load(), 7);
+
+		Item out[] = {Item(0), Item(0)};
+		EXPECT_EQ(rb.PopN(out, 2), 2u);
+		EXPECT_EQ(out[0].GetVal(), 1u);
+		EXPECT_EQ(out[1].GetVal(), 2u);
+		EXPECT_EQ(Item::g_live.load(), 7);
+
+		// Wrap with in place construction
+		EXPECT(rb.Emplace(6u));
+		EXPECT(rb.Emplace(7u));
+		EXPECT(!rb.Emplace(8u));
+		size_t size = 0;
+		const Item *span = rb.GetReadable(&size);
+		ASSERT(size == 2);
+		EXPECT_EQ(span[0].GetVal(), 3u);
+		EXPECT(span[1].IsValid());
+		rb.Consume(size);
+		span = rb.GetReadable(&size);
+		ASSERT(size == 2);
+		EXPECT_EQ(span[0].GetVal(), 6u);
+		EXPECT_EQ(span[1].GetVal(), 7u);
+		EXPECT_EQ(Item::g_live.load(), 7);
+		// Leave them to the destructor
+	}
+	EXPECT_EQ(Item::g_live.load(), 0);
+}
+
+TEST(SpscRingBufferMoveOnly)
+{
+	SpscRingBuffer<std::unique_ptr<int>, 2> rb;
+	EXPECT(rb.Push(std::unique_ptr<int>(new int(42))));
+	EXPECT(rb.Emplace(new int(43)));
+	std::unique_ptr<int> out;
+	EXPECT(rb.Pop(&out));
+	EXPECT_EQ(*out, 42);
+	EXPECT_EQ(**rb.Front(), 43);
+	EXPECT(rb.Pop());
+	EXPECT(rb.IsEmpty());
+}
+
+TEST(SpscRingBufferTwoThreads)
+{
+	// The producer pushes a running sequence with a random mix of Emplace and
+	// PushN, the consumer takes it back with a random mix of Pop, PopN and
+	// GetReadable + Consume. The small capacity keeps both sides racing on
+	// the wrap
+	constexpr uint32_t kItemCount = 300000;
+	SpscRingBuffer<Item, 16> rb;
+
+	std::thread producer([&]()
+			{
+				uint32_t state = 1;
+				uint32_t seq = 0;
+				std::vector<Item> chunk;
+				while (seq < kItemCount)
+				{
+					const uint32_t r = NextRand(&state);
+					bool is_progress;
+					if (r & 1)
+					{
+						is_progress = rb.Emplace(seq);
+						seq += is_progress;
+					}
+					else
+					{
+						chunk.clear();
+						const uint32_t n = 1 + (r >> 1) % 12;
+						for (uint32_t i = 0; i < n && seq + i < kItemCount;
+								++i)
+						{
+							chunk.push_back(Item(seq + i));
+						}
+						const size_t pushed = rb.PushN(chunk.data(),
+								chunk.size());
+						seq += pushed;
+						is_progress = (pushed > 0);
+					}
+					if (!is_progress)
+					{
+						std::this_thread::yield();
+					}
+				}
+			});
+
+	uint32_t state = 2;
+	uint32_t expect = 0;
+	int bad_count = 0;
+	std::vector<Item> out(12, Item(0));
+	while (expect < kItemCount)
+	{
+		size_t count = 0;
+		switch (NextRand(&state) % 3)
+		{
+		case 0:
+			if (const Item *front = rb.Front())
+			{
+				bad_count += (!front->IsValid() || front->GetVal() != expect);
+				rb.Pop();
+				count = 1;
+			}
+			break;
+
+		case 1:
+			count = rb.PopN(out.data(), out.size());
+			for (size_t i = 0; i < count; ++i)
+			{
+				bad_count += (!out[i].IsValid()
+						|| out[i].GetVal() != expect + i);
+			}
+			break;
+
+		case 2:
+			{
+				const Item *span = rb.GetReadable(&count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					bad_count += (!span[i].IsValid()
+							|| span[i].GetVal() != expect + i);
+				}
+				rb.Consume(count);
+			}
+			break;
+		}
+		expect += count;
+		if (!count)
+		{
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+
+	EXPECT_EQ(bad_count, 0);
+	EXPECT_EQ(expect, kItemCount);
+	EXPECT(rb.IsEmpty());
+	// Only the consumer's scratch is still alive
+	EXPECT_EQ(Item::g_live.load(), static_cast<int>(out.size()));
+}
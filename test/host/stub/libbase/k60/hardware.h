@@ -0,0 +1,12 @@
+/*
+ * hardware.h
+ * Host stand-in of the K60 register definitions, which are not available
+ * off target. Modules only including it for optional features (e.g., DWT
+ * profiling) build against this instead
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
@@ -0,0 +1,21 @@
+/*
+ * uart.h
+ * Host stand-in of libbase::k60::Uart, only declared for the headers that
+ * include it
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+namespace libbase
+{
+namespace k60
+{
+
+class Uart;
+
+}
+}
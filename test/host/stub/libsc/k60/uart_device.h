@@ -0,0 +1,147 @@
+/*
+ * uart_device.h
+ * Host stand-in of libsc::k60::UartDevice. Data sent are appended to a fixed
+ * log instead, without allocating, and Tx only turns idle when told to
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <memory>
+#include <vector>
+
+#include "libbase/delegate.h"
+#include "libbase/misc_types.h"
+
+namespace libsc
+{
+namespace k60
+{
+
+class UartDevice
+{
+public:
+	typedef libbase::Delegate<bool(const Byte *data, const size_t size)>
+			OnReceiveListener;
+
+	static constexpr size_t kLogSize = 4096;
+	static constexpr size_t kMaxNoCopy = 64;
+
+	UartDevice()
+			: is_tx_ring(false),
+			  is_tx_idle(true),
+			  is_tx_full(false),
+			  is_reserved(false),
+			  log_size(0),
+			  send_count(0),
+			  no_copy_count(0)
+	{}
+
+	bool SendBuffer(const Byte *buf, const size_t len)
+	{
+		return Log(buf, len);
+	}
+
+	bool SendBuffer(std::unique_ptr<Byte[]> &&buf, const size_t len)
+	{
+		return Log(buf.get(), len);
+	}
+
+	bool SendBuffer(std::vector<Byte> &&buf)
+	{
+		return Log(buf.data(), buf.size());
+	}
+
+	bool SendBufferNoCopy(const Byte *buf, const size_t len)
+	{
+		if (no_copy_count == kMaxNoCopy)
+		{
+			return false;
+		}
+		// Only logged once Tx turns idle, to catch buffers reused too early
+		no_copy_bufs[no_copy_count] = buf;
+		no_copy_sizes[no_copy_count] = len;
+		++no_copy_count;
+		is_tx_idle = false;
+		return true;
+	}
+
+	bool IsTxIdle() const
+	{
+		return is_tx_idle;
+	}
+
+	Byte* ReserveTx(const size_t size)
+	{
+		if (!is_tx_ring || is_reserved || log_size + size > kLogSize)
+		{
+			return nullptr;
+		}
+		is_reserved = true;
+		return log + log_size;
+	}
+
+	void CommitTx(const size_t size)
+	{
+		if (is_reserved)
+		{
+			is_reserved = false;
+			log_size += size;
+			++send_count;
+		}
+	}
+
+	bool IsTxRingEnabled() const
+	{
+		return is_tx_ring;
+	}
+
+	/**
+	 * Log the buffers queued by SendBufferNoCopy() and turn Tx idle
+	 */
+	void FinishTx()
+	{
+		for (size_t i = 0; i < no_copy_count; ++i)
+		{
+			Log(no_copy_bufs[i], no_copy_sizes[i]);
+		}
+		no_copy_count = 0;
+		is_tx_idle = true;
+	}
+
+	bool is_tx_ring;
+	bool is_tx_idle;
+	/// Reject everything sent
+	bool is_tx_full;
+	bool is_reserved;
+	Byte log[kLogSize];
+	size_t log_size;
+	size_t send_count;
+
+private:
+	bool Log(const Byte *buf, const size_t len)
+	{
+		if (is_tx_full || log_size + len > kLogSize)
+		{
+			return false;
+		}
+		memcpy(log + log_size, buf, len);
+		log_size += len;
+		++send_count;
+		return true;
+	}
+
+	const Byte *no_copy_bufs[kMaxNoCopy];
+	size_t no_copy_sizes[kMaxNoCopy];
+	size_t no_copy_count;
+};
+
+}
+}
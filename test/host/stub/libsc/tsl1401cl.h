@@ -0,0 +1,22 @@
+/*
+ * tsl1401cl.h
+ * Host stand-in of libsc::Tsl1401cl, with only the constants used by other
+ * modules
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+namespace libsc
+{
+
+class Tsl1401cl
+{
+public:
+	static constexpr int kSensorW = 128;
+};
+
+}
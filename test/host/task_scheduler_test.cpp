@@ -0,0 +1,327 @@
+/*
+ * task_scheduler_test.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libutil/task_scheduler.h"
+
+#include "test.h"
+
+using libutil::TaskScheduler;
+
+namespace
+{
+
+typedef TaskScheduler::RepeatMode RepeatMode;
+typedef TaskScheduler::TaskId TaskId;
+
+/**
+ * Record the order in which the tasks are called
+ */
+struct CallLog
+{
+	void Push(const int tag, const uint32_t actual)
+	{
+		if (size < kCapacity)
+		{
+			tags[size] = tag;
+			actuals[size] = actual;
+			++size;
+		}
+	}
+
+	static constexpr size_t kCapacity = 64;
+	int tags[kCapacity];
+	uint32_t actuals[kCapacity];
+	size_t size = 0;
+};
+
+TaskScheduler::Callback Tag(CallLog *log, const int tag)
+{
+	return [log, tag](const uint32_t, const uint32_t actual)
+			{
+				log->Push(tag, actual);
+			};
+}
+
+uint16_t GetSlot(const TaskId id)
+{
+	return id & 0xFFFF;
+}
+
+}
+
+TEST(TaskSchedulerPriorityInSameTick)
+{
+	TaskScheduler scheduler(8);
+	CallLog log;
+	scheduler.Add(0, 5, Tag(&log, 200), RepeatMode::kOnce, 200);
+	scheduler.Add(0, 5, Tag(&log, 10), RepeatMode::kOnce, 10);
+	scheduler.Add(0, 5, Tag(&log, 128), RepeatMode::kOnce);
+	// Same priority, called in the order they are added
+	scheduler.Add(0, 5, Tag(&log, 11), RepeatMode::kOnce, 10);
+
+	EXPECT(!scheduler.IsDue(4));
+	scheduler.Run(4);
+	EXPECT_EQ(log.size, 0u);
+	EXPECT(scheduler.IsDue(5));
+	scheduler.Run(5);
+	ASSERT(log.size == 4);
+	EXPECT_EQ(log.tags[0], 10);
+	EXPECT_EQ(log.tags[1], 11);
+	EXPECT_EQ(log.tags[2], 128);
+	EXPECT_EQ(log.tags[3], 200);
+	EXPECT_EQ(scheduler.GetSize(), 0u);
+}
+
+TEST(TaskSchedulerPriorityBeforeDue)
+{
+	TaskScheduler scheduler(8);
+	CallLog log;
+	// Both due by the time Run() is called, priority comes first
+	scheduler.Add(0, 3, Tag(&log, 1), RepeatMode::kOnce, 100);
+	scheduler.Add(0, 6, Tag(&log, 2), RepeatMode::kOnce, 50);
+	// Same priority, the earlier due first
+	scheduler.Add(0, 5, Tag(&log, 3), RepeatMode::kOnce, 100);
+	scheduler.Add(0, 4, Tag(&log, 4), RepeatMode::kOnce, 100);
+
+	scheduler.Run(10);
+	ASSERT(log.size == 4);
+	EXPECT_EQ(log.tags[0], 2);
+	EXPECT_EQ(log.tags[1], 1);
+	EXPECT_EQ(log.tags[2], 4);
+	EXPECT_EQ(log.tags[3], 3);
+}
+
+TEST(TaskSchedulerPreciseCatchUp)
+{
+	TaskScheduler scheduler(4);
+	CallLog log;
+	scheduler.Add(0, 10, Tag(&log, 0), RepeatMode::kPrecise);
+
+	// 15 ticks late, only called once per Run()
+	scheduler.Run(25);
+	ASSERT(log.size == 1);
+	EXPECT_EQ(log.actuals[0], 25u);
+	// Due at 20 already, catch up on the next run
+	EXPECT(scheduler.IsDue(25));
+	scheduler.Run(26);
+	ASSERT(log.size == 2);
+	EXPECT_EQ(log.actuals[1], 16u);
+	// Back on the original grid
+	EXPECT(!scheduler.IsDue(29));
+	EXPECT(scheduler.IsDue(30));
+	scheduler.Run(30);
+	ASSERT(log.size == 3);
+	EXPECT_EQ(log.actuals[2], 10u);
+}
+
+TEST(TaskSchedulerLooseNoCatchUp)
+{
+	TaskScheduler scheduler(4);
+	CallLog log;
+	scheduler.Add(0, 10, Tag(&log, 0), RepeatMode::kLoose);
+
+	scheduler.Run(25);
+	ASSERT(log.size == 1);
+	EXPECT_EQ(log.actuals[0], 25u);
+	// Rescheduled a whole period after the late run
+	EXPECT(!scheduler.IsDue(34));
+	EXPECT(scheduler.IsDue(35));
+	scheduler.Run(36);
+	ASSERT(log.size == 2);
+	EXPECT_EQ(log.actuals[1], 11u);
+	EXPECT(!scheduler.IsDue(45));
+}
+
+TEST(TaskSchedulerUnitShift)
+{
+	TaskScheduler scheduler(4);
+	uint32_t request = 0;
+	uint32_t actual = 0;
+	scheduler.Add(0, 16, [&request, &actual](const uint32_t r,
+			const uint32_t a)
+			{
+				request = r;
+				actual = a;
+			}, RepeatMode::kOnce, TaskScheduler::kDefaultPriority, 3);
+	scheduler.Run(24);
+	EXPECT_EQ(request, 2u);
+	EXPECT_EQ(actual, 3u);
+}
+
+TEST(TaskSchedulerCancelSelf)
+{
+	TaskScheduler scheduler(2);
+	int count = 0;
+	TaskId id = TaskScheduler::kInvalidTask;
+	TaskScheduler *s = &scheduler;
+	id = scheduler.Add(0, 1, [s, &id, &count](const uint32_t, const uint32_t)
+			{
+				if (++count == 3)
+				{
+					EXPECT(s->Cancel(id));
+					// Already cancelled
+					EXPECT(!s->Cancel(id));
+				}
+			}, RepeatMode::kPrecise);
+
+	for (uint32_t t = 1; t <= 10; ++t)
+	{
+		scheduler.Run(t);
+	}
+	EXPECT_EQ(count, 3);
+	EXPECT_EQ(scheduler.GetSize(), 0u);
+	EXPECT(!scheduler.IsDue(100));
+
+	// The slot is reused, and the stale ID doesn't cancel the new task
+	CallLog log;
+	const TaskId new_id = scheduler.Add(10, 1, Tag(&log, 1),
+			RepeatMode::kOnce);
+	EXPECT_EQ(GetSlot(new_id), GetSlot(id));
+	EXPECT(new_id != id);
+	EXPECT(!scheduler.Cancel(id));
+	scheduler.Run(11);
+	EXPECT_EQ(log.size, 1u);
+}
+
+TEST(TaskSchedulerCancelReadyTask)
+{
+	TaskScheduler scheduler(4);
+	CallLog log;
+	TaskScheduler *s = &scheduler;
+	TaskId victim = TaskScheduler::kInvalidTask;
+	TaskId added = TaskScheduler::kInvalidTask;
+	CallLog *l = &log;
+	scheduler.Add(0, 5, [s, l, &victim, &added](const uint32_t,
+			const uint32_t)
+			{
+				l->Push(1, 0);
+				EXPECT(s->Cancel(victim));
+				// Takes over the slot just freed, yet must not be run in
+				// this Run() even though it's already due
+				added = s->Add(5, 0, Tag(l, 3), RepeatMode::kOnce, 0);
+			}, RepeatMode::kOnce, 10);
+	victim = scheduler.Add(0, 5, Tag(&log, 2), RepeatMode::kOnce, 20);
+
+	scheduler.Run(5);
+	ASSERT(log.size == 1);
+	EXPECT_EQ(log.tags[0], 1);
+	EXPECT_EQ(GetSlot(added), GetSlot(victim));
+	EXPECT_EQ(scheduler.GetSize(), 1u);
+
+	scheduler.Run(6);
+	ASSERT(log.size == 2);
+	EXPECT_EQ(log.tags[1], 3);
+	EXPECT_EQ(scheduler.GetSize(), 0u);
+}
+
+TEST(TaskSchedulerFull)
+{
+	TaskScheduler scheduler(2);
+	CallLog log;
+	EXPECT(scheduler.Add(0, 1, Tag(&log, 0), RepeatMode::kOnce) >= 0);
+	EXPECT(scheduler.Add(0, 1, Tag(&log, 1), RepeatMode::kOnce) >= 0);
+	EXPECT_EQ(scheduler.GetSize(), 2u);
+	scheduler.Run(1);
+	EXPECT_EQ(log.size, 2u);
+	EXPECT(scheduler.Add(1, 1, Tag(&log, 2), RepeatMode::kOnce) >= 0);
+}
+
+TEST(TaskSchedulerTickWrap)
+{
+	TaskScheduler scheduler(4);
+	CallLog log;
+	const uint32_t now = 0xFFFFFFF0;
+	// Due at 0xFFFFFFF8 and, past the wrap, 0x8
+	scheduler.Add(now, 0x18, Tag(&log, 2), RepeatMode::kOnce, 0);
+	scheduler.Add(now, 0x8, Tag(&log, 1), RepeatMode::kOnce, 200);
+
+	EXPECT(!scheduler.IsDue(0xFFFFFFF7));
+	scheduler.Run(0xFFFFFFF8);
+	ASSERT(log.size == 1);
+	EXPECT_EQ(log.tags[0], 1);
+	EXPECT(!scheduler.IsDue(0xFFFFFFFF));
+	EXPECT(!scheduler.IsDue(0x7));
+	scheduler.Run(0x8);
+	ASSERT(log.size == 2);
+	EXPECT_EQ(log.tags[1], 2);
+	EXPECT_EQ(log.actuals[1], 0x18u);
+}
+
+TEST(TaskSchedulerPeriodicAcrossWrap)
+{
+	TaskScheduler scheduler(4);
+	CallLog log;
+	uint32_t now = 0xFFFFFF00;
+	scheduler.Add(now, 0x40, Tag(&log, 0), RepeatMode::kPrecise);
+	for (int i = 0; i < 0x200; ++i)
+	{
+		++now;
+		scheduler.Run(now);
+	}
+	// 0x200 ticks with a period of 0x40
+	ASSERT(log.size == 8);
+	for (size_t i = 0; i < log.size; ++i)
+	{
+		EXPECT_EQ(log.actuals[i], 0x40u);
+	}
+}
+
+TEST(TaskSchedulerRandomOrder)
+{
+	// Compare against a brute force pick of the next task
+	static constexpr size_t kCount = 32;
+	TaskScheduler scheduler(kCount);
+	uint32_t dues[kCount];
+	uint8_t priorities[kCount];
+	CallLog log;
+	const uint32_t begin = 0xFFFFFF80;
+	for (size_t i = 0; i < kCount; ++i)
+	{
+		dues[i] = begin + test::Rand() % 0x100;
+		priorities[i] = test::Rand() % 4;
+		scheduler.Add(begin, dues[i] - begin, Tag(&log, i), RepeatMode::kOnce,
+				priorities[i]);
+	}
+
+	bool is_done[kCount] = {};
+	uint32_t now = begin;
+	size_t checked = 0;
+	for (int t = 0; t <= 0x100; ++t, ++now)
+	{
+		log.size = 0;
+		scheduler.Run(now);
+		for (size_t j = 0; j < log.size; ++j)
+		{
+			// Expected: among the due ones not yet run, the smallest
+			// (priority, due, index)
+			int best = -1;
+			for (size_t i = 0; i < kCount; ++i)
+			{
+				if (is_done[i] || (int32_t)(now - dues[i]) < 0)
+				{
+					continue;
+				}
+				if (best < 0 || priorities[i] < priorities[best]
+						|| (priorities[i] == priorities[best]
+								&& (int32_t)(dues[i] - dues[best]) < 0))
+				{
+					best = i;
+				}
+			}
+			ASSERT(best >= 0);
+			EXPECT_EQ(log.tags[j], best);
+			is_done[best] = true;
+			++checked;
+		}
+	}
+	EXPECT_EQ(checked, kCount);
+	EXPECT_EQ(scheduler.GetSize(), 0u);
+}
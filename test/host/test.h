@@ -0,0 +1,71 @@
+/*
+ * test.h
+ * Minimal unit test harness for the hardware independent parts of libutil,
+ * built and run on PC
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+namespace test
+{
+
+typedef void (*TestFunc)();
+
+/**
+ * Register a test case at static initialization time, use TEST() instead
+ */
+class Registrar
+{
+public:
+	Registrar(const char *name, TestFunc func);
+};
+
+/**
+ * Record a failed expectation, the test case continues to run
+ */
+void Fail(const char *file, const int line, const char *expr);
+
+/**
+ * Return a pseudo random number, deterministic across runs
+ */
+uint32_t Rand();
+void SeedRand(const uint32_t seed);
+
+}
+
+#define TEST(name) \
+	static void name(); \
+	static test::Registrar name##_registrar(#name, &name); \
+	static void name()
+
+#define EXPECT(expr) \
+	do \
+	{ \
+		if (!(expr)) \
+		{ \
+			test::Fail(__FILE__, __LINE__, #expr); \
+		} \
+	} while (false)
+
+#define EXPECT_EQ(a, b) EXPECT((a) == (b))
+
+/**
+ * Return from the test case if @a expr fails, for conditions that the rest
+ * of the case depends on
+ */
+#define ASSERT(expr) \
+	do \
+	{ \
+		if (!(expr)) \
+		{ \
+			test::Fail(__FILE__, __LINE__, #expr); \
+			return; \
+		} \
+	} while (false)
@@ -0,0 +1,96 @@
+/*
+ * test_main.cpp
+ * Run every registered host test case, or only those whose names contain the
+ * first argument
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <vector>
+
+#include "test.h"
+
+namespace test
+{
+
+namespace
+{
+
+struct TestCase
+{
+	const char *name;
+	TestFunc func;
+};
+
+std::vector<TestCase>& GetCases()
+{
+	static std::vector<TestCase> cases;
+	return cases;
+}
+
+int g_fail_count = 0;
+uint32_t g_rand = 1;
+
+}
+
+Registrar::Registrar(const char *name, TestFunc func)
+{
+	GetCases().push_back({name, func});
+}
+
+void Fail(const char *file, const int line, const char *expr)
+{
+	printf("  %s:%d: failed: %s\n", file, line, expr);
+	++g_fail_count;
+}
+
+uint32_t Rand()
+{
+	// xorshift32
+	g_rand ^= g_rand << 13;
+	g_rand ^= g_rand >> 17;
+	g_rand ^= g_rand << 5;
+	return g_rand;
+}
+
+void SeedRand(const uint32_t seed)
+{
+	g_rand = seed ? seed : 1;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	const char *filter = (argc > 1) ? argv[1] : nullptr;
+	int case_count = 0;
+	int failed_case_count = 0;
+	for (const test::TestCase &c : test::GetCases())
+	{
+		if (filter && !strstr(c.name, filter))
+		{
+			continue;
+		}
+		const int prev_fail_count = test::g_fail_count;
+		test::SeedRand(1);
+		c.func();
+		++case_count;
+		if (test::g_fail_count != prev_fail_count)
+		{
+			printf("FAIL %s\n", c.name);
+			++failed_case_count;
+		}
+		else
+		{
+			printf("ok   %s\n", c.name);
+		}
+	}
+	printf("%d/%d passed\n", case_count - failed_case_count, case_count);
+	return failed_case_count ? 1 : 0;
+}
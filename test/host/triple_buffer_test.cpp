@@ -0,0 +1,178 @@
+/*
+ * triple_buffer_test.cpp
+ *
+ * Author: Ming Tsang
+ * Copyright (c) 2014-2015 HKUST SmartCar Team
+ * Refer to LICENSE for details
+ */
+
+#include <cstdint>
+
+#include <atomic>
+#include <thread>
+
+#include "libutil/triple_buffer.h"
+
+#include "test.h"
+
+using libutil::TripleBuffer;
+
+namespace
+{
+
+bool IsDistinct(const TripleBuffer &tb, const uint8_t latest)
+{
+	const uint8_t w = tb.GetWriteIndex();
+	const uint8_t r = tb.GetReadIndex();
+	return (w < 3 && r < 3 && latest < 3 && w != r && w != latest
+			&& r != latest);
+}
+
+}
+
+TEST(TripleBufferInitialState)
+{
+	TripleBuffer tb;
+	EXPECT(!tb.HasNew());
+	const uint8_t read = tb.GetReadIndex();
+	// Nothing published yet, the consumer keeps its buffer
+	EXPECT_EQ(tb.Acquire(), read);
+	EXPECT(tb.GetWriteIndex() != read);
+}
+
+TEST(TripleBufferPublishAcquire)
+{
+	TripleBuffer tb;
+	const uint8_t written = tb.GetWriteIndex();
+	EXPECT(!tb.Publish());
+	EXPECT(tb.HasNew());
+	EXPECT(tb.GetWriteIndex() != written);
+	EXPECT_EQ(tb.Acquire(), written);
+	EXPECT(!tb.HasNew());
+	// No newer one, stay on the same buffer
+	EXPECT_EQ(tb.Acquire(), written);
+}
+
+TEST(TripleBufferDropUnread)
+{
+	TripleBuffer tb;
+	const uint8_t first = tb.GetWriteIndex();
+	EXPECT(!tb.Publish());
+	const uint8_t second = tb.GetWriteIndex();
+	// The first one is replaced before being acquired
+	EXPECT(tb.Publish());
+	EXPECT(tb.GetWriteIndex() == first);
+	EXPECT_EQ(tb.Acquire(), second);
+}
+
+TEST(TripleBufferIndicesStayDistinct)
+{
+	// Random interleaving of both sides, tracking the latest index with a
+	// model. The producer must never be handed the buffer being read
+	TripleBuffer tb;
+	uint8_t latest = 3 - tb.GetWriteIndex() - tb.GetReadIndex();
+	bool has_new = false;
+	for (int i = 0; i < 100000; ++i)
+	{
+		if (test::Rand() & 1)
+		{
+			const uint8_t written = tb.GetWriteIndex();
+			EXPECT_EQ(tb.Publish(), has_new);
+			EXPECT_EQ(tb.GetWriteIndex(), latest);
+			latest = written;
+			has_new = true;
+		}
+		else
+		{
+			const uint8_t read = tb.Acquire();
+			if (has_new)
+			{
+				const uint8_t prev_latest = latest;
+				latest = 3 - tb.GetWriteIndex() - read;
+				EXPECT_EQ(read, prev_latest);
+			}
+			has_new = false;
+		}
+		EXPECT_EQ(tb.HasNew(), has_new);
+		ASSERT(IsDistinct(tb, latest));
+	}
+}
+
+TEST(TripleBufferReset)
+{
+	TripleBuffer tb;
+	TripleBuffer fresh;
+	tb.Publish();
+	tb.Acquire();
+	tb.Publish();
+	tb.Reset();
+	EXPECT(!tb.HasNew());
+	EXPECT_EQ(tb.GetWriteIndex(), fresh.GetWriteIndex());
+	EXPECT_EQ(tb.GetReadIndex(), fresh.GetReadIndex());
+}
+
+TEST(TripleBufferTwoThreads)
+{
+	// The producer fills a whole buffer with a sequence number before
+	// publishing it. The consumer must never see a torn buffer, nor one
+	// older than what it has already seen
+	constexpr int kFrameCount = 200000;
+	constexpr int kFrameSize = 64;
+	static uint32_t buffers[3][kFrameSize];
+	TripleBuffer tb;
+	std::atomic<bool> is_done(false);
+
+	std::thread producer([&]()
+			{
+				for (uint32_t seq = 1; seq <= kFrameCount; ++seq)
+				{
+					uint32_t *buf = buffers[tb.GetWriteIndex()];
+					for (int i = 0; i < kFrameSize; ++i)
+					{
+						buf[i] = seq;
+					}
+					tb.Publish();
+					if (!(seq & 0xFF))
+					{
+						std::this_thread::yield();
+					}
+				}
+				is_done.store(true, std::memory_order_release);
+			});
+
+	uint32_t last_seq = 0;
+	int torn_count = 0;
+	int backward_count = 0;
+	int acquire_count = 0;
+	while (true)
+	{
+		const bool is_last = is_done.load(std::memory_order_acquire);
+		if (tb.HasNew())
+		{
+			const uint32_t *buf = buffers[tb.Acquire()];
+			const uint32_t seq = buf[0];
+			for (int i = 1; i < kFrameSize; ++i)
+			{
+				torn_count += (buf[i] != seq);
+			}
+			backward_count += (seq <= last_seq);
+			last_seq = seq;
+			++acquire_count;
+		}
+		else if (is_last)
+		{
+			break;
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+
+	EXPECT_EQ(torn_count, 0);
+	EXPECT_EQ(backward_count, 0);
+	EXPECT(acquire_count > 0);
+	// The final frame is always picked up
+	EXPECT_EQ(last_seq, static_cast<uint32_t>(kFrameCount));
+}
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+#
+# deferred_log_decode.py
+# Expand the binary records produced by libbase::DeferredLog back to text
+#
+# Author: Ming Tsang
+# Copyright (c) 2014-2015 HKUST SmartCar Team
+# Refer to LICENSE for details
+#
+# Usage: deferred_log_decode.py FIRMWARE_ELF [CAPTURE_FILE]
+# The capture is read from stdin if CAPTURE_FILE is omitted
+
+import re
+import struct
+import sys
+
+SYNC = 0xA7
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+SPEC_RE = re.compile(
+		r"%([-+ #0]*)(\d+|\*)?(\.\d+)?(hh|h|ll|l|z|j|t|L)?([diouxXeEfgGcsp%])")
+
+
+def load_sections(path):
+	"""Return a list of (addr, data) of all the loaded sections in an ELF32"""
+	with open(path, "rb") as f:
+		elf = f.read()
+	if elf[:4] != b"\x7fELF" or elf[4] != 1:
+		raise ValueError("Not an ELF32 file")
+	shoff, = struct.unpack_from("<I", elf, 0x20)
+	shentsize, shnum = struct.unpack_from("<HH", elf, 0x2E)
+	product = []
+	for i in range(shnum):
+		(_, sh_type, flags, addr, offset, size) = struct.unpack_from("<IIIIII",
+				elf, shoff + i * shentsize)
+		if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+			product.append((addr, elf[offset:offset + size]))
+	return product
+
+
+def read_string(sections, addr):
+	for (beg, data) in sections:
+		if beg <= addr < beg + len(data):
+			end = data.find(b"\0", addr - beg)
+			return data[addr - beg:end].decode("latin-1")
+	return None
+
+
+def expand(fmt, args, is_truncated):
+	"""Substitute the printf specifiers in fmt with values unpacked from args"""
+	pos = 0
+	out = []
+	last = 0
+	for m in SPEC_RE.finditer(fmt):
+		out.append(fmt[last:m.start()])
+		last = m.end()
+		flags, width, precision, length, conv = m.groups()
+		if conv == "%":
+			out.append("%")
+			continue
+		try:
+			if conv == "s":
+				size = args[pos]
+				value = args[pos + 1:pos + 1 + size].decode("latin-1")
+				if pos + 1 + size > len(args):
+					raise IndexError
+				pos += 1 + size
+			elif length == "ll":
+				value, = struct.unpack_from("<q" if conv in "di" else "<Q", args,
+						pos)
+				pos += 8
+			elif conv in "eEfgG":
+				value, = struct.unpack_from("<f", args, pos)
+				pos += 4
+			else:
+				value, = struct.unpack_from("<i" if conv in "di" else "<I", args,
+						pos)
+				pos += 4
+		except (IndexError, struct.error):
+			out.append("?")
+			continue
+		if conv == "p":
+			out.append("0x%x" % value)
+			continue
+		py_spec = "%" + (flags or "") + (width if width and width != "*" else "") \
+				+ (precision or "") + ("x" if conv == "p" else conv)
+		out.append(py_spec % value)
+	out.append(fmt[last:])
+	if is_truncated:
+		out.append(" [truncated]")
+	return "".join(out)
+
+
+def decode(sections, stream):
+	buf = stream.read()
+	i = 0
+	while i + 6 <= len(buf):
+		if buf[i] != SYNC:
+			i += 1
+			continue
+		addr, = struct.unpack_from("<I", buf, i + 1)
+		size = buf[i + 5]
+		args = buf[i + 6:i + 6 + (size & 0x7F)]
+		if len(args) != size & 0x7F:
+			break
+		if addr == 0:
+			dropped, = struct.unpack_from("<I", args)
+			print("W %d log records dropped" % dropped)
+		else:
+			fmt = read_string(sections, addr)
+			if fmt is None:
+				# Not a record, resync
+				i += 1
+				continue
+			print(expand(fmt, args, size & 0x80))
+		i += 6 + (size & 0x7F)
+
+
+def main():
+	if len(sys.argv) < 2:
+		print("Usage: %s FIRMWARE_ELF [CAPTURE_FILE]" % sys.argv[0])
+		return 1
+	sections = load_sections(sys.argv[1])
+	if len(sys.argv) > 2:
+		with open(sys.argv[2], "rb") as f:
+			decode(sections, f)
+	else:
+		decode(sections, sys.stdin.buffer)
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())